@@ -17,6 +17,7 @@
 /* --------- Boolean config variables --------- */
 
 #cmakedefine01 TERM_BIG_SCROLL_BUF
+#cmakedefine01 TERM_BATCHED_RENDERING
 #cmakedefine01 FB_CONSOLE_BANNER
 #cmakedefine01 FB_CONSOLE_CURSOR_BLINK
 #cmakedefine01 FB_CONSOLE_USE_ALT_FONTS
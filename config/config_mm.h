@@ -15,6 +15,7 @@
 /* --------- Boolean config variables --------- */
 
 #cmakedefine01 FORK_NO_COW
+#cmakedefine01 FORK_SHARE_PAGE_TABLES
 #cmakedefine01 MMAP_NO_COW
 
 
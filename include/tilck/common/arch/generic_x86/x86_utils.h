@@ -156,6 +156,17 @@ static ALWAYS_INLINE void halt(void)
    asmVolatile("hlt");
 }
 
+/*
+ * Enable the interrupts and halt the CPU, atomically: thanks to the one
+ * instruction "shadow" of STI, no IRQ can be served between STI and HLT and,
+ * therefore, no wake-up event can be missed.
+ */
+static ALWAYS_INLINE void enable_interrupts_and_halt(void)
+{
+   asmVolatile("sti\n\t"
+               "hlt\n\t");
+}
+
 static ALWAYS_INLINE void wrmsr(u32 msr_id, u64 msr_value)
 {
    asmVolatile( "wrmsr" : : "c" (msr_id), "A" (msr_value) );
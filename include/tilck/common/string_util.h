@@ -96,6 +96,17 @@ static inline bool is_dot_or_dotdot(const char *n, int nl) {
    return (n[0] == '.' && (nl == 1 || (n[1] == '.' && nl == 2)));
 }
 
+/* FNV-1a hash of the first `len` chars of `s`, optionally case-folded */
+static inline u32 fnv1a_hash(const char *s, size_t len, bool fold_case) {
+
+   u32 h = 2166136261u;
+
+   for (size_t i = 0; i < len; i++)
+      h = (h ^ (u8)(fold_case ? tolower(s[i]) : s[i])) * 16777619u;
+
+   return h;
+}
+
 int stricmp(const char *s1, const char *s2);
 void str_reverse(char *str, size_t len);
 
@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+
+/*
+ * Layout of the vdso-like page, mapped read-only in every process at
+ * USER_VSDO_LIKE_PAGE_VADDR. This header is shared by the kernel and by
+ * user applications.
+ *
+ * The page contains:
+ *
+ *    - the tiny piece of code used by sysexit to return to user space
+ *    - user-callable functions, each one at a fixed offset, serving some
+ *      time-related syscalls without entering the kernel
+ *    - a data area, updated by the timer IRQ handler, read by those functions
+ *
+ * The functions follow the cdecl calling convention and have the same
+ * signatures of the libc functions with the same name (with the 32-bit
+ * time_t). On error they return -errno instead of setting errno, like
+ * Linux's vDSO. Clocks not supported by vdso_clock_gettime() fall back to
+ * the actual syscall. When the kernel uses the TSC as clocksource, the
+ * CLOCK_MONOTONIC* clocks are read through the TSC as well.
+ */
+
+#define VDSO_SYSEXIT_OFF                  0x000
+#define VDSO_CLOCK_GETTIME_OFF            0x100
+#define VDSO_GETTIMEOFDAY_OFF             0x200
+#define VDSO_TIME_OFF                     0x300
+#define VDSO_FUNC_MAX_SIZE                0x100
+#define VDSO_DATA_OFF                     0x800
+
+/* Offsets of struct vdso_data's fields, for the assembly code */
+#define VDSO_DATA_SEQ_OFF                     0
+#define VDSO_DATA_FLAGS_OFF                   4
+#define VDSO_DATA_TIME_NS_OFF                 8
+#define VDSO_DATA_BOOT_TS_OFF                16
+#define VDSO_DATA_TSC_CYCLES_OFF             24
+#define VDSO_DATA_TSC_NS_OFF                 32
+#define VDSO_DATA_TSC_MULT_OFF               40
+#define VDSO_DATA_TSC_SHIFT_OFF              44
+
+/* vdso_data flags */
+#define VDSO_FL_TSC                           1  /* the tsc_* fields are valid */
+
+#ifndef ASM_FILE
+
+#include <tilck/common/basic_defs.h>
+
+/*
+ * The data is protected by a sequence counter: the kernel makes `seq` odd
+ * while updating the other fields and even again once done. Readers retry
+ * when `seq` is odd or it changed while they were reading.
+ */
+struct vdso_data {
+
+   volatile u32 seq;
+   volatile u32 flags;
+   volatile u64 time_ns;            /* nanoseconds since boot */
+   volatile s64 boot_timestamp;     /* UNIX timestamp at boot, in seconds */
+
+   /*
+    * TSC clocksource (when VDSO_FL_TSC is set): the monotonic time is
+    *
+    *    tsc_ns + (((rdtsc - tsc_cycles) * tsc_mult) >> tsc_shift)
+    *
+    * where `tsc_cycles` and `tsc_ns` are updated at every tick.
+    */
+   volatile u64 tsc_cycles;
+   volatile u64 tsc_ns;
+   volatile u32 tsc_mult;
+   volatile u32 tsc_shift;
+};
+
+#define VDSO_FUNC_ADDR(off) ((void *)(USER_VSDO_LIKE_PAGE_VADDR + (off)))
+
+#endif
@@ -50,5 +50,20 @@ static ALWAYS_INLINE void set_return_register(regs_t *r, ulong value)
    r->eax = value;
 }
 
+static ALWAYS_INLINE ulong regs_get_ip(regs_t *r)
+{
+   return r->eip;
+}
+
+static ALWAYS_INLINE ulong regs_get_frame_ptr(regs_t *r)
+{
+   return r->ebp;
+}
+
+static ALWAYS_INLINE bool regs_in_user_mode(regs_t *r)
+{
+   return (r->cs & 3) == 3;
+}
+
 NORETURN void context_switch(regs_t *r);
 
@@ -36,6 +36,8 @@ bool clock_in_resync(void);
 bool clock_in_full_resync(void);
 void real_time_get_timespec(struct k_timespec64 *tp);
 void monotonic_time_get_timespec(struct k_timespec64 *tp);
+int do_clock_gettime(clockid_t clk_id, struct k_timespec64 *tp);
+u64 timespec_to_ticks(const struct k_timespec64 *ts);
 void clock_get_resync_stats(struct clock_resync_stats *s);
 
 static ALWAYS_INLINE struct timespec
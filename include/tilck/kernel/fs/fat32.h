@@ -8,6 +8,59 @@
 #include <tilck/kernel/sync.h>
 #include <tilck/kernel/datetime.h>
 #include <tilck/kernel/fs/vfs_base.h>
+#include <tilck/kernel/bintree.h>
+
+/*
+ * A run of `count` contiguous clusters, starting at cluster `clu` in the
+ * partition, holding the file's data starting from its `file_clu`-th cluster.
+ */
+struct fat_extent {
+
+   u32 file_clu;
+   u32 clu;
+   u32 count;
+};
+
+/*
+ * The cluster chain of a file, collapsed into a sorted array of extents. It's
+ * built the first time a file is opened and then shared by all of its handles,
+ * until the file system is unmounted: that's possible because FAT ramdisks are
+ * read-only, for the moment.
+ */
+struct fat_extent_map {
+
+   struct bintree_node node;
+   struct fat_entry *e;          /* the file's entry: key in the tree */
+   u32 count;                    /* number of extents */
+   struct fat_extent *extents;
+};
+
+struct fat_dir_index_ent {
+
+   struct fat_entry *e;
+   u32 hash;                     /* hash of the case-folded name */
+   u32 next;                     /* next entry in the bucket + 1, or 0 */
+   u32 name_off;                 /* offset of the name in `names` */
+   u16 name_len;
+   bool long_name;               /* long names are case-sensitive */
+};
+
+/*
+ * A hash index of the entries in a directory, by name. Like the extent maps,
+ * it's built the first time it's needed and kept until the file system is
+ * unmounted.
+ */
+struct fat_dir_index {
+
+   struct bintree_node node;
+   ulong clu;                    /* dir's first cluster: key in the tree */
+   u32 count;                    /* number of entries */
+   u32 buckets_count;            /* always a power of 2 */
+   u32 *buckets;                 /* first entry in the bucket + 1, or 0 */
+   struct fat_dir_index_ent *ents;
+   char *names;
+   size_t names_size;
+};
 
 struct fat_fs_device_data {
 
@@ -28,6 +81,10 @@ struct fat_fs_device_data {
     * regular fat_entry.
     */
    struct fat_entry *root_dir_entries;
+
+   struct kmutex cache_lock;           /* protects the two trees below */
+   struct fat_extent_map *ext_maps;    /* root of the extent maps tree */
+   struct fat_dir_index *dir_indexes;  /* root of the dir indexes tree */
 };
 
 struct fatfs_handle {
@@ -37,11 +94,12 @@ struct fatfs_handle {
 
    /* fs-specific members */
    struct fat_entry *e;
-   u32 curr_cluster;
+   struct fat_extent_map *ext_map;     /* NULL for directories */
 };
 
 struct fs *fat_mount_ramdisk(void *vaddr, size_t rd_size, u32 flags);
 void fat_umount_ramdisk(struct fs *fs);
+char *fat_get_data_at(struct fatfs_handle *h, offt pos, offt *contig_rem);
 
 struct datetime
 fat_datetime_to_regular_datetime(u16 date, u16 time, u8 timetenth);
@@ -67,6 +67,8 @@ typedef int     (*func_exlock_noblk) (struct fs *, vfs_inode_ptr_t);
 /* file ops */
 typedef ssize_t        (*func_read)         (fs_handle, char *, size_t);
 typedef ssize_t        (*func_write)        (fs_handle, char *, size_t);
+typedef ssize_t        (*func_pread)        (fs_handle, char *, size_t, offt);
+typedef ssize_t        (*func_pwrite)       (fs_handle, char *, size_t, offt);
 typedef offt           (*func_seek)         (fs_handle, offt, int);
 typedef int            (*func_ioctl)        (fs_handle, ulong, void *);
 
@@ -87,6 +89,13 @@ typedef ssize_t        (*func_writev)       (fs_handle,
                                              const struct iovec *,
                                              int);
 
+typedef ssize_t        (*func_sendfile)     (fs_handle,
+                                             fs_handle,
+                                             offt *,
+                                             size_t);
+
+typedef int            (*func_splice_page)  (fs_handle, void *);
+
 
 /*
  * Operations affecting the file system structure (directories, files, etc.).
@@ -146,8 +155,12 @@ struct file_ops {
    func_mmap mmap;                     /* if NULL -> -ENODEV */
    func_munmap munmap;                 /* if NULL -> -ENODEV */
 
+   func_pread pread;                   /* if NULL, emulated with seek */
+   func_pwrite pwrite;                 /* if NULL, emulated with seek */
    func_readv readv;                   /* if NULL, emulated in non-atomic way */
    func_writev writev;                 /* if NULL, emulated in non-atomic way */
+   func_sendfile sendfile;             /* if NULL, emulated with read+write */
+   func_splice_page splice_page;       /* if NULL, the page is copied */
 
    func_handle_fault handle_fault;     /* if NULL -> false     */
 
@@ -205,6 +218,9 @@ ssize_t vfs_read(fs_handle h, void *buf, size_t buf_size);
 ssize_t vfs_write(fs_handle h, void *buf, size_t buf_size);
 ssize_t vfs_readv(fs_handle h, const struct iovec *iov, int iovcnt);
 ssize_t vfs_writev(fs_handle h, const struct iovec *iov, int iovcnt);
+ssize_t vfs_pread(fs_handle h, void *buf, size_t buf_size, offt off);
+ssize_t vfs_pwrite(fs_handle h, void *buf, size_t buf_size, offt off);
+ssize_t vfs_sendfile(fs_handle out, fs_handle in, offt *pos, size_t count);
 
 int vfs_exlock_noblock(struct fs *fs, vfs_inode_ptr_t i);
 int vfs_exunlock(struct fs *fs, vfs_inode_ptr_t i);
@@ -279,6 +295,19 @@ vfs_resolve(const char *path,
             bool exlock,
             bool res_last_sl);
 
+/* Dentry cache statistics, see vfs_dcache.c.h */
+struct vfs_dcache_stats {
+
+   u32 hits;
+   u32 neg_hits;                       /* hits of cached ENOENT lookups */
+   u32 misses;
+   u32 evictions;
+   u32 invalidations;
+};
+
+void vfs_dcache_get_stats(struct vfs_dcache_stats *stats);
+
+void init_vfs(void);
 int mp_init(struct fs *root_fs);
 int mp_add(struct fs *fs, const char *target_path);
 int mp_remove(const char *target_path);
@@ -70,6 +70,7 @@ struct vfs_path {
 
 #define VFS_FS_RW             (1 << 0)  /* struct fs mounted in RW mode */
 #define VFS_FS_RQ_DE_SKIP     (1 << 1)  /* FS requires vfs dents skip */
+#define VFS_FS_DCACHE         (1 << 2)  /* FS lookups can be cached by VFS */
 
 /* This struct is Tilck's analogue of Linux's "superblock" */
 struct fs {
@@ -136,6 +137,7 @@ int vfs_dup(fs_handle h, fs_handle *dup_h);
 void vfs_close2(struct process *pi, fs_handle h);
 void vfs_close(fs_handle h);
 fs_handle get_fs_handle(int fd);
+int install_fs_handle(fs_handle h, bool cloexec);
 
 static ALWAYS_INLINE bool
 is_mmap_supported(fs_handle h)
@@ -58,6 +58,11 @@ int get_int_num(regs_t *context);
 void on_first_pdir_update(void);
 void hw_read_clock(struct datetime *out);
 u32 hw_timer_setup(u32 hz);
+u32 hw_timer_max_oneshot_ticks(void);
+void hw_timer_set_oneshot(u32 ticks);
+bool hw_timer_oneshot_fired(void);
+u32 hw_timer_oneshot_cut(u32 ticks);
+void hw_timer_set_periodic(void);
 
 bool allocate_fpu_regs(arch_task_members_t *arch_fields);
 void copy_main_tss_on_regs(regs_t *ctx);
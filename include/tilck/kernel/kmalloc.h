@@ -3,6 +3,7 @@
 #pragma once
 
 #include <tilck/common/basic_defs.h>
+#include <tilck/kernel/list.h>
 
 #define KMALLOC_METADATA_BLOCK_NODE_SIZE      1
 #define KMALLOC_HEAPS_COUNT                  32
@@ -98,6 +99,46 @@ kmalloc_accelerator_get_elem(struct kmalloc_acc *a);
 void
 kmalloc_destroy_accelerator(struct kmalloc_acc *a);
 
+/*
+ * Object cache: constant-time allocator of fixed-size objects, built on top of
+ * kmalloc. See kernel/kmalloc/kmalloc_caches.c.h.
+ */
+struct kmem_cache {
+
+   const char *name;
+   u32 obj_size;              /* object size, rounded up */
+   u32 slab_size;             /* power of 2, 0 until the first slab is added */
+   u32 objs_per_slab;
+   u32 slabs_count;
+   u32 empty_slabs;
+   u32 allocated_objs;
+   struct list partial_slabs; /* slabs having at least one free object */
+   struct list_node node;     /* node in the global list of caches */
+};
+
+#define STATIC_KMEM_CACHE_INIT(c, cname, size)                    \
+   {                                                              \
+      .name = (cname),                                            \
+      .obj_size = (size),                                         \
+      .partial_slabs = STATIC_LIST_INIT(c.partial_slabs),         \
+      .node = STATIC_LIST_NODE_INIT(c.node),                      \
+   }
+
+void
+kmem_cache_create(struct kmem_cache *c, const char *name, u32 obj_size);
+
+void
+kmem_cache_destroy(struct kmem_cache *c);
+
+void *
+kmem_cache_alloc(struct kmem_cache *c);
+
+void *
+kmem_cache_zalloc(struct kmem_cache *c);
+
+void
+kmem_cache_free(struct kmem_cache *c, void *obj);
+
 #ifndef UNIT_TEST_ENVIRONMENT
 
 static inline void *
@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+/*
+ * Latency histograms
+ * ---------------------
+ *
+ * Always-on histograms of the time spent, in TSC cycles, by the kernel's hot
+ * paths: each syscall (including the time spent blocked), each IRQ line (all
+ * of its handlers), the page faults and the time between a task's wakeup and
+ * the moment it actually runs.
+ *
+ * Buckets are powers of 2: bucket 0 counts the durations shorter than
+ * 2^LAT_HIST_MIN_SHIFT cycles, bucket i > 0 the ones in the range
+ * [2^(i + LAT_HIST_MIN_SHIFT - 1), 2^(i + LAT_HIST_MIN_SHIFT)) and the last
+ * bucket everything longer than that.
+ *
+ * The histograms can be read from /dev/latency (text, one line per histogram)
+ * and from the debug panel.
+ */
+
+#define LAT_HIST_BUCKETS                          28
+#define LAT_HIST_MIN_SHIFT                         7
+#define LAT_HIST_IRQS                             16
+
+struct lat_hist {
+
+   u32 count;
+   u32 buckets[LAT_HIST_BUCKETS];
+   u64 sum;                         /* total TSC cycles */
+};
+
+extern struct lat_hist lat_irq_hists[LAT_HIST_IRQS];
+extern struct lat_hist lat_page_fault_hist;
+extern struct lat_hist lat_wakeup_hist;
+
+void init_latency(void);
+void lat_hist_add(struct lat_hist *h, u64 cycles);
+void lat_syscall_add(u32 sn, u64 cycles);
+
+/* Copy a histogram atomically. Returns false if `h` is NULL or empty */
+bool lat_hist_get(const struct lat_hist *h, struct lat_hist *out);
+
+/* Returns NULL if the syscall has never been called */
+const struct lat_hist *lat_get_syscall_hist(u32 sn);
+
+/* Writes "<name>/<sn>" (e.g. "read/3") or just "<sn>" if there's no symbol */
+void lat_get_syscall_name(u32 sn, char *buf, size_t size);
+
+/*
+ * Returns the upper bound, in cycles, of the bucket containing the given
+ * percentile (0-100). For the last bucket, its lower bound is returned.
+ */
+u64 lat_hist_percentile(const struct lat_hist *h, u32 pct);
+
+void lat_reset_all(void);
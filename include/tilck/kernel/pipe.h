@@ -1,7 +1,9 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
 #pragma once
-#define PIPE_BUF_SIZE   4096
+
+#define PIPE_DEF_SIZE   (16 * PAGE_SIZE)     /* default capacity: 64 KB */
+#define PIPE_MAX_SIZE   (256 * PAGE_SIZE)    /* max capacity: 1 MB */
 
 struct pipe;
 
@@ -9,3 +11,9 @@ struct pipe *create_pipe(void);
 void destroy_pipe(struct pipe *p);
 fs_handle pipe_create_read_handle(struct pipe *p);
 fs_handle pipe_create_write_handle(struct pipe *p);
+
+struct pipe *get_pipe(fs_handle h);
+bool is_pipe_read_end(fs_handle h);
+int pipe_get_size(struct pipe *p);
+int pipe_set_size(struct pipe *p, ulong size);
+ssize_t pipe_splice_to(fs_handle h, fs_handle out, size_t len);
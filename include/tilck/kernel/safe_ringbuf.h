@@ -87,6 +87,7 @@ struct safe_ringbuf {
 
 bool safe_ringbuf_is_empty(struct safe_ringbuf *rb);
 bool safe_ringbuf_is_full(struct safe_ringbuf *rb);
+u16 safe_ringbuf_get_elems(struct safe_ringbuf *rb);
 
 void
 safe_ringbuf_init(struct safe_ringbuf *rb, u16 max_elems, u16 e_size, void *b);
@@ -40,6 +40,9 @@ struct sched_ticks {
    u32 timeslice;       /* ticks counter for the current time slice */
    u64 total;           /* total life-time ticks */
    u64 total_kernel;    /* total life-time ticks spent in kernel */
+   u64 cycles;          /* total life-time TSC cycles, until cycles_start */
+   u64 cycles_start;    /* TSC value when the task has been switched in */
+   u64 wakeup_cycles;   /* TSC value at the last wakeup, 0 once it ran */
 };
 
 struct task {
@@ -74,7 +77,7 @@ struct task {
    void *worker_thread;                      /* only for worker threads */
 
    struct bintree_node tree_by_tid_node;
-   struct list_node runnable_node;
+   struct bintree_node runnable_node;
    struct list_node sleeping_node;
    struct list_node zombie_node;
    struct list_node wakeup_timer_node;
@@ -84,6 +87,8 @@ struct task {
 
    s32 wstatus;                       /* waitpid's wstatus  */
    struct sched_ticks ticks;          /* scheduler counters */
+   u64 runnable_key;                  /* sort key in the runnable tree */
+   u64 runnable_seq;                  /* FIFO tie-breaker for equal keys */
 
    void *kernel_stack;
    void *args_copybuf;
@@ -94,7 +99,7 @@ struct task {
    };
 
    struct wait_obj wobj;
-   u32 ticks_before_wake_up;
+   u64 wakeup_deadline;               /* abs. wakeup time in ticks, or 0 */
 
    /* Temp kernel allocations for user requests */
    struct kernel_alloc *kallocs_tree_root;
@@ -118,7 +123,6 @@ struct task {
 extern struct task *kernel_process;
 extern struct process *kernel_process_pi;
 
-extern struct list runnable_tasks_list;
 extern struct list sleeping_tasks_list;
 extern struct list zombie_tasks_list;
 
@@ -134,6 +138,7 @@ void init_sched(void);
 struct task *get_task(int tid);
 struct process *get_process(int pid);
 void task_change_state(struct task *ti, enum task_state new_state);
+void sched_update_runnable_task(struct task *ti);
 
 static ALWAYS_INLINE void sched_set_need_resched(void)
 {
@@ -303,6 +308,7 @@ int get_curr_tid(void);
 int get_curr_pid(void);
 void save_current_task_state(regs_t *);
 void sched_account_ticks(void);
+void sched_account_task_switch(struct task *prev, struct task *next);
 int create_new_pid(void);
 int create_new_kernel_tid(void);
 void task_info_reset_kernel_stack(struct task *ti);
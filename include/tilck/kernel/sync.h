@@ -15,11 +15,13 @@ enum wo_type {
    WOBJ_KCOND,
    WOBJ_TASK,
    WOBJ_SEM,
+   WOBJ_FUTEX,      /* ptr: the physical address of the futex word */
 
    /* Special "meta-object" types */
 
    WOBJ_MWO_WAITER, /* struct multi_obj_waiter */
-   WOBJ_MWO_ELEM    /* a pointer to this wobj is castable to mwobj_elem */
+   WOBJ_MWO_ELEM,   /* a pointer to this wobj is castable to mwobj_elem */
+   WOBJ_KCOND_WATCHER /* castable to struct kcond_watcher */
 };
 
 #define NO_EXTRA                 0
@@ -205,6 +207,33 @@ void kcond_signal_int(struct kcond *c, bool all);
 bool kcond_wait(struct kcond *c, struct kmutex *m, u32 timeout_ticks);
 bool kcond_is_anyone_waiting(struct kcond *c);
 
+/*
+ * Persistent kcond watchers.
+ *
+ * Unlike tasks waiting on a kcond, a watcher stays in kcond's wait_list until
+ * it's explicitly removed and every signal, even a non-broadcast one, just
+ * calls its callback, with preemption disabled. Watchers do not consume
+ * signals: kcond_signal_one() still wakes up the first waiting task, if any.
+ * The callback must not sleep nor touch the signaled kcond.
+ */
+
+struct kcond_watcher;
+typedef void (*kcond_watcher_cb)(struct kcond_watcher *w);
+
+struct kcond_watcher {
+
+   struct wait_obj wobj;         /* wobj.type == WOBJ_KCOND_WATCHER */
+   kcond_watcher_cb cb;
+   void *arg;
+};
+
+void kcond_add_watcher(struct kcond *c,
+                       struct kcond_watcher *w,
+                       kcond_watcher_cb cb,
+                       void *arg);
+
+void kcond_remove_watcher(struct kcond_watcher *w);
+
 static inline void kcond_signal_one(struct kcond *c)
 {
    kcond_signal_int(c, false);
@@ -16,6 +16,7 @@
 #include <sys/select.h> // system header
 #include <time.h>       // system header
 #include <poll.h>       // system header
+#include <sys/epoll.h>  // system header
 #include <utime.h>      // system header
 
 #ifndef __GLIBC__
@@ -98,6 +99,18 @@ struct k_timespec64 {
    long tv_nsec;
 };
 
+struct k_itimerspec32 {
+
+   struct k_timespec32 it_interval;
+   struct k_timespec32 it_value;
+};
+
+struct k_itimerspec64 {
+
+   struct k_timespec64 it_interval;
+   struct k_timespec64 it_value;
+};
+
 #ifndef O_DIRECTORY
    #define O_DIRECTORY __O_DIRECTORY
 #endif
@@ -118,6 +131,14 @@ struct k_timespec64 {
    #define O_PATH __O_PATH
 #endif
 
+#ifndef F_SETPIPE_SZ
+   #define F_SETPIPE_SZ 1031
+#endif
+
+#ifndef F_GETPIPE_SZ
+   #define F_GETPIPE_SZ 1032
+#endif
+
 #define FCNTL_CHANGEABLE_FL (         \
    O_APPEND      |                    \
    O_ASYNC       |                    \
@@ -277,8 +277,8 @@ CREATE_STUB_SYSCALL_IMPL(sys_rt_sigpending)
 CREATE_STUB_SYSCALL_IMPL(sys_rt_sigtimedwait_time32)
 CREATE_STUB_SYSCALL_IMPL(sys_rt_sigqueueinfo)
 CREATE_STUB_SYSCALL_IMPL(sys_rt_sigsuspend)
-CREATE_STUB_SYSCALL_IMPL(sys_pread64)
-CREATE_STUB_SYSCALL_IMPL(sys_pwrite64)
+int sys_pread64(int fd, void *u_buf, size_t count, s64 off);
+int sys_pwrite64(int fd, const void *u_buf, size_t count, s64 off);
 CREATE_STUB_SYSCALL_IMPL(sys_chown16)
 
 int sys_getcwd(char *buf, size_t size);
@@ -286,7 +286,8 @@ int sys_getcwd(char *buf, size_t size);
 CREATE_STUB_SYSCALL_IMPL(sys_capget)
 CREATE_STUB_SYSCALL_IMPL(sys_capset)
 CREATE_STUB_SYSCALL_IMPL(sys_sigaltstack)
-CREATE_STUB_SYSCALL_IMPL(sys_sendfile)
+
+int sys_sendfile(int out_fd, int in_fd, long *u_offset, size_t count);
 
 int sys_vfork(void);
 
@@ -349,8 +350,12 @@ CREATE_STUB_SYSCALL_IMPL(sys_fremovexattr)
 
 int sys_tkill(int tid, int sig);
 
-CREATE_STUB_SYSCALL_IMPL(sys_sendfile64)
-CREATE_STUB_SYSCALL_IMPL(sys_futex_time32)
+int sys_sendfile64(int out_fd, int in_fd, s64 *u_offset, size_t count);
+
+int sys_futex_time32(u32 *uaddr, int op, u32 val,
+                     const struct k_timespec32 *user_timeout,
+                     u32 *uaddr2, u32 val3);
+
 CREATE_STUB_SYSCALL_IMPL(sys_sched_setaffinity)
 CREATE_STUB_SYSCALL_IMPL(sys_sched_getaffinity)
 
@@ -367,9 +372,14 @@ CREATE_STUB_SYSCALL_IMPL(sys_fadvise64)
 NORETURN int sys_exit_group(int status);
 
 CREATE_STUB_SYSCALL_IMPL(sys_lookup_dcookie)
-CREATE_STUB_SYSCALL_IMPL(sys_epoll_create)
-CREATE_STUB_SYSCALL_IMPL(sys_epoll_ctl)
-CREATE_STUB_SYSCALL_IMPL(sys_epoll_wait)
+int sys_epoll_create(int size);
+int sys_epoll_ctl(int epfd, int op, int fd, struct epoll_event *u_event);
+
+int sys_epoll_wait(int epfd,
+                   struct epoll_event *u_events,
+                   int maxevents,
+                   int timeout);
+
 CREATE_STUB_SYSCALL_IMPL(sys_remap_file_pages)
 
 // TODO: complete the implementation when thread creation is implemented.
@@ -434,10 +444,11 @@ CREATE_STUB_SYSCALL_IMPL(sys_ppoll)
 CREATE_STUB_SYSCALL_IMPL(sys_unshare)
 CREATE_STUB_SYSCALL_IMPL(sys_set_robust_list)
 CREATE_STUB_SYSCALL_IMPL(sys_get_robust_list)
-CREATE_STUB_SYSCALL_IMPL(sys_splice)
+int sys_splice(int fd_in, s64 *u_off_in, int fd_out, s64 *u_off_out,
+               size_t len, u32 flags);
 CREATE_STUB_SYSCALL_IMPL(sys_sync_file_range)
 CREATE_STUB_SYSCALL_IMPL(sys_tee)
-CREATE_STUB_SYSCALL_IMPL(sys_vmsplice)
+int sys_vmsplice(int fd, const struct iovec *u_iov, ulong nr_segs, u32 flags);
 CREATE_STUB_SYSCALL_IMPL(sys_move_pages)
 CREATE_STUB_SYSCALL_IMPL(sys_getcpu)
 CREATE_STUB_SYSCALL_IMPL(sys_epoll_pwait)
@@ -446,21 +457,29 @@ int sys_utimensat_time32(int dirfd, const char *u_path,
                          const struct k_timespec32 times[2], int flags);
 
 CREATE_STUB_SYSCALL_IMPL(sys_signalfd)
-CREATE_STUB_SYSCALL_IMPL(sys_timerfd_create)
-CREATE_STUB_SYSCALL_IMPL(sys_eventfd)
+int sys_timerfd_create(clockid_t clockid, int flags);
+int sys_eventfd(unsigned int initval);
 CREATE_STUB_SYSCALL_IMPL(sys_fallocate)
-CREATE_STUB_SYSCALL_IMPL(sys_timerfd_settime32)
-CREATE_STUB_SYSCALL_IMPL(sys_timerfd_gettime32)
+
+int sys_timerfd_settime32(int fd,
+                          int flags,
+                          const struct k_itimerspec32 *user_val,
+                          struct k_itimerspec32 *user_old);
+
+int sys_timerfd_gettime32(int fd, struct k_itimerspec32 *user_curr);
+
 CREATE_STUB_SYSCALL_IMPL(sys_signalfd4)
-CREATE_STUB_SYSCALL_IMPL(sys_eventfd2)
-CREATE_STUB_SYSCALL_IMPL(sys_epoll_create1)
+int sys_eventfd2(unsigned int initval, int flags);
+int sys_epoll_create1(int flags);
 CREATE_STUB_SYSCALL_IMPL(sys_dup3)
 
 int sys_pipe2(int u_pipefd[2], int flags);
 
 CREATE_STUB_SYSCALL_IMPL(sys_inotify_init1)
-CREATE_STUB_SYSCALL_IMPL(sys_preadv)
-CREATE_STUB_SYSCALL_IMPL(sys_pwritev)
+int sys_preadv(int fd, const struct iovec *u_iov, int u_iovcnt,
+               ulong pos_l, ulong pos_h);
+int sys_pwritev(int fd, const struct iovec *u_iov, int u_iovcnt,
+                ulong pos_l, ulong pos_h);
 CREATE_STUB_SYSCALL_IMPL(sys_rt_tgsigqueueinfo)
 CREATE_STUB_SYSCALL_IMPL(sys_perf_event_open)
 CREATE_STUB_SYSCALL_IMPL(sys_recvmmsg_time32)
@@ -536,8 +555,12 @@ int sys_clock_getres(clockid_t clk_id, struct k_timespec64 *user_res);
 CREATE_STUB_SYSCALL_IMPL(sys_clock_nanosleep)
 CREATE_STUB_SYSCALL_IMPL(sys_timer_gettime)
 CREATE_STUB_SYSCALL_IMPL(sys_timer_settime)
-CREATE_STUB_SYSCALL_IMPL(sys_timerfd_gettime)
-CREATE_STUB_SYSCALL_IMPL(sys_timerfd_settime)
+int sys_timerfd_gettime(int fd, struct k_itimerspec64 *user_curr);
+
+int sys_timerfd_settime(int fd,
+                        int flags,
+                        const struct k_itimerspec64 *user_val,
+                        struct k_itimerspec64 *user_old);
 CREATE_STUB_SYSCALL_IMPL(sys_utimensat)
 CREATE_STUB_SYSCALL_IMPL(sys_pselect6_time32)
 CREATE_STUB_SYSCALL_IMPL(sys_ppoll_time32)
@@ -547,7 +570,9 @@ CREATE_STUB_SYSCALL_IMPL(sys_mq_timedsend)
 CREATE_STUB_SYSCALL_IMPL(sys_mq_timedreceive)
 CREATE_STUB_SYSCALL_IMPL(sys_semtimedop)
 CREATE_STUB_SYSCALL_IMPL(sys_rt_sigtimedwait)
-CREATE_STUB_SYSCALL_IMPL(sys_futex)
+int sys_futex(u32 *uaddr, int op, u32 val,
+              const struct k_timespec64 *user_timeout,
+              u32 *uaddr2, u32 val3);
 CREATE_STUB_SYSCALL_IMPL(sys_sched_rr_get_interval)
 CREATE_STUB_SYSCALL_IMPL(sys_pidfd_send_signal)
 CREATE_STUB_SYSCALL_IMPL(sys_io_uring_setup)
@@ -3,6 +3,7 @@
 #pragma once
 #include <tilck_gen_headers/config_sched.h>
 #include <tilck/common/basic_defs.h>
+#include <tilck/kernel/list.h>
 
 void kernel_sleep(u64 ticks);  /* sleep for `ticks` timer ticks (jiffies) */
 void kernel_sleep_ms(u64 ms);  /* sleep for `ms` milliseconds */
@@ -16,3 +17,36 @@ ms_to_ticks(u64 ms)
 
 u64 get_ticks(void);
 void init_timer(void);
+void timer_idle_enter(void);
+void timer_idle_exit(void);
+
+/* TSC clocksource: available only when the TSC is invariant */
+bool tsc_clock_enabled(void);
+u64 tsc_cycles_to_ns(u64 cycles);
+u64 tsc_clock_get_ns(void);    /* monotonic nanoseconds since boot */
+
+/*
+ * Kernel timers
+ *
+ * Timers not bound to any task: when a timer expires, its callback is called
+ * by the timer IRQ handler, with interrupts disabled, along with the number of
+ * expirations (> 1 only for periodic timers that missed some ticks). Because
+ * of that, callbacks must be very short and cannot sleep nor signal kconds:
+ * they can only update counters and enqueue jobs on worker threads.
+ */
+
+struct ktimer;
+typedef void (*ktimer_cb)(struct ktimer *t, u32 expirations);
+
+struct ktimer {
+
+   struct list_node node;
+   u64 deadline;              /* absolute, in ticks. 0 means: not armed */
+   u64 interval;              /* period in ticks, 0 for one-shot timers */
+   ktimer_cb cb;
+};
+
+void ktimer_init(struct ktimer *t, ktimer_cb cb);
+void ktimer_set(struct ktimer *t, u64 ticks, u64 interval);
+u64 ktimer_cancel(struct ktimer *t);
+u64 ktimer_get_remaining(struct ktimer *t);
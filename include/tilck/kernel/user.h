@@ -2,6 +2,7 @@
 
 #pragma once
 #include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
 
 static inline bool user_out_of_range(const void *user_ptr, size_t n)
 {
@@ -11,6 +12,34 @@ static inline bool user_out_of_range(const void *user_ptr, size_t n)
 int copy_from_user(void *dest, const void *user_ptr, size_t n);
 int copy_to_user(void *user_ptr, const void *src, size_t n);
 
+/*
+ * Copy functions for the file systems supporting VFS_SPFL_NO_USER_COPY: their
+ * read/write funcs get the user buffer directly from sys_read()/sys_write(),
+ * after it has been range-checked, but they can still be called by the kernel
+ * itself with regular kernel buffers (e.g. by the ELF loader).
+ */
+static inline int copy_to_any_buf(void *buf, const void *src, size_t n)
+{
+#ifndef UNIT_TEST_ENVIRONMENT
+   if ((ulong)buf < KERNEL_BASE_VA)
+      return copy_to_user(buf, src, n);
+#endif
+
+   memcpy(buf, src, n);
+   return 0;
+}
+
+static inline int copy_from_any_buf(void *dest, const void *buf, size_t n)
+{
+#ifndef UNIT_TEST_ENVIRONMENT
+   if ((ulong)buf < KERNEL_BASE_VA)
+      return copy_from_user(dest, buf, n);
+#endif
+
+   memcpy(dest, buf, n);
+   return 0;
+}
+
 int copy_str_from_user(void *dest,
                        const void *user_ptr,
                        size_t max_size,
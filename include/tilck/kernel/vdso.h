@@ -0,0 +1,10 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/vdso.h>
+
+void init_vdso_data(void *vdso_page);
+void vdso_update_time(u64 time_ns, u64 tsc_cycles, u64 tsc_ns);
+void vdso_enable_tsc(u32 mult, u32 shift, u64 tsc_cycles, u64 tsc_ns);
+void vdso_set_boot_timestamp(s64 ts);
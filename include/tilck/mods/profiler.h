@@ -0,0 +1,73 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+#include <tilck/kernel/hal_types.h>
+
+/*
+ * Sampling profiler
+ * --------------------
+ *
+ * While enabled, at every timer IRQ the interrupted instruction pointer and a
+ * short frame-pointer stack are saved in a buffer allocated upfront. Samples
+ * are never overwritten: when the buffer is full, they're just counted as lost
+ * until the profiler is reset. The samples are aggregated per function (using
+ * the kernel's ELF symbols) on demand by the debug panel and exported in the
+ * "folded stacks" format, used by the flamegraph tools, by /dev/profiler:
+ *
+ *    cat /dev/profiler > /dev/ttyS1
+ *    flamegraph.pl prof.folded > prof.svg    (on the host)
+ *
+ * NOTE: /dev/profiler returns only whole lines (one per sample) and its file
+ * position counts the samples read so far, not the bytes. After a reset, open
+ * readers restart from the first sample of the new session.
+ */
+
+#define PROF_MAX_SAMPLES                        4096
+#define PROF_MAX_FRAMES                            7
+
+struct prof_sample {
+
+   u32 n_frames;                   /* 0 for samples taken in user mode */
+   ulong frames[PROF_MAX_FRAMES];  /* frames[0] is the interrupted IP */
+};
+
+struct prof_func_stats {
+
+   const char *name;               /* NULL for the user-mode samples */
+   ulong vaddr;
+   u32 self;                       /* samples with the IP in the function */
+   u32 total;                      /* samples with the function in the stack */
+};
+
+struct prof_stats {
+
+   u32 samples;
+   u32 lost;
+   u32 user;
+   u32 unknown;                    /* IP not in any known kernel function */
+};
+
+static ALWAYS_INLINE bool
+profiler_is_enabled(void)
+{
+   extern bool __profiler_on;
+   return __profiler_on;
+}
+
+void init_profiler(void);
+void profiler_record_sample(regs_t *r);
+
+int profiler_start(void);
+void profiler_stop(void);
+void profiler_reset(void);
+
+int
+profiler_get_top_funcs(struct prof_stats *s,
+                       struct prof_func_stats *funcs,
+                       int max_funcs);
+
+#define profiler_tick(r)                                                       \
+   if (MOD_tracing && profiler_is_enabled()) {                                 \
+      profiler_record_sample(r);                                               \
+   }
@@ -0,0 +1,106 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/mods/tracing.h>
+
+/*
+ * Binary trace export format
+ * -----------------------------
+ *
+ * Reading /dev/tracing returns a stream made of:
+ *
+ *    1. One `struct trace_export_header`
+ *    2. `sys_info_count` times `struct trace_export_sys_info`, one per syscall
+ *       known to the kernel, describing its name and its parameters.
+ *    3. Any number of raw `struct trace_event` records, `event_size` bytes
+ *       each, as produced by the tracing module.
+ *
+ * All the integers are in the machine's byte order (little endian on x86) and
+ * all the strings are NUL-padded. On 32-bit machines (word_size == 4), the
+ * layout of `struct trace_event` is:
+ *
+ *    offset  size  field
+ *         0     4  type (1 = syscall enter, 2 = syscall exit)
+ *         4     4  tid
+ *         8     8  sys_time (nanoseconds since boot)
+ *        16     4  sys (syscall number)
+ *        20     4  retval
+ *        24    24  args[6]
+ *        48     -  param slots: their offsets and sizes within the event
+ *                  are listed in the header, for each format (fmt 0, fmt 1).
+ *
+ * The data saved for a parameter (e.g. a path) is stored in the slot
+ * `params[i].slot` of the format `fmt` of its syscall. Parameters having
+ * slot == -1 have no saved data: their value is just `args[i]`.
+ *
+ * Events are consumed by the reader, exactly like in the debug panel's tracing
+ * screen: only one consumer at a time makes sense. When the trace buffer is
+ * full, events are dropped (see tracing_get_dropped_events_count()).
+ *
+ * The scripts/dev/decode_trace script turns such a stream into text or into a
+ * Chrome trace (JSON) file.
+ */
+
+#define TRACE_EXPORT_MAGIC                    "TILCKTRC"
+#define TRACE_EXPORT_VERSION                           1
+
+#define TRACE_EXPORT_SYS_NAME_LEN                     32
+#define TRACE_EXPORT_PARAM_NAME_LEN                   16
+
+/* trace_export_param's flags */
+#define TRACE_EXPORT_PFL_REAL_SZ_IN_RET         (1 << 0)
+#define TRACE_EXPORT_PFL_INVISIBLE              (1 << 1)
+
+struct trace_export_header {
+
+   char magic[8];                    /* TRACE_EXPORT_MAGIC, not NUL-term. */
+   u32 version;                      /* TRACE_EXPORT_VERSION */
+   u32 header_size;                  /* sizeof(struct trace_export_header) */
+   u32 sys_info_size;                /* sizeof(struct trace_export_sys_info) */
+   u32 sys_info_count;
+   u32 event_size;                   /* sizeof(struct trace_event) */
+   u32 word_size;                    /* sizeof(ulong) */
+
+   u16 slot_offsets[2][4];           /* [fmt][slot] -> offset in the event */
+   u16 slot_sizes[2][4];             /* [fmt][slot] -> size, 0 if invalid */
+};
+
+struct trace_export_param {
+
+   char name[TRACE_EXPORT_PARAM_NAME_LEN];
+   char type[TRACE_EXPORT_PARAM_NAME_LEN];   /* sys_param_type's name */
+
+   s8 slot;                                  /* NO_SLOT if no data saved */
+   u8 kind;                                  /* enum sys_param_kind */
+   s8 helper_idx;                            /* size param's index or -1 */
+   u8 flags;                                 /* TRACE_EXPORT_PFL_* */
+};
+
+struct trace_export_sys_info {
+
+   u32 sys_n;
+   s8 n_params;                       /* -1 if there's no metadata */
+   u8 exp_block;
+   u8 fmt;
+   u8 unused;
+
+   char name[TRACE_EXPORT_SYS_NAME_LEN];     /* without the "sys_" prefix */
+   char ret_type[TRACE_EXPORT_PARAM_NAME_LEN];
+   struct trace_export_param params[6];
+};
+
+STATIC_ASSERT(sizeof(struct trace_export_header) == 64);
+STATIC_ASSERT(sizeof(struct trace_export_param) == 36);
+STATIC_ASSERT(sizeof(struct trace_export_sys_info) == 272);
+
+void
+init_tracing_export(void);
+
+void
+tracing_get_slots_layout(u16 offsets[2][4], u16 sizes[2][4]);
+
+s8
+tracing_get_syscall_fmt(u32 sys_n);
+
+s8
+tracing_get_param_slot(u32 sys_n, int p_idx);
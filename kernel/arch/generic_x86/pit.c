@@ -32,6 +32,18 @@
 
 #define PIT_READ_BACK   0b11000000   // read-back command (8254 only)
 
+#define PIT_RB_NO_COUNT 0b00100000   // read-back: don't latch the count
+#define PIT_RB_NO_STAT  0b00010000   // read-back: don't latch the status
+#define PIT_RB_CH0      0b00000010   // read-back: select channel 0
+
+#define PIT_STAT_OUT    0b10000000   // status byte: state of the OUT pin
+#define PIT_STAT_NULL   0b01000000   // status byte: count not loaded yet
+
+#define PIT_MAX_COUNT        65535
+
+static u32 pit_divisor;              /* PIT counts per tick */
+static u32 pit_oneshot_count;        /* Initial count of the last one-shot */
+
 /*
  * Set the time between ticks to be `interval`, where 1 means 1/TS_SCALE sec.
  * Typically, TS_SCALE = 1,000,000,000 which means `interval` is expected to be
@@ -45,7 +57,7 @@ u32 hw_timer_setup(u32 interval)
    const u32 divisor = PIT_FREQ / hz;
    u64 actual_interval;
 
-   ASSERT(IN_RANGE_INC(hz, 18, 1000));
+   ASSERT(IN_RANGE_INC(hz, 19, 1000));   /* PIT_FREQ / 18 > PIT_MAX_COUNT */
 
    /*
     * Actual interval calculation.
@@ -78,9 +90,116 @@ u32 hw_timer_setup(u32 interval)
    actual_interval /= PIT_FREQ;
    ASSERT(actual_interval < UINT32_MAX);
 
-   outb(PIT_CMD_PORT, PIT_MODE_BIN | PIT_MODE_2 | PIT_ACC_LOHI | PIT_CH0);
-   outb(PIT_CH0_PORT, divisor & 0xff);            /* Set low byte of divisor */
-   outb(PIT_CH0_PORT, (divisor >> 8) & 0xff);     /* Set high byte of divisor */
-
+   pit_divisor = divisor;
+   hw_timer_set_periodic();
    return (u32)actual_interval;
 }
+
+static void pit_ch0_set_mode_and_count(u8 mode, u32 count)
+{
+   ASSERT(IN_RANGE_INC(count, 1, PIT_MAX_COUNT));
+
+   outb(PIT_CMD_PORT, PIT_MODE_BIN | mode | PIT_ACC_LOHI | PIT_CH0);
+   outb(PIT_CH0_PORT, count & 0xff);              /* Set low byte of count */
+   outb(PIT_CH0_PORT, (count >> 8) & 0xff);       /* Set high byte of count */
+}
+
+static u32 pit_ch0_read_count(void)
+{
+   u32 lo, hi;
+   outb(PIT_CMD_PORT, PIT_CH0);                   /* Counter latch command */
+   lo = inb(PIT_CH0_PORT);
+   hi = inb(PIT_CH0_PORT);
+   return lo | (hi << 8);
+}
+
+/* Latch both the status and the count with a single read-back command */
+static u32 pit_ch0_read_status_and_count(u8 *status)
+{
+   u32 lo, hi;
+   outb(PIT_CMD_PORT, PIT_READ_BACK | PIT_RB_CH0);
+   *status = inb(PIT_CH0_PORT);
+   lo = inb(PIT_CH0_PORT);
+   hi = inb(PIT_CH0_PORT);
+   return lo | (hi << 8);
+}
+
+/* (Re)start the periodic mode, with one IRQ every tick */
+void hw_timer_set_periodic(void)
+{
+   pit_ch0_set_mode_and_count(PIT_MODE_2, pit_divisor);
+}
+
+u32 hw_timer_max_oneshot_ticks(void)
+{
+   return PIT_MAX_COUNT / pit_divisor;
+}
+
+/*
+ * Switch the timer to one-shot mode, making it to fire a single IRQ exactly at
+ * the `ticks`-th tick boundary from now, as if the periodic mode was kept but
+ * the first `ticks - 1` IRQs were skipped. That's essential in order to keep
+ * the ticks in phase with the real time: otherwise, we'd lose a fraction of
+ * tick at every switch.
+ *
+ * Must be called with interrupts disabled, in periodic mode.
+ */
+void hw_timer_set_oneshot(u32 ticks)
+{
+   u32 count;
+   ASSERT(!are_interrupts_enabled());
+   ASSERT(IN_RANGE_INC(ticks, 1, hw_timer_max_oneshot_ticks()));
+
+   /* In mode 2, the counter goes from `pit_divisor` down to 1 */
+   count = pit_ch0_read_count();
+   count = CLAMP(count, 1u, pit_divisor);
+
+   pit_oneshot_count = count + (ticks - 1) * pit_divisor;
+   pit_ch0_set_mode_and_count(PIT_MODE_0, pit_oneshot_count);
+}
+
+/*
+ * In mode 0, the OUT pin goes high when the counter reaches 0 and stays high
+ * until a new count is written.
+ */
+bool hw_timer_oneshot_fired(void)
+{
+   outb(PIT_CMD_PORT, PIT_READ_BACK | PIT_RB_NO_COUNT | PIT_RB_CH0);
+   return !!(inb(PIT_CH0_PORT) & PIT_STAT_OUT);
+}
+
+/*
+ * Cut short a one-shot timer started with hw_timer_set_oneshot(ticks), which
+ * did not fire yet: re-arm it to fire at the very next tick boundary and return
+ * the number of whole ticks elapsed so far.
+ *
+ * Must be called with interrupts disabled.
+ */
+u32 hw_timer_oneshot_cut(u32 ticks)
+{
+   u32 rem, left;
+   u8 status;
+   ASSERT(!are_interrupts_enabled());
+
+   /*
+    * The one-shot might reach the terminal count at any moment, even after the
+    * caller checked hw_timer_oneshot_fired(): in that case, the counter wraps
+    * around and keeps counting down from 0xFFFF. Therefore, latch the count
+    * together with the state of the OUT pin and also treat any count greater
+    * than the initial one as "already fired".
+    */
+   rem = pit_ch0_read_status_and_count(&status);
+
+   if (status & PIT_STAT_NULL)
+      rem = pit_oneshot_count; /* The count has not been loaded yet */
+
+   if ((status & PIT_STAT_OUT) || !rem || rem > pit_oneshot_count)
+      return ticks - 1; /* The counter reached 0: the IRQ is coming */
+
+   /* Number of whole ticks left after the next tick boundary */
+   left = (rem - 1) / pit_divisor;
+   ASSERT(left < ticks);
+
+   pit_ch0_set_mode_and_count(PIT_MODE_0, rem - left * pit_divisor);
+   return ticks - 1 - left;
+}
@@ -4,6 +4,7 @@
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
 
 #include <tilck/kernel/syscalls.h>
 #include <tilck/kernel/irq.h>
@@ -15,6 +16,8 @@
 #include <tilck/kernel/user.h>
 #include <tilck/kernel/elf_utils.h>
 #include <tilck/kernel/signal.h>
+#include <tilck/kernel/vdso.h>
+#include <tilck/kernel/latency.h>
 #include <tilck/mods/tracing.h>
 
 #include "idt_int.h"
@@ -23,6 +26,11 @@ void syscall_int80_entry(void);
 void sysenter_entry(void);
 void asm_sysenter_setup(void);
 
+extern char vsdo_like_page[PAGE_SIZE];
+extern char vdso_clock_gettime[], vdso_clock_gettime_end[];
+extern char vdso_gettimeofday[], vdso_gettimeofday_end[];
+extern char vdso_time[], vdso_time_end[];
+
 typedef long (*syscall_type)();
 
 // The syscall numbers are ARCH-dependent
@@ -499,6 +507,7 @@ void handle_syscall(regs_t *r)
 
    const u32 sn = r->eax;
    syscall_type fptr;
+   u64 start;
 
    if (sn >= ARRAY_SIZE(syscalls) || !syscalls[sn]) {
       printk("Unknown syscall #%i\n", sn);
@@ -516,7 +525,9 @@ void handle_syscall(regs_t *r)
          trace_sys_enter(sn,r->ebx,r->ecx,r->edx,r->esi,r->edi,r->ebp);
 
       *(void **)(&fptr) = syscalls[sn];
+      start = RDTSC();
       r->eax = (u32) fptr(r->ebx,r->ecx,r->edx,r->esi,r->edi,r->ebp);
+      lat_syscall_add(sn, RDTSC() - start);
 
       if (traced)
          trace_sys_exit(sn,r->eax,r->ebx,r->ecx,r->edx,r->esi,r->edi,r->ebp);
@@ -528,6 +539,32 @@ void handle_syscall(regs_t *r)
    set_current_task_in_user_mode();
 }
 
+static void setup_vdso_func(u32 off, char *begin, char *end)
+{
+   const size_t size = (size_t)(end - begin);
+
+   VERIFY(size <= VDSO_FUNC_MAX_SIZE);
+   memcpy(vsdo_like_page + off, begin, size);
+}
+
+/*
+ * Copy the user-callable vdso functions (see vdso.S) in the vdso-like page,
+ * after the sysexit code copied there by asm_sysenter_setup().
+ */
+static void setup_vdso_code(void)
+{
+   setup_vdso_func(VDSO_CLOCK_GETTIME_OFF,
+                   vdso_clock_gettime, vdso_clock_gettime_end);
+
+   setup_vdso_func(VDSO_GETTIMEOFDAY_OFF,
+                   vdso_gettimeofday, vdso_gettimeofday_end);
+
+   setup_vdso_func(VDSO_TIME_OFF,
+                   vdso_time, vdso_time_end);
+
+   init_vdso_data(vsdo_like_page);
+}
+
 void init_syscall_interfaces(void)
 {
    /* Set the entry for the int 0x80 syscall interface */
@@ -541,5 +578,6 @@ void init_syscall_interfaces(void)
    wrmsr(MSR_IA32_SYSENTER_EIP, (ulong) &sysenter_entry);
 
    asm_sysenter_setup();
+   setup_vdso_code();
 }
 
@@ -7,6 +7,7 @@
 #include <tilck/kernel/interrupts.h>
 #include <tilck/kernel/fault_resumable.h>
 #include <tilck/kernel/process.h>
+#include <tilck/kernel/latency.h>
 
 #include "idt_int.h"
 
@@ -119,6 +120,7 @@ static void fault_in_panic(regs_t *r)
 void handle_fault(regs_t *r)
 {
    const int int_num = r->int_num;
+   u64 start = 0;
    VERIFY(is_fault(int_num));
 
    if (UNLIKELY(in_panic()))
@@ -127,6 +129,7 @@ void handle_fault(regs_t *r)
    if (LIKELY(int_num == FAULT_PAGE_FAULT)) {
 
       bool was_cow;
+      start = RDTSC();
 
       enable_interrupts_forced();
       {
@@ -134,8 +137,10 @@ void handle_fault(regs_t *r)
       }
       disable_interrupts_forced();
 
-      if (was_cow)
+      if (was_cow) {
+         lat_hist_add(&lat_page_fault_hist, RDTSC() - start);
          return;
+      }
    }
 
    if (is_fault_resumable(int_num))
@@ -145,6 +150,10 @@ void handle_fault(regs_t *r)
 
       fault_handlers[int_num](r);
 
+      /* NOTE: faults ending with a signal (e.g. SIGSEGV) never get here */
+      if (int_num == FAULT_PAGE_FAULT)
+         lat_hist_add(&lat_page_fault_hist, RDTSC() - start);
+
    } else {
 
       panic("Unhandled fault #%i: %s [err: %p] EIP: %p",
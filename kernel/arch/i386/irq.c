@@ -11,6 +11,7 @@
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/worker_thread.h>
 #include <tilck/kernel/timer.h>
+#include <tilck/kernel/latency.h>
 
 #include "idt_int.h"
 #include "pic.h"
@@ -123,6 +124,7 @@ void arch_irq_handling(regs_t *r)
    enum irq_action hret = IRQ_NOT_HANDLED;
    const int irq = r->int_num - 32;
    struct irq_handler_node *pos;
+   u64 start;
 
    ASSERT(!are_interrupts_enabled());
    ASSERT(!is_preemption_enabled());
@@ -132,6 +134,7 @@ void arch_irq_handling(regs_t *r)
       return;
    }
 
+   start = RDTSC();
    push_nested_interrupt(r->int_num);
    handle_irq_set_mask_and_eoi(irq);
    enable_interrupts_forced();
@@ -150,6 +153,7 @@ void arch_irq_handling(regs_t *r)
    disable_interrupts_forced();
    handle_irq_clear_mask(irq);
    pop_nested_interrupt();
+   lat_hist_add(&lat_irq_hists[irq], RDTSC() - start);
 }
 
 int get_irq_num(regs_t *context)
@@ -38,6 +38,15 @@
  */
 #define PAGE_SHARED                            (1 << 1)
 
+/*
+ * When this flag is set in the 'avail' bits of an user page directory entry,
+ * it means that its page table is shared with other page directories (see
+ * pdir_clone()) and, therefore, it has to be copied before changing any of its
+ * entries. Such pdir entries are always read-only, while the ref-count of the
+ * page table's pageframe is the number of page directories sharing it.
+ */
+#define PDE_SHARED_PT                          (1 << 0)
+
 
 /* ---------------------------------------------- */
 
@@ -134,10 +143,119 @@ void invalidate_page(ulong vaddr)
    invalidate_page_hw(vaddr);
 }
 
+/* Debug counters */
+u32 cow_faults_count;
+u32 cow_page_copies_count;
+u32 shared_pt_copies_count;
+
+/*
+ * Mark all the non-shared pages in the page table `pt` as COW and increase
+ * their ref-count, because a new copy of `pt` is going to be created.
+ */
+static void pt_prepare_for_copy(page_table_t *pt)
+{
+   for (u32 j = 0; j < 1024; j++) {
+
+      page_t *const p = &pt->pages[j];
+
+      if (!p->present)
+         continue;
+
+      const ulong orig_paddr = (ulong)p->pageAddr << PAGE_SHIFT;
+
+      /* Sanity-check: a mapped page MUST have ref-count > 0 */
+      ASSERT(pf_ref_count_get(orig_paddr) > 0);
+
+      if (!(p->avail & PAGE_SHARED)) {
+
+         if (p->rw)
+            p->avail |= PAGE_COW_ORIG_RW;
+
+         p->rw = false;
+      }
+
+      pf_ref_count_inc(orig_paddr);
+   }
+}
+
+/*
+ * Make the page table at `pd_index` private to `pdir`. If other page
+ * directories are still using it, copy it, exactly as pdir_clone() would have
+ * done at fork time without page table sharing. Otherwise, we're the last user
+ * of it: just make the pdir entry writable again.
+ */
+static int pdir_unshare_page_table(pdir_t *pdir, u32 pd_index)
+{
+   page_dir_entry_t *const e = &pdir->entries[pd_index];
+   page_table_t *const pt = pdir_get_page_table(pdir, pd_index);
+   const ulong pt_paddr = KERNEL_VA_TO_PA(pt);
+
+   ASSERT(e->avail & PDE_SHARED_PT);
+   ASSERT(pf_ref_count_get(pt_paddr) > 0);
+
+   if (pf_ref_count_get(pt_paddr) > 1) {
+
+      page_table_t *new_pt = kalloc_obj(page_table_t);
+
+      if (UNLIKELY(!new_pt))
+         return -ENOMEM;
+
+      ASSERT(IS_PAGE_ALIGNED(new_pt));
+      pt_prepare_for_copy(pt);
+      memcpy32(new_pt, pt, sizeof(page_table_t) / 4);
+      e->ptaddr = SHR_BITS(KERNEL_VA_TO_PA(new_pt), PAGE_SHIFT, u32);
+      shared_pt_copies_count++;
+   }
+
+   pf_ref_count_dec(pt_paddr);
+   e->avail &= ~PDE_SHARED_PT;
+   e->rw = true;
+
+   /* Flush the whole TLB: it might contain read-only entries in that range */
+   if (pdir == get_curr_pdir())
+      set_curr_pdir(pdir);
+
+   return 0;
+}
+
+static ALWAYS_INLINE int pdir_own_page_table(pdir_t *pdir, u32 pd_index)
+{
+   if (LIKELY(!(pdir->entries[pd_index].avail & PDE_SHARED_PT)))
+      return 0;
+
+   if (pd_index >= KERNEL_BASE_PD_IDX)
+      return 0; /* Kernel page tables are never shared this way */
+
+   return pdir_unshare_page_table(pdir, pd_index);
+}
+
+/*
+ * Copy a whole page, using the FPU (SSE/AVX) when possible. Note: `src` is the
+ * user space address of the shared (read-only) page, which is still mapped
+ * there, while `dest` is a regular kernel address, in the linear mapping.
+ * Therefore, no temporary buffer is needed.
+ */
+static void cow_copy_page(void *dest, void *src)
+{
+   if (x86_cpu_features.can_use_sse && !in_irq()) {
+
+      fpu_context_begin();
+      {
+         fpu_memcpy256(dest, src, PAGE_SIZE / 32);
+      }
+      fpu_context_end();
+
+   } else {
+
+      memcpy32(dest, src, PAGE_SIZE / 4);
+   }
+}
+
 bool handle_potential_cow(void *context)
 {
    regs_t *r = context;
    u32 vaddr;
+   bool ret = true;
 
    if ((r->err_code & PAGE_FAULT_FL_COW) != PAGE_FAULT_FL_COW)
       return false;
@@ -147,30 +265,50 @@ bool handle_potential_cow(void *context)
    const u32 pt_index = (vaddr >> PAGE_SHIFT) & 1023;
    const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
    void *const page_vaddr = (void *)(vaddr & PAGE_MASK);
-   page_table_t *pt = pdir_get_page_table(get_curr_pdir(), pd_index);
+   pdir_t *const pdir = get_curr_pdir();
+   page_table_t *pt;
 
-   if (!(pt->pages[pt_index].avail & PAGE_COW_ORIG_RW))
-      return false; /* Not a COW page */
+   /*
+    * Keep the preemption disabled while checking and altering the ref-count of
+    * the original pageframe: otherwise, the other process(es) sharing it might
+    * release it while we're copying it.
+    */
+   disable_preemption();
+
+   if (pd_index < KERNEL_BASE_PD_IDX &&
+       (pdir->entries[pd_index].avail & PDE_SHARED_PT))
+   {
+      if (pdir_unshare_page_table(pdir, pd_index) < 0)
+         panic("Out-of-memory: unable to copy a page table. No OOM killer.");
+
+      pt = pdir_get_page_table(pdir, pd_index);
+
+      if (pt->pages[pt_index].rw)
+         goto out; /* The page was writable: only the PDE was read-only */
+   }
+
+   pt = pdir_get_page_table(pdir, pd_index);
+
+   if (!(pt->pages[pt_index].avail & PAGE_COW_ORIG_RW)) {
+      ret = false; /* Not a COW page */
+      goto out;
+   }
 
    const u32 orig_page_paddr = (u32)
       pt->pages[pt_index].pageAddr << PAGE_SHIFT;
 
+   cow_faults_count++;
+
    if (pf_ref_count_get(orig_page_paddr) == 1) {
 
       /* This page is not shared anymore. No need for copying it. */
       pt->pages[pt_index].rw = true;
       pt->pages[pt_index].avail = 0;
       invalidate_page_hw(vaddr);
-      return true;
+      goto out;
    }
 
-   // Decrease the ref-count of the original pageframe.
-   pf_ref_count_dec(orig_page_paddr);
-
-   // Copy the whole page to our temporary buffer.
-   memcpy32(page_size_buf, page_vaddr, PAGE_SIZE / 4);
-
-   // Allocate and set a new page.
+   // Allocate a new page.
    void *new_page_vaddr = kmalloc(PAGE_SIZE);
 
    if (!new_page_vaddr)
@@ -178,6 +316,13 @@ bool handle_potential_cow(void *context)
 
    ASSERT(IS_PAGE_ALIGNED(new_page_vaddr));
 
+   // Copy the page directly from the original pageframe to the new one.
+   cow_copy_page(new_page_vaddr, page_vaddr);
+   cow_page_copies_count++;
+
+   // Decrease the ref-count of the original pageframe.
+   pf_ref_count_dec(orig_page_paddr);
+
    const ulong paddr = KERNEL_VA_TO_PA(new_page_vaddr);
 
    /* Sanity-check: a newly allocated pageframe MUST have ref-count == 0 */
@@ -190,9 +335,9 @@ bool handle_potential_cow(void *context)
 
    invalidate_page_hw(vaddr);
 
-   // Copy back the page.
-   memcpy32(page_vaddr, page_size_buf, PAGE_SIZE / 4);
-   return true;
+out:
+   enable_preemption();
+   return ret;
 }
 
 static void kernel_page_fault_panic(regs_t *r, u32 vaddr, bool rw, bool p)
@@ -318,6 +463,9 @@ void set_page_rw(pdir_t *pdir, void *vaddrp, bool rw)
    const u32 pt_index = (vaddr >> PAGE_SHIFT) & 1023;
    const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
 
+   if (pdir_own_page_table(pdir, pd_index) < 0)
+      panic("Out-of-memory: unable to copy a page table. No OOM killer.");
+
    pt = KERNEL_PA_TO_VA(pdir->entries[pd_index].ptaddr << PAGE_SHIFT);
    ASSERT(KERNEL_VA_TO_PA(pt) != 0);
    pt->pages[pt_index].rw = rw;
@@ -347,6 +495,16 @@ __unmap_page(pdir_t *pdir, void *vaddrp, bool free_pageframe, bool permissive)
       ASSERT(pt->pages[pt_index].present);
    }
 
+   if (pdir_own_page_table(pdir, pd_index) < 0) {
+
+      if (permissive)
+         return -ENOMEM;
+
+      panic("Out-of-memory: unable to copy a page table. No OOM killer.");
+   }
+
+   pt = KERNEL_PA_TO_VA(pdir->entries[pd_index].ptaddr << PAGE_SHIFT);
+
    const ulong paddr = (ulong)
       pt->pages[pt_index].pageAddr << PAGE_SHIFT;
 
@@ -486,6 +644,9 @@ map_page_int(pdir_t *pdir, void *vaddrp, ulong paddr, u32 hw_flags)
    ASSERT(!(vaddr & OFFSET_IN_PAGE_MASK)); // the vaddr must be page-aligned
    ASSERT(!(paddr & OFFSET_IN_PAGE_MASK)); // the paddr must be page-aligned
 
+   if (UNLIKELY(pdir_own_page_table(pdir, pd_index) < 0))
+      return -ENOMEM;
+
    pt = KERNEL_PA_TO_VA(pdir->entries[pd_index].ptaddr << PAGE_SHIFT);
    ASSERT(IS_PAGE_ALIGNED(pt));
 
@@ -692,6 +853,43 @@ map_pages(pdir_t *pdir,
                     (u32)((!us) << PG_GLOBAL_BIT_POS));
 }
 
+/*
+ * Share all the user page tables of `pdir` with `new_pdir`, instead of copying
+ * them: their pdir entries become read-only in both the page directories and
+ * each page table gets copied only on the first write or on the first change
+ * of its entries (see pdir_unshare_page_table()). That makes fork() + execve()
+ * much cheaper, as the child rarely touches more than few 4 MB regions.
+ */
+static void pdir_share_page_tables(pdir_t *pdir, pdir_t *new_pdir)
+{
+   for (u32 i = 0; i < KERNEL_BASE_PD_IDX; i++) {
+
+      page_dir_entry_t *const e = &pdir->entries[i];
+
+      /* User-space cannot use 4-MB pages */
+      ASSERT(!e->psize);
+
+      if (!e->present)
+         continue;
+
+      const ulong pt_paddr = e->ptaddr << PAGE_SHIFT;
+
+      if (!(e->avail & PDE_SHARED_PT)) {
+
+         /* Sanity-check: a private page table MUST have ref-count == 0 */
+         ASSERT(pf_ref_count_get(pt_paddr) == 0);
+
+         e->avail |= PDE_SHARED_PT;
+         e->rw = false;
+         pf_ref_count_inc(pt_paddr);
+      }
+
+      pf_ref_count_inc(pt_paddr);
+   }
+
+   memcpy32(new_pdir, pdir, sizeof(pdir_t) / 4);
+}
+
 pdir_t *pdir_clone(pdir_t *pdir)
 {
    pdir_t *new_pdir = kalloc_obj(pdir_t);
@@ -700,6 +898,12 @@ pdir_t *pdir_clone(pdir_t *pdir)
       return NULL;
 
    ASSERT(IS_PAGE_ALIGNED(new_pdir));
+
+   if (FORK_SHARE_PAGE_TABLES) {
+      pdir_share_page_tables(pdir, new_pdir);
+      return new_pdir;
+   }
+
    memcpy32(new_pdir, pdir, sizeof(pdir_t) / 4);
 
    for (u32 i = 0; i < KERNEL_BASE_PD_IDX; i++) {
@@ -715,8 +919,8 @@ pdir_t *pdir_clone(pdir_t *pdir)
       if (UNLIKELY(!pt)) {
 
          for (; i > 0; i--) {
-            if (pdir->entries[i - 1].present)
-               kfree_obj(pdir_get_page_table(pdir, i - 1), page_table_t);
+            if (new_pdir->entries[i - 1].present)
+               kfree_obj(pdir_get_page_table(new_pdir, i - 1), page_table_t);
          }
 
          kfree_obj(new_pdir, pdir_t);
@@ -736,28 +940,7 @@ pdir_t *pdir_clone(pdir_t *pdir)
       page_table_t *new_pt = pdir_get_page_table(new_pdir, i);
 
       /* Mark all the non-shared pages in that page-table as COW. */
-      for (u32 j = 0; j < 1024; j++) {
-
-         page_t *const p = &orig_pt->pages[j];
-
-         if (!p->present)
-            continue;
-
-         const ulong orig_paddr = (ulong)p->pageAddr << PAGE_SHIFT;
-
-         /* Sanity-check: a mapped page MUST have ref-count > 0 */
-         ASSERT(pf_ref_count_get(orig_paddr) > 0);
-
-         if (!(p->avail & PAGE_SHARED)) {
-
-            if (p->rw)
-               p->avail |= PAGE_COW_ORIG_RW;
-
-            p->rw = false;
-         }
-
-         pf_ref_count_inc(orig_paddr);
-      }
+      pt_prepare_for_copy(orig_pt);
 
       // copy the page table
       memcpy(new_pt, orig_pt, sizeof(page_table_t));
@@ -792,6 +975,10 @@ pdir_deep_clone(pdir_t *pdir)
       if (!pdir->entries[i].present)
          continue;
 
+      /* The new pdir entry will point to a private page table */
+      new_pdir->entries[i].avail &= ~PDE_SHARED_PT;
+      new_pdir->entries[i].rw = true;
+
       page_table_t *orig_pt = pdir_get_page_table(pdir, i);
       page_table_t *new_pt = kmalloc_accelerator_get_elem(&acc);
 
@@ -860,6 +1047,13 @@ void pdir_destroy(pdir_t *pdir)
 
       page_table_t *pt = pdir_get_page_table(pdir, i);
 
+      if (pdir->entries[i].avail & PDE_SHARED_PT) {
+
+         /* Other pdirs are still using this page table: just drop our ref */
+         if (pf_ref_count_dec(KERNEL_VA_TO_PA(pt)) > 0)
+            continue;
+      }
+
       for (u32 j = 0; j < 1024; j++) {
 
          if (!pt->pages[j].present)
@@ -11,6 +11,7 @@
 #include <tilck/kernel/syscalls.h>
 #include <tilck/kernel/hal.h>
 #include <tilck/kernel/sched.h>
+#include <tilck/kernel/vdso.h>
 
 #define FULL_RESYNC_MAX_ATTEMPTS       10
 
@@ -404,6 +405,7 @@ void init_system_time(void)
       panic("Invalid boot-time UNIX timestamp: %d\n", boot_timestamp);
 
    __time_ns = 0;
+   vdso_set_boot_timestamp(boot_timestamp);
 }
 
 u64 get_sys_time(void)
@@ -436,10 +438,27 @@ void real_time_get_timespec(struct k_timespec64 *tp)
       tp->tv_nsec = (t % TS_SCALE) / (TS_SCALE / BILLION);
 }
 
+static void ns_to_timespec(u64 ns, struct k_timespec64 *tp)
+{
+   tp->tv_sec = (s64)(ns / BILLION);
+   tp->tv_nsec = (long)(ns % BILLION);
+}
+
 void monotonic_time_get_timespec(struct k_timespec64 *tp)
 {
-   /* Same as the real_time clock, for the moment */
-   real_time_get_timespec(tp);
+   if (!tsc_clock_enabled()) {
+      /* Same as the real_time clock */
+      real_time_get_timespec(tp);
+      return;
+   }
+
+   /*
+    * The TSC clocksource counts from the same origin as the system time, but
+    * it's not affected by the drift adjustments: keep the boot timestamp as
+    * offset, like for the tick-based case.
+    */
+   ns_to_timespec(tsc_clock_get_ns(), tp);
+   tp->tv_sec += boot_timestamp;
 }
 
 static void
@@ -447,6 +466,19 @@ task_cpu_get_timespec(struct k_timespec64 *tp)
 {
    struct task *ti = get_curr_task();
 
+   if (tsc_clock_enabled()) {
+
+      u64 cycles;
+
+      disable_preemption();
+      {
+         cycles = ti->ticks.cycles + (RDTSC() - ti->ticks.cycles_start);
+      }
+      enable_preemption();
+      ns_to_timespec(tsc_cycles_to_ns(cycles), tp);
+      return;
+   }
+
    disable_preemption();
    {
       const u64 tot = ti->ticks.total * __tick_duration;
@@ -489,6 +521,15 @@ int sys_gettimeofday(struct timeval *user_tv, struct timezone *user_tz)
    return 0;
 }
 
+/* Convert a (valid) time interval to timer ticks, rounding up */
+u64 timespec_to_ticks(const struct k_timespec64 *ts)
+{
+   const u32 ns_per_tick = BILLION / TIMER_HZ;
+
+   return (u64)ts->tv_sec * TIMER_HZ +
+          ((u32)ts->tv_nsec + ns_per_tick - 1) / ns_per_tick;
+}
+
 int
 do_clock_gettime(clockid_t clk_id, struct k_timespec64 *tp)
 {
@@ -523,14 +564,27 @@ do_clock_getres(clockid_t clk_id, struct k_timespec64 *res)
 {
    switch (clk_id) {
 
-      case CLOCK_REALTIME:
-      case CLOCK_REALTIME_COARSE:
       case CLOCK_MONOTONIC:
       case CLOCK_MONOTONIC_COARSE:
       case CLOCK_MONOTONIC_RAW:
       case CLOCK_PROCESS_CPUTIME_ID:
       case CLOCK_THREAD_CPUTIME_ID:
 
+         if (tsc_clock_enabled()) {
+
+            *res = (struct k_timespec64) {
+               .tv_sec = 0,
+               .tv_nsec = 1,
+            };
+
+            break;
+         }
+
+         /* fall-through */
+
+      case CLOCK_REALTIME:
+      case CLOCK_REALTIME_COARSE:
+
          *res = (struct k_timespec64) {
             .tv_sec = 0,
             .tv_nsec = BILLION/TIMER_HZ,
@@ -621,7 +675,7 @@ int sys_clock_getres(clockid_t clk_id, struct k_timespec64 *user_res)
    if (!user_res)
       return -EINVAL;
 
-   if ((rc = do_clock_gettime(clk_id, &tp)))
+   if ((rc = do_clock_getres(clk_id, &tp)))
       return rc;
 
    if (copy_to_user(user_res, &tp, sizeof(tp)) < 0)
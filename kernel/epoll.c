@@ -0,0 +1,578 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/syscalls.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/bintree.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/epoll.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/kernelfs.h>
+
+/*
+ * epoll
+ * ---------
+ *
+ * Unlike poll() and select(), which attach the calling task to the kconds of
+ * all the watched handles on every call, an epoll object attaches persistent
+ * kcond watchers (see kcond_add_watcher()) to the rready/wready/except kconds
+ * of each registered handle, once, at EPOLL_CTL_ADD time. When one of those
+ * kconds is signaled, the watcher callback just moves the item in the epoll's
+ * ready list and wakes up the tasks in epoll_wait(). Therefore, epoll_wait()
+ * checks only the items in the ready list and costs O(ready), not O(watched).
+ *
+ * Being signaled does not mean being ready: the ready list contains just
+ * *candidates*, whose actual state is checked with vfs_read_ready() & co.
+ * In level-triggered mode, the items reported as ready are put back in the
+ * ready list, in order to be checked again by the next epoll_wait() call.
+ *
+ * Items are keyed by their fs_handle: because closing a handle has to remove
+ * its items from all the epoll objects (see epoll_on_handle_close()), all the
+ * epoll objects are kept in a global list.
+ *
+ * Locking: the items tree is protected by epoll's mutex, while the ready list
+ * is protected by disabling the preemption, as the watcher callbacks are
+ * called by kcond_signal_int() with preemption disabled. Lock order:
+ * process' fslock -> epoll_list_mutex -> epoll's mutex.
+ */
+
+#define EPOLL_W_READ             0
+#define EPOLL_W_WRITE            1
+#define EPOLL_W_EXCEPT           2
+
+#define EPOLL_MAX_EVENTS         (INT_MAX / (int)sizeof(struct epoll_event))
+
+struct epoll;
+
+struct epoll_item {
+
+   struct bintree_node node;
+   fs_handle h;                     /* key */
+   struct epoll *ep;
+   struct epoll_event event;
+   bool disabled;                   /* EPOLLONESHOT item already reported */
+
+   struct list_node ready_node;     /* node in ep->ready_list */
+   struct kcond_watcher watchers[3];
+};
+
+struct epoll {
+
+   KOBJ_BASE_FIELDS
+
+   struct list_node node;           /* node in `epoll_list` */
+   struct kmutex mutex;
+   struct kcond cond;               /* signaled when an item becomes ready */
+   struct list ready_list;
+   struct epoll_item *items;        /* bintree root */
+};
+
+static struct kmutex epoll_list_mutex = STATIC_KMUTEX_INIT(epoll_list_mutex, 0);
+static struct list epoll_list = STATIC_LIST_INIT(epoll_list);
+
+static struct kmem_cache epoll_item_cache =
+   STATIC_KMEM_CACHE_INIT(epoll_item_cache,
+                          "epoll_item",
+                          sizeof(struct epoll_item));
+
+static const struct file_ops static_ops_epoll;
+
+static inline bool is_epoll_handle(fs_handle h)
+{
+   return ((struct fs_handle_base *)h)->fops == &static_ops_epoll;
+}
+
+static inline struct epoll *get_epoll(fs_handle h)
+{
+   return (void *)((struct kfs_handle *)h)->kobj;
+}
+
+/* Called with preemption disabled */
+static void epoll_item_queue(struct epoll_item *it)
+{
+   ASSERT(!is_preemption_enabled());
+
+   if (list_is_node_in_list(&it->ready_node))
+      return; /* already queued */
+
+   list_add_tail(&it->ep->ready_list, &it->ready_node);
+   kcond_signal_all(&it->ep->cond);
+}
+
+static void epoll_watcher_cb(struct kcond_watcher *w)
+{
+   epoll_item_queue(w->arg);
+}
+
+static void epoll_item_attach(struct epoll_item *it)
+{
+   struct kcond *conds[3] = {
+      [EPOLL_W_READ] = NULL,
+      [EPOLL_W_WRITE] = NULL,
+      [EPOLL_W_EXCEPT] = vfs_get_except_cond(it->h),
+   };
+
+   if (it->event.events & EPOLLIN)
+      conds[EPOLL_W_READ] = vfs_get_rready_cond(it->h);
+
+   if (it->event.events & EPOLLOUT)
+      conds[EPOLL_W_WRITE] = vfs_get_wready_cond(it->h);
+
+   for (int i = 0; i < 3; i++) {
+      if (conds[i])
+         kcond_add_watcher(conds[i], &it->watchers[i], &epoll_watcher_cb, it);
+   }
+
+   /* Check the item at the next epoll_wait(), as it might be already ready */
+   disable_preemption();
+   {
+      epoll_item_queue(it);
+   }
+   enable_preemption();
+}
+
+static void epoll_item_detach(struct epoll_item *it)
+{
+   for (int i = 0; i < 3; i++) {
+      if (it->watchers[i].wobj.type == WOBJ_KCOND_WATCHER)
+         kcond_remove_watcher(&it->watchers[i]);
+   }
+
+   disable_preemption();
+   {
+      if (list_is_node_in_list(&it->ready_node))
+         list_remove(&it->ready_node);
+
+      list_node_init(&it->ready_node);
+   }
+   enable_preemption();
+}
+
+static void epoll_remove_item(struct epoll *ep, struct epoll_item *it)
+{
+   ASSERT(kmutex_is_curr_task_holding_lock(&ep->mutex));
+
+   epoll_item_detach(it);
+   bintree_remove_ptr(&ep->items, it, struct epoll_item, node, h);
+   kmem_cache_free(&epoll_item_cache, it);
+}
+
+static inline struct epoll_item *
+epoll_find_item(struct epoll *ep, fs_handle h)
+{
+   ASSERT(kmutex_is_curr_task_holding_lock(&ep->mutex));
+   return bintree_find_ptr(ep->items, h, struct epoll_item, node, h);
+}
+
+/* Remove `h` from all the epoll objects: it's going to be closed */
+void epoll_on_handle_close(fs_handle h)
+{
+   struct epoll *ep;
+   struct epoll_item *it;
+
+   if (list_is_empty(&epoll_list))
+      return; /* Fast path: no epoll objects at all */
+
+   kmutex_lock(&epoll_list_mutex);
+   {
+      list_for_each_ro(ep, &epoll_list, node) {
+
+         kmutex_lock(&ep->mutex);
+         {
+            if ((it = epoll_find_item(ep, h)))
+               epoll_remove_item(ep, it);
+         }
+         kmutex_unlock(&ep->mutex);
+      }
+   }
+   kmutex_unlock(&epoll_list_mutex);
+}
+
+static void destroy_epoll(struct epoll *ep)
+{
+   struct epoll_item *it;
+
+   kmutex_lock(&epoll_list_mutex);
+   {
+      list_remove(&ep->node);
+   }
+   kmutex_unlock(&epoll_list_mutex);
+
+   kmutex_lock(&ep->mutex);
+   {
+      while ((it = bintree_get_first_obj(ep->items, struct epoll_item, node)))
+         epoll_remove_item(ep, it);
+   }
+   kmutex_unlock(&ep->mutex);
+
+   kcond_destory(&ep->cond);
+   kmutex_destroy(&ep->mutex);
+   kfree_obj(ep, struct epoll);
+}
+
+static struct epoll *create_epoll(void)
+{
+   struct epoll *ep;
+
+   if (!(ep = kzalloc_obj(struct epoll)))
+      return NULL;
+
+   ep->destory_obj = (void *)&destroy_epoll;
+   kmutex_init(&ep->mutex, 0);
+   kcond_init(&ep->cond);
+   list_init(&ep->ready_list);
+
+   kmutex_lock(&epoll_list_mutex);
+   {
+      list_add_tail(&epoll_list, &ep->node);
+   }
+   kmutex_unlock(&epoll_list_mutex);
+   return ep;
+}
+
+static int epoll_read_ready(fs_handle h)
+{
+   struct epoll *ep = get_epoll(h);
+   bool ret;
+
+   disable_preemption();
+   {
+      ret = !list_is_empty(&ep->ready_list);
+   }
+   enable_preemption();
+   return ret;
+}
+
+static struct kcond *epoll_get_rready_cond(fs_handle h)
+{
+   return &get_epoll(h)->cond;
+}
+
+static const struct file_ops static_ops_epoll =
+{
+   .read_ready = epoll_read_ready,
+   .get_rready_cond = epoll_get_rready_cond,
+};
+
+static u32 epoll_item_revents(struct epoll_item *it)
+{
+   const u32 events = it->event.events;
+   u32 revents = 0;
+   int rc;
+
+   if (it->disabled)
+      return 0;
+
+   if ((events & EPOLLIN) && vfs_read_ready(it->h))
+      revents |= EPOLLIN;
+
+   if ((events & EPOLLOUT) && vfs_write_ready(it->h))
+      revents |= EPOLLOUT;
+
+   /* EPOLLERR and EPOLLHUP are always reported, as poll() does */
+   if ((rc = vfs_except_ready(it->h)))
+      revents |= rc > 0 ? (u32)rc : EPOLLERR;
+
+   return revents;
+}
+
+/*
+ * Check the items in the ready list, reporting the actually ready ones in
+ * the user buffer `u_events`. Returns the number of reported events or
+ * -EFAULT, if no event could be reported.
+ */
+static int
+epoll_collect_events(struct epoll *ep, struct epoll_event *u_events, int max)
+{
+   struct list requeue = STATIC_LIST_INIT(requeue);
+   struct epoll_item *it, *tmp;
+   struct epoll_event ev;
+   int n = 0;
+
+   ASSERT(kmutex_is_curr_task_holding_lock(&ep->mutex));
+
+   while (n < max) {
+
+      disable_preemption();
+      {
+         if (list_is_empty(&ep->ready_list)) {
+            enable_preemption();
+            break;
+         }
+
+         it = list_first_obj(&ep->ready_list, struct epoll_item, ready_node);
+         list_remove(&it->ready_node);
+         list_node_init(&it->ready_node);
+      }
+      enable_preemption();
+
+      if (!(ev.events = epoll_item_revents(it)))
+         continue; /* spurious: the item will be queued again when signaled */
+
+      ev.data = it->event.data;
+
+      if (copy_to_user(&u_events[n], &ev, sizeof(ev))) {
+
+         /* Keep the item in the ready list: we couldn't report the event */
+         disable_preemption();
+         {
+            epoll_item_queue(it);
+         }
+         enable_preemption();
+
+         if (!n)
+            n = -EFAULT;
+
+         break;
+      }
+
+      n++;
+
+      if (it->event.events & EPOLLONESHOT) {
+
+         /* Disabled until re-armed with EPOLL_CTL_MOD */
+         it->disabled = true;
+
+      } else if (!(it->event.events & EPOLLET)) {
+
+         /* Level-triggered: check it again at the next epoll_wait() */
+         disable_preemption();
+         {
+            list_add_tail(&requeue, &it->ready_node);
+         }
+         enable_preemption();
+      }
+   }
+
+   disable_preemption();
+   {
+      list_for_each(it, tmp, &requeue, ready_node) {
+         list_remove(&it->ready_node);
+         list_node_init(&it->ready_node);
+         list_add_tail(&ep->ready_list, &it->ready_node);
+      }
+   }
+   enable_preemption();
+   return n;
+}
+
+static int
+epoll_wait_int(struct epoll *ep,
+               struct epoll_event *u_events,
+               int maxevents,
+               int timeout)
+{
+   struct task *curr = get_curr_task();
+   u64 deadline = 0;
+   u64 now;
+   int rc;
+
+   if (timeout > 0)
+      deadline = get_ticks() + MAX(ms_to_ticks((u64)timeout), 1u);
+
+   kmutex_lock(&ep->mutex);
+
+   while (true) {
+
+      if ((rc = epoll_collect_events(ep, u_events, maxevents)))
+         break;
+
+      if (!timeout)
+         break;
+
+      if (pending_signals()) {
+         rc = -EINTR;
+         break;
+      }
+
+      now = get_ticks();
+
+      if (timeout > 0 && now >= deadline)
+         break;
+
+      disable_preemption();
+
+      if (!list_is_empty(&ep->ready_list)) {
+         enable_preemption();
+         continue;
+      }
+
+      prepare_to_wait_on(WOBJ_KCOND, &ep->cond, NO_EXTRA, &ep->cond.wait_list);
+
+      if (timeout > 0)
+         task_set_wakeup_timer(curr, (u32)(deadline - now));
+
+      kmutex_unlock(&ep->mutex);
+
+      /* Go to sleep until an item is queued, a timeout or a signal */
+      enter_sleep_wait_state();
+
+      /* In case of timeout or signal, we're still in the kcond's wait_list */
+      wait_obj_reset(&curr->wobj);
+      task_cancel_wakeup_timer(curr);
+      kmutex_lock(&ep->mutex);
+   }
+
+   kmutex_unlock(&ep->mutex);
+   return rc;
+}
+
+static int epoll_create_int(int flags)
+{
+   struct kfs_handle *h;
+   struct epoll *ep;
+   int fd;
+
+   if (flags & ~EPOLL_CLOEXEC)
+      return -EINVAL;
+
+   if (!(ep = create_epoll()))
+      return -ENOMEM;
+
+   if (!(h = kfs_create_new_handle(&static_ops_epoll, (void *)ep, O_RDONLY))) {
+      destroy_epoll(ep);
+      return -ENOMEM;
+   }
+
+   if ((fd = install_fs_handle(h, !!(flags & EPOLL_CLOEXEC))) < 0) {
+      kfs_destroy_handle(h);
+      destroy_epoll(ep);
+   }
+
+   return fd;
+}
+
+int sys_epoll_create(int size)
+{
+   if (size <= 0)
+      return -EINVAL;
+
+   return epoll_create_int(0);
+}
+
+int sys_epoll_create1(int flags)
+{
+   return epoll_create_int(flags);
+}
+
+static int
+epoll_ctl_add(struct epoll *ep, fs_handle h, struct epoll_event *ev)
+{
+   struct epoll_item *it;
+
+   if (epoll_find_item(ep, h))
+      return -EEXIST;
+
+   if (!vfs_get_rready_cond(h) &&
+       !vfs_get_wready_cond(h) &&
+       !vfs_get_except_cond(h))
+   {
+      /* Like Linux does for regular files: they're always ready */
+      return -EPERM;
+   }
+
+   if (!(it = kmem_cache_zalloc(&epoll_item_cache)))
+      return -ENOMEM;
+
+   bintree_node_init(&it->node);
+   list_node_init(&it->ready_node);
+   it->h = h;
+   it->ep = ep;
+   it->event = *ev;
+
+   bintree_insert_ptr(&ep->items, it, struct epoll_item, node, h);
+   epoll_item_attach(it);
+   return 0;
+}
+
+static int
+epoll_ctl_mod(struct epoll *ep, fs_handle h, struct epoll_event *ev)
+{
+   struct epoll_item *it;
+
+   if (!(it = epoll_find_item(ep, h)))
+      return -ENOENT;
+
+   epoll_item_detach(it);
+   it->event = *ev;
+   it->disabled = false;
+   epoll_item_attach(it);
+   return 0;
+}
+
+int sys_epoll_ctl(int epfd, int op, int fd, struct epoll_event *u_event)
+{
+   struct epoll_event ev;
+   struct epoll_item *it;
+   struct epoll *ep;
+   fs_handle eph, h;
+   int rc;
+
+   if (op != EPOLL_CTL_DEL) {
+      if (copy_from_user(&ev, u_event, sizeof(ev)))
+         return -EFAULT;
+   }
+
+   if (!(eph = get_fs_handle(epfd)) || !(h = get_fs_handle(fd)))
+      return -EBADF;
+
+   /* Nested epoll objects are not supported */
+   if (!is_epoll_handle(eph) || is_epoll_handle(h))
+      return -EINVAL;
+
+   ep = get_epoll(eph);
+   kmutex_lock(&ep->mutex);
+   {
+      switch (op) {
+
+         case EPOLL_CTL_ADD:
+            rc = epoll_ctl_add(ep, h, &ev);
+            break;
+
+         case EPOLL_CTL_MOD:
+            rc = epoll_ctl_mod(ep, h, &ev);
+            break;
+
+         case EPOLL_CTL_DEL:
+
+            if ((it = epoll_find_item(ep, h))) {
+               epoll_remove_item(ep, it);
+               rc = 0;
+            } else {
+               rc = -ENOENT;
+            }
+
+            break;
+
+         default:
+            rc = -EINVAL;
+      }
+   }
+   kmutex_unlock(&ep->mutex);
+   return rc;
+}
+
+int sys_epoll_wait(int epfd,
+                   struct epoll_event *u_events,
+                   int maxevents,
+                   int timeout)
+{
+   fs_handle eph;
+
+   if (maxevents <= 0 || maxevents > EPOLL_MAX_EVENTS)
+      return -EINVAL;
+
+   if (!(eph = get_fs_handle(epfd)))
+      return -EBADF;
+
+   if (!is_epoll_handle(eph))
+      return -EINVAL;
+
+   return epoll_wait_int(get_epoll(eph), u_events, maxevents, timeout);
+}
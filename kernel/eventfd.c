@@ -0,0 +1,218 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/syscalls.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/kernelfs.h>
+
+#include <sys/eventfd.h> // system header
+
+/*
+ * eventfd: just a 64-bit counter, incremented by write() and consumed by
+ * read(), as a much lighter alternative to pipes for wakeup notifications.
+ */
+
+#define EVENTFD_MAX        (~0ull - 1)
+
+struct eventfd {
+
+   KOBJ_BASE_FIELDS
+
+   u64 count;
+   bool semaphore;            /* EFD_SEMAPHORE: read() decrements by 1 */
+
+   struct kmutex mutex;
+   struct kcond rcond;        /* signaled when count becomes > 0 */
+   struct kcond wcond;        /* signaled when count decreases */
+};
+
+static struct kmem_cache eventfd_cache =
+   STATIC_KMEM_CACHE_INIT(eventfd_cache, "eventfd", sizeof(struct eventfd));
+
+static inline struct eventfd *get_eventfd(fs_handle h)
+{
+   return (void *)((struct kfs_handle *)h)->kobj;
+}
+
+static ssize_t evfd_read(fs_handle h, char *buf, size_t size)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = get_eventfd(h);
+   ssize_t rc = sizeof(u64);
+   u64 val;
+
+   if (size < sizeof(u64))
+      return -EINVAL;
+
+   kmutex_lock(&e->mutex);
+   {
+      while (!e->count) {
+
+         if (kh->fl_flags & O_NONBLOCK) {
+            rc = -EAGAIN;
+            goto end;
+         }
+
+         kcond_wait(&e->rcond, &e->mutex, KCOND_WAIT_FOREVER);
+
+         if (pending_signals()) {
+            rc = -EINTR;
+            goto end;
+         }
+      }
+
+      val = e->semaphore ? 1 : e->count;
+      memcpy(buf, &val, sizeof(val));
+      e->count -= val;
+      kcond_signal_all(&e->wcond);
+
+   end:;
+   }
+   kmutex_unlock(&e->mutex);
+   return rc;
+}
+
+static ssize_t evfd_write(fs_handle h, char *buf, size_t size)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = get_eventfd(h);
+   ssize_t rc = sizeof(u64);
+   u64 val;
+
+   if (size < sizeof(u64))
+      return -EINVAL;
+
+   memcpy(&val, buf, sizeof(val));
+
+   if (val > EVENTFD_MAX)
+      return -EINVAL;
+
+   kmutex_lock(&e->mutex);
+   {
+      /* Wait until adding `val` won't overflow the counter */
+      while (val > EVENTFD_MAX - e->count) {
+
+         if (kh->fl_flags & O_NONBLOCK) {
+            rc = -EAGAIN;
+            goto end;
+         }
+
+         kcond_wait(&e->wcond, &e->mutex, KCOND_WAIT_FOREVER);
+
+         if (pending_signals()) {
+            rc = -EINTR;
+            goto end;
+         }
+      }
+
+      if (val) {
+         e->count += val;
+         kcond_signal_all(&e->rcond);
+      }
+
+   end:;
+   }
+   kmutex_unlock(&e->mutex);
+   return rc;
+}
+
+static int evfd_read_ready(fs_handle h)
+{
+   struct eventfd *e = get_eventfd(h);
+   bool ret;
+
+   kmutex_lock(&e->mutex);
+   {
+      ret = e->count > 0;
+   }
+   kmutex_unlock(&e->mutex);
+   return ret;
+}
+
+static int evfd_write_ready(fs_handle h)
+{
+   struct eventfd *e = get_eventfd(h);
+   bool ret;
+
+   kmutex_lock(&e->mutex);
+   {
+      ret = e->count < EVENTFD_MAX;
+   }
+   kmutex_unlock(&e->mutex);
+   return ret;
+}
+
+static struct kcond *evfd_get_rready_cond(fs_handle h)
+{
+   return &get_eventfd(h)->rcond;
+}
+
+static struct kcond *evfd_get_wready_cond(fs_handle h)
+{
+   return &get_eventfd(h)->wcond;
+}
+
+static const struct file_ops static_ops_eventfd =
+{
+   .read = evfd_read,
+   .write = evfd_write,
+   .read_ready = evfd_read_ready,
+   .write_ready = evfd_write_ready,
+   .get_rready_cond = evfd_get_rready_cond,
+   .get_wready_cond = evfd_get_wready_cond,
+};
+
+static void destroy_eventfd(struct eventfd *e)
+{
+   kcond_destory(&e->wcond);
+   kcond_destory(&e->rcond);
+   kmutex_destroy(&e->mutex);
+   kmem_cache_free(&eventfd_cache, e);
+}
+
+int sys_eventfd2(unsigned int initval, int flags)
+{
+   struct kfs_handle *h;
+   struct eventfd *e;
+   int fd;
+
+   if (flags & ~(EFD_CLOEXEC | EFD_NONBLOCK | EFD_SEMAPHORE))
+      return -EINVAL;
+
+   if (!(e = kmem_cache_zalloc(&eventfd_cache)))
+      return -ENOMEM;
+
+   e->destory_obj = (void *)&destroy_eventfd;
+   e->count = initval;
+   e->semaphore = !!(flags & EFD_SEMAPHORE);
+   kmutex_init(&e->mutex, 0);
+   kcond_init(&e->rcond);
+   kcond_init(&e->wcond);
+
+   h = kfs_create_new_handle(&static_ops_eventfd,
+                             (void *)e,
+                             O_RDWR | (flags & EFD_NONBLOCK));
+
+   if (!h) {
+      destroy_eventfd(e);
+      return -ENOMEM;
+   }
+
+   if ((fd = install_fs_handle(h, !!(flags & EFD_CLOEXEC))) < 0) {
+      kfs_destroy_handle(h);
+      destroy_eventfd(e);
+   }
+
+   return fd;
+}
+
+int sys_eventfd(unsigned int initval)
+{
+   return sys_eventfd2(initval, 0);
+}
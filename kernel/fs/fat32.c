@@ -2,6 +2,7 @@
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/string_util.h>
+#include <tilck/common/utils.h>
 
 #include <tilck/kernel/fs/fat32.h>
 #include <tilck/kernel/fs/vfs.h>
@@ -39,127 +40,248 @@ fat_close(fs_handle handle)
    kfree_obj(h, struct fatfs_handle);
 }
 
-STATIC ssize_t
-fat_read(fs_handle handle, char *buf, size_t bufsize)
+/*
+ * Walk the first `max_clu` clusters of the chain starting at `clu`, collapsing
+ * the contiguous runs of clusters into extents. When `extents` is NULL, just
+ * count them. Returns the number of extents.
+ */
+static u32
+fat_walk_extents(struct fat_fs_device_data *d,
+                 u32 clu,
+                 u32 max_clu,
+                 struct fat_extent *extents)
 {
-   struct fatfs_handle *h = (struct fatfs_handle *) handle;
-   struct fat_fs_device_data *d = h->fs->device_data;
-   offt fsize = (offt)h->e->DIR_FileSize;
-   offt written_to_buf = 0;
+   u32 count = 0;
+   u32 prev = 0;
 
-   if (h->pos >= fsize) {
+   for (u32 i = 0; i < max_clu; i++) {
 
-      /*
-       * The cursor is at the end or past the end: nothing to read.
-       */
+      /* We do not expect BAD CLUSTERS */
+      ASSERT(!fat_is_bad_cluster(d->type, clu));
+
+      if (!count || clu != prev + 1) {
+
+         if (extents)
+            extents[count] = (struct fat_extent) { .file_clu = i, .clu = clu };
+
+         count++;
+      }
 
-      return 0;
+      if (extents)
+         extents[count - 1].count++;
+
+      prev = clu;
+      clu = fat_read_fat_entry(d->hdr, d->type, 0, clu);
+
+      if (fat_is_end_of_clusterchain(d->type, clu))
+         break;
    }
 
-   do {
+   return count;
+}
 
-      char *data = fat_get_pointer_to_cluster_data(d->hdr, h->curr_cluster);
+static struct fat_extent_map *
+fat_new_extent_map(struct fat_fs_device_data *d, struct fat_entry *e)
+{
+   const u32 first_clu = fat_get_first_cluster(e);
+   const u32 max_clu =
+      (u32)(round_up_at(e->DIR_FileSize, d->cluster_size) / d->cluster_size);
+   struct fat_extent_map *m;
 
-      const offt file_rem       = fsize - h->pos;
-      const offt buf_rem        = (offt)bufsize - written_to_buf;
-      const offt cluster_off    = h->pos % (offt)d->cluster_size;
-      const offt cluster_rem    = (offt)d->cluster_size - cluster_off;
-      const offt to_read        = MIN3(cluster_rem, buf_rem, file_rem);
+   if (!(m = kzalloc_obj(struct fat_extent_map)))
+      return NULL;
 
-      ASSERT(to_read >= 0);
+   bintree_node_init(&m->node);
+   m->e = e;
 
-      memcpy(buf + written_to_buf, data + cluster_off, (size_t)to_read);
-      written_to_buf += to_read;
-      h->pos += to_read;
+   if (!first_clu || !max_clu)
+      return m; /* Empty file */
 
-      if (to_read < cluster_rem) {
+   m->count = fat_walk_extents(d, first_clu, max_clu, NULL);
 
-         /*
-          * We read less than cluster_rem because the buf was not big enough
-          * or because the file was not big enough. In either case, we cannot
-          * continue.
-          */
-         break;
-      }
+   if (!(m->extents = kalloc_array_obj(struct fat_extent, m->count))) {
+      kfree_obj(m, struct fat_extent_map);
+      return NULL;
+   }
 
-      // find the next cluster
-      u32 fatval = fat_read_fat_entry(d->hdr, d->type, 0, h->curr_cluster);
+   fat_walk_extents(d, first_clu, max_clu, m->extents);
+   return m;
+}
 
-      if (fat_is_end_of_clusterchain(d->type, fatval)) {
-         ASSERT(h->pos == fsize);
-         break;
+static void fat_destroy_extent_map(struct fat_extent_map *m)
+{
+   kfree_array_obj(m->extents, struct fat_extent, m->count);
+   kfree_obj(m, struct fat_extent_map);
+}
+
+/* Get the extent map of `e`, building it if necessary */
+static struct fat_extent_map *
+fat_get_extent_map(struct fat_fs_device_data *d, struct fat_entry *e)
+{
+   struct fat_extent_map *m;
+
+   kmutex_lock(&d->cache_lock);
+   {
+      m = bintree_find_ptr(d->ext_maps, e, struct fat_extent_map, node, e);
+
+      if (!m && (m = fat_new_extent_map(d, e)))
+         bintree_insert_ptr(&d->ext_maps, m, struct fat_extent_map, node, e);
+   }
+   kmutex_unlock(&d->cache_lock);
+   return m;
+}
+
+static void fat_destroy_all_extent_maps(struct fat_fs_device_data *d)
+{
+   struct fat_extent_map *m;
+
+   while ((m = bintree_get_first_obj(d->ext_maps,
+                                     struct fat_extent_map,
+                                     node)))
+   {
+      bintree_remove_ptr(&d->ext_maps, m, struct fat_extent_map, node, e);
+      fat_destroy_extent_map(m);
+   }
+}
+
+/*
+ * Get a pointer to the file's data at offset `pos`, along with the number of
+ * bytes from there to the end of the extent (i.e. the bytes that can be read
+ * contiguously). Returns NULL if `pos` is past the last cluster of the file.
+ */
+char *fat_get_data_at(struct fatfs_handle *h, offt pos, offt *contig_rem)
+{
+   struct fat_fs_device_data *d = h->fs->device_data;
+   struct fat_extent_map *m = h->ext_map;
+   const u32 file_clu = (u32)(pos / (offt)d->cluster_size);
+   struct fat_extent *ext;
+   long lo = 0, hi = (long)m->count - 1;
+
+   /* Binary search for the extent containing `file_clu` */
+   while (lo <= hi) {
+
+      const long mid = lo + (hi - lo) / 2;
+      ext = &m->extents[mid];
+
+      if (file_clu < ext->file_clu) {
+         hi = mid - 1;
+      } else if (file_clu >= ext->file_clu + ext->count) {
+         lo = mid + 1;
+      } else {
+
+         const offt ext_off = (offt)ext->file_clu * (offt)d->cluster_size;
+         const offt off = pos - ext_off;
+         char *data = fat_get_pointer_to_cluster_data(d->hdr, ext->clu);
+
+         *contig_rem = (offt)ext->count * (offt)d->cluster_size - off;
+         return data + off;
       }
+   }
 
-      // we do not expect BAD CLUSTERS
-      ASSERT(!fat_is_bad_cluster(d->type, fatval));
+   return NULL;
+}
 
-      h->curr_cluster = fatval; // go reading the new cluster in the chain.
+static ssize_t
+fat_read_at(struct fatfs_handle *h, char *buf, size_t bufsize, offt *pos)
+{
+   offt fsize = (offt)h->e->DIR_FileSize;
+   offt written_to_buf = 0;
 
-   } while (true);
+   /*
+    * Read the whole contiguous runs of clusters at once, until we fill the
+    * buffer or we reach the end of the file.
+    */
+
+   while (*pos < fsize && written_to_buf < (offt)bufsize) {
+
+      offt contig_rem;
+      char *data = fat_get_data_at(h, *pos, &contig_rem);
+
+      if (!data)
+         break; /* Corrupted FS: the cluster chain is shorter than the file */
+
+      const offt file_rem       = fsize - *pos;
+      const offt buf_rem        = (offt)bufsize - written_to_buf;
+      const offt to_read        = MIN3(contig_rem, buf_rem, file_rem);
+
+      ASSERT(to_read > 0);
+
+      /* `buf` might be an user buffer: see VFS_SPFL_NO_USER_COPY */
+      if (copy_to_any_buf(buf + written_to_buf, data, (size_t)to_read)) {
+
+         if (!written_to_buf)
+            return -EFAULT;
+
+         break;
+      }
+
+      written_to_buf += to_read;
+      *pos += to_read;
+   }
 
    return (ssize_t)written_to_buf;
 }
 
+STATIC ssize_t
+fat_read(fs_handle handle, char *buf, size_t bufsize)
+{
+   struct fatfs_handle *h = (struct fatfs_handle *) handle;
+   return fat_read_at(h, buf, bufsize, &h->pos);
+}
 
-STATIC int
-fat_rewind(fs_handle handle)
+STATIC ssize_t
+fat_pread(fs_handle handle, char *buf, size_t bufsize, offt off)
 {
    struct fatfs_handle *h = (struct fatfs_handle *) handle;
-   h->pos = 0;
-   h->curr_cluster = fat_get_first_cluster(h->e);
-   return 0;
+   return fat_read_at(h, buf, bufsize, &off);
 }
 
-STATIC offt
-fat_seek_forward(fs_handle handle, offt dist)
+/*
+ * Write the file's data to `out` directly from the clusters: this is possible
+ * because the FAT file systems are mounted from ramdisks and, for the moment,
+ * they're read-only.
+ */
+STATIC ssize_t
+fat_sendfile(fs_handle handle, fs_handle out, offt *pos, size_t count)
 {
    struct fatfs_handle *h = (struct fatfs_handle *) handle;
-   struct fat_fs_device_data *d = h->fs->device_data;
-   offt fsize = (offt)h->e->DIR_FileSize;
-   offt moved_distance = 0;
+   const offt fsize = (offt)h->e->DIR_FileSize;
+   ssize_t tot = 0;
+   ssize_t rc;
 
-   if (dist == 0)
-      return h->pos;
+   if (h->e->directory)
+      return -EINVAL;
 
-   if (h->pos + dist > fsize) {
-      /* Allow, like Linux does, to seek past the end of a file. */
-      h->pos += dist;
-      h->curr_cluster = (u32) -1; /* invalid cluster */
-      return (offt) h->pos;
-   }
+   while (count > 0 && *pos < fsize) {
 
-   do {
+      offt contig_rem;
+      char *data = fat_get_data_at(h, *pos, &contig_rem);
 
-      const offt file_rem       = fsize - h->pos;
-      const offt dist_rem       = dist - moved_distance;
-      const offt cluster_off    = h->pos % (offt)d->cluster_size;
-      const offt cluster_rem    = (offt)d->cluster_size - cluster_off;
-      const offt to_move        = MIN3(cluster_rem, dist_rem, file_rem);
+      if (!data)
+         break; /* Corrupted FS: the cluster chain is shorter than the file */
 
-      ASSERT(to_move >= 0);
+      const offt file_rem       = fsize - *pos;
+      const offt to_send        = MIN3(contig_rem, (offt)count, file_rem);
 
-      moved_distance += to_move;
-      h->pos += to_move;
+      rc = vfs_write(out, data, (size_t)to_send);
 
-      if (to_move < cluster_rem)
-         break;
+      if (rc <= 0) {
 
-      // find the next cluster
-      u32 fatval = fat_read_fat_entry(d->hdr, d->type, 0, h->curr_cluster);
+         if (!tot)
+            tot = rc;
 
-      if (fat_is_end_of_clusterchain(d->type, fatval)) {
-         ASSERT(h->pos == fsize);
          break;
       }
 
-      // we do not expect BAD CLUSTERS
-      ASSERT(!fat_is_bad_cluster(d->type, fatval));
-
-      h->curr_cluster = fatval; // go reading the new cluster in the chain.
+      *pos += rc;
+      tot += rc;
+      count -= (size_t)rc;
 
-   } while (true);
+      if (rc < to_send)
+         break;
+   }
 
-   return (offt)h->pos;
+   return tot;
 }
 
 struct fat_count_dirents_ctx {
@@ -224,51 +346,34 @@ fat_seek(fs_handle handle, offt off, int whence)
       return fat_seek_dir(fh, off);
    }
 
-   offt curr_pos = fh->pos;
+   /*
+    * Thanks to the extent map, the position is just a number: there's no
+    * current cluster to keep in sync with it.
+    */
 
    switch (whence) {
 
       case SEEK_SET:
-
-         if (off < 0)
-            return -EINVAL; /* invalid negative offset */
-
-         fat_rewind(handle);
-         break;
-
-      case SEEK_END:
-
-         if (off >= 0)
-            break;
-
-         struct fatfs_handle *h = (struct fatfs_handle *) handle;
-         off = (offt) h->e->DIR_FileSize + off;
-
-         if (off < 0)
-            return -EINVAL;
-
-         fat_rewind(handle);
          break;
 
       case SEEK_CUR:
+         off += fh->pos;
+         break;
 
-         if (off < 0) {
-
-            off = curr_pos + off;
-
-            if (off < 0)
-               return -EINVAL;
-
-            fat_rewind(handle);
-         }
-
+      case SEEK_END:
+         off += (offt)fh->e->DIR_FileSize;
          break;
 
       default:
          return -EINVAL;
    }
 
-   return fat_seek_forward(handle, off);
+   if (off < 0)
+      return -EINVAL; /* invalid negative offset */
+
+   /* Allow, like Linux does, to seek past the end of a file. */
+   fh->pos = off;
+   return fh->pos;
 }
 
 struct datetime
@@ -450,8 +555,10 @@ STATIC int fat_ioctl(fs_handle h, ulong request, void *arg)
 static const struct file_ops static_ops_fat =
 {
    .read = fat_read,
+   .pread = fat_pread,
    .seek = fat_seek,
    .write = fat_write,
+   .sendfile = fat_sendfile,
    .ioctl = fat_ioctl,
    .mmap = fat_mmap,
    .munmap = fat_munmap,
@@ -485,13 +592,18 @@ fat_open(struct vfs_path *p, fs_handle *out, int fl, mode_t mode)
    if (!(h = kzalloc_obj(struct fatfs_handle)))
       return -ENOMEM;
 
+   if (!e->directory && !(h->ext_map = fat_get_extent_map(d, e))) {
+      kfree_obj(h, struct fatfs_handle);
+      return -ENOMEM;
+   }
+
    vfs_init_fs_handle_base_fields((void *)h, fs, &static_ops_fat);
    h->e = e;
    h->pos = 0;
-   h->curr_cluster = fat_get_first_cluster(e);
+   h->spec_flags = VFS_SPFL_NO_USER_COPY;
 
    if (d->mmap_support)
-      h->spec_flags = VFS_SPFL_MMAP_SUPPORTED;
+      h->spec_flags |= VFS_SPFL_MMAP_SUPPORTED;
 
    *out = h;
    return 0;
@@ -509,6 +621,246 @@ STATIC int fat_dup(fs_handle h, fs_handle *dup_h)
    return 0;
 }
 
+/*
+ * Indexes are identified by the first cluster of the directory, because the
+ * same directory can be reached through different entries (e.g. "..").
+ */
+static inline ulong
+fat_get_dir_cluster(struct fat_fs_device_data *d, struct fat_entry *dir)
+{
+   if (dir == d->root_dir_entries)
+      return d->root_cluster;
+
+   return fat_get_first_cluster(dir);
+}
+
+/*
+ * Hash of the name, case-folded: short names are compared in a case
+ * INSENSITIVE way and all the names need to have the same hash function.
+ */
+static inline u32 fat_name_hash(const char *name, size_t len)
+{
+   return fnv1a_hash(name, len, true);
+}
+
+struct fat_dir_index_build_ctx {
+
+   struct fat_dir_index *idx;       /* NULL while counting */
+   u32 count;
+   size_t names_size;
+   char shortname[16];
+   struct fat_walk_long_name_ctx walk_ctx;
+};
+
+static int
+fat_dir_index_build_cb(struct fat_hdr *hdr,
+                       enum fat_type ft,
+                       struct fat_entry *entry,
+                       const char *long_name,
+                       void *arg)
+{
+   struct fat_dir_index_build_ctx *ctx = arg;
+   struct fat_dir_index *idx = ctx->idx;
+   struct fat_dir_index_ent *ent;
+   const char *name = long_name;
+   size_t len;
+   u32 b;
+
+   if (!name) {
+      fat_get_short_name(entry, ctx->shortname);
+      name = ctx->shortname;
+   }
+
+   len = strlen(name);
+
+   if (idx) {
+
+      ent = &idx->ents[ctx->count];
+      b = fat_name_hash(name, len) & (idx->buckets_count - 1);
+
+      *ent = (struct fat_dir_index_ent) {
+         .e = entry,
+         .hash = fat_name_hash(name, len),
+         .name_off = (u32)ctx->names_size,
+         .name_len = (u16)len,
+         .long_name = long_name != NULL,
+      };
+
+      memcpy(idx->names + ctx->names_size, name, len + 1);
+
+      /*
+       * Append the entry at the end of its bucket, in order to always find the
+       * first matching entry in the directory, exactly like fat_walk() does.
+       */
+
+      if (!idx->buckets[b]) {
+
+         idx->buckets[b] = ctx->count + 1;
+
+      } else {
+
+         struct fat_dir_index_ent *p = &idx->ents[idx->buckets[b] - 1];
+
+         while (p->next)
+            p = &idx->ents[p->next - 1];
+
+         p->next = ctx->count + 1;
+      }
+   }
+
+   ctx->count++;
+   ctx->names_size += len + 1;
+   return 0;
+}
+
+static void fat_destroy_dir_index(struct fat_dir_index *idx)
+{
+   kfree_array_obj(idx->buckets, u32, idx->buckets_count);
+   kfree_array_obj(idx->ents, struct fat_dir_index_ent, idx->count);
+
+   if (idx->names)
+      kfree2(idx->names, idx->names_size);
+
+   kfree_obj(idx, struct fat_dir_index);
+}
+
+static struct fat_dir_index *
+fat_new_dir_index(struct fat_fs_device_data *d, struct fat_entry *dir)
+{
+   struct fat_walk_static_params walk_params;
+   struct fat_dir_index_build_ctx *ctx;
+   struct fat_dir_index *idx;
+
+   /* The walk context contains buffers for long names: keep it on the heap */
+   if (!(ctx = kzalloc_obj(struct fat_dir_index_build_ctx)))
+      return NULL;
+
+   if (!(idx = kzalloc_obj(struct fat_dir_index))) {
+      kfree_obj(ctx, struct fat_dir_index_build_ctx);
+      return NULL;
+   }
+
+   walk_params = (struct fat_walk_static_params) {
+      .ctx = &ctx->walk_ctx,
+      .h = d->hdr,
+      .ft = d->type,
+      .cb = &fat_dir_index_build_cb,
+      .arg = ctx,
+   };
+
+   /* First pass: count the entries and the space needed for their names */
+   fat_fs_walk_generic(d, &walk_params, dir);
+
+   bintree_node_init(&idx->node);
+   idx->clu = fat_get_dir_cluster(d, dir);
+   idx->count = ctx->count;
+   idx->names_size = ctx->names_size;
+   idx->buckets_count = 1;
+
+   while (idx->buckets_count < idx->count)
+      idx->buckets_count <<= 1;
+
+   idx->buckets = kzalloc_array_obj(u32, idx->buckets_count);
+   idx->ents = kalloc_array_obj(struct fat_dir_index_ent, idx->count);
+   idx->names = idx->names_size ? kmalloc(idx->names_size) : NULL;
+
+   if (!idx->buckets ||
+       (idx->count && !idx->ents) ||
+       (idx->names_size && !idx->names))
+   {
+      fat_destroy_dir_index(idx);
+      kfree_obj(ctx, struct fat_dir_index_build_ctx);
+      return NULL;
+   }
+
+   /* Second pass: fill the index */
+   ctx->idx = idx;
+   ctx->count = 0;
+   ctx->names_size = 0;
+   fat_fs_walk_generic(d, &walk_params, dir);
+
+   kfree_obj(ctx, struct fat_dir_index_build_ctx);
+   return idx;
+}
+
+/* Get the index of the directory `dir`, building it if necessary */
+static struct fat_dir_index *
+fat_get_dir_index(struct fat_fs_device_data *d, struct fat_entry *dir)
+{
+   const ulong clu = fat_get_dir_cluster(d, dir);
+   struct fat_dir_index *idx;
+
+   kmutex_lock(&d->cache_lock);
+   {
+      idx = bintree_find_ptr(d->dir_indexes,
+                             clu,
+                             struct fat_dir_index,
+                             node,
+                             clu);
+
+      if (!idx && (idx = fat_new_dir_index(d, dir))) {
+         bintree_insert_ptr(&d->dir_indexes,
+                            idx,
+                            struct fat_dir_index,
+                            node,
+                            clu);
+      }
+   }
+   kmutex_unlock(&d->cache_lock);
+   return idx;
+}
+
+static void fat_destroy_all_dir_indexes(struct fat_fs_device_data *d)
+{
+   struct fat_dir_index *idx;
+
+   while ((idx = bintree_get_first_obj(d->dir_indexes,
+                                       struct fat_dir_index,
+                                       node)))
+   {
+      bintree_remove_ptr(&d->dir_indexes, idx, struct fat_dir_index, node, clu);
+      fat_destroy_dir_index(idx);
+   }
+}
+
+/*
+ * Look for `name` in the index, with the same rules as fat_search_entry_cb():
+ * case-sensitive comparison for long names, case-insensitive for short names.
+ */
+static struct fat_entry *
+fat_dir_index_lookup(struct fat_dir_index *idx, const char *name, size_t len)
+{
+   const u32 hash = fat_name_hash(name, len);
+   u32 n = idx->buckets[hash & (idx->buckets_count - 1)];
+
+   for (; n; n = idx->ents[n - 1].next) {
+
+      struct fat_dir_index_ent *ent = &idx->ents[n - 1];
+      const char *ent_name = idx->names + ent->name_off;
+      size_t i;
+
+      if (ent->hash != hash || ent->name_len != len)
+         continue;
+
+      if (ent->long_name) {
+
+         if (!memcmp(ent_name, name, len))
+            return ent->e;
+
+         continue;
+      }
+
+      for (i = 0; i < len; i++)
+         if (tolower(ent_name[i]) != tolower(name[i]))
+            break;
+
+      if (i == len)
+         return ent->e;
+   }
+
+   return NULL;
+}
+
 static inline void
 fat_get_root_entry(struct fat_fs_device_data *d, struct fat_fs_path *fp)
 {
@@ -532,6 +884,8 @@ fat_get_entry(struct fs *fs,
    struct fat_walk_static_params walk_params;
    struct fat_entry *dir_entry;
    struct fat_search_ctx ctx;
+   struct fat_dir_index *idx;
+   struct fat_entry *res;
 
    if (!dir_inode && !name)              // both dir_inode and name are NULL:
       return fat_get_root_entry(d, fp);  // getting a path to the root dir
@@ -542,18 +896,26 @@ fat_get_entry(struct fs *fs,
       if (is_dot_or_dotdot(name, (int)name_len))
          return fat_get_root_entry(d, fp);
 
-   walk_params = (struct fat_walk_static_params) {
-      .ctx = &ctx.walk_ctx,
-      .h = d->hdr,
-      .ft = d->type,
-      .cb = &fat_search_entry_cb,
-      .arg = &ctx,
-   };
+   if ((idx = fat_get_dir_index(d, dir_entry))) {
 
-   fat_init_search_ctx(&ctx, name, true);
-   fat_fs_walk_generic(d, &walk_params, dir_entry);
+      res = fat_dir_index_lookup(idx, name, (size_t)name_len);
+
+   } else {
+
+      /* Out of memory: fall back to the linear search in the directory */
+      walk_params = (struct fat_walk_static_params) {
+         .ctx = &ctx.walk_ctx,
+         .h = d->hdr,
+         .ft = d->type,
+         .cb = &fat_search_entry_cb,
+         .arg = &ctx,
+      };
+
+      fat_init_search_ctx(&ctx, name, true);
+      fat_fs_walk_generic(d, &walk_params, dir_entry);
+      res = !ctx.not_dir ? ctx.result : NULL;
+   }
 
-   struct fat_entry *res = !ctx.not_dir ? ctx.result : NULL;
    enum vfs_entry_type type = VFS_NONE;
 
    if (res) {
@@ -638,8 +1000,10 @@ struct fs *fat_mount_ramdisk(void *vaddr, size_t rd_size, u32 flags)
    d->type = fat_get_type(d->hdr);
    d->cluster_size = d->hdr->BPB_SecPerClus * d->hdr->BPB_BytsPerSec;
    d->root_dir_entries = fat_get_rootdir(d->hdr, d->type, &d->root_cluster);
+   kmutex_init(&d->cache_lock, 0);
 
    if (!(fs = create_fs_obj("fat"))) {
+      kmutex_destroy(&d->cache_lock);
       kfree_obj(d, struct fat_fs_device_data);
       return NULL;
    }
@@ -648,7 +1012,7 @@ struct fs *fat_mount_ramdisk(void *vaddr, size_t rd_size, u32 flags)
    fs->device_id = vfs_get_new_device_id();
    fs->device_data = d;
    fs->fsops = &static_fsops_fat;
-   fs->flags |= VFS_FS_RQ_DE_SKIP;
+   fs->flags |= VFS_FS_RQ_DE_SKIP | VFS_FS_DCACHE;
 
    if (!fat_ramdisk_prepare_for_mmap(d, rd_size))
       d->mmap_support = true;
@@ -658,6 +1022,11 @@ struct fs *fat_mount_ramdisk(void *vaddr, size_t rd_size, u32 flags)
 
 void fat_umount_ramdisk(struct fs *fs)
 {
-   kfree_obj(fs->device_data, struct fat_fs_device_data);
+   struct fat_fs_device_data *d = fs->device_data;
+
+   fat_destroy_all_extent_maps(d);
+   fat_destroy_all_dir_indexes(d);
+   kmutex_destroy(&d->cache_lock);
+   kfree_obj(d, struct fat_fs_device_data);
    destory_fs_obj(fs);
 }
@@ -99,9 +99,9 @@ int fat_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
    struct fat_fs_device_data *d = fh->fs->device_data;
    const size_t off_begin = um->off;
    const size_t off_end = off_begin + um->len;
-   ulong vaddr = um->vaddr, off = 0;
+   ulong vaddr = um->vaddr;
+   size_t off = off_begin;
    size_t mapped_cnt;
-   u32 clu;
 
    if (!d->mmap_support)
       return -ENODEV; /* We do NOT support mmap for this "superblock" */
@@ -112,75 +112,51 @@ int fat_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
    if (flags & VFS_MM_DONT_MMAP)
       return 0;
 
-   clu = fat_get_first_cluster(fh->e);
-
-   do {
-
-      char *data;
-      const ulong clu_end_off = off + d->cluster_size;
-
-      // Are we past the end of the mapped region?
-      if (off >= off_end)
-         break;
-
-      // Does this cluster belong to the mapped region?
-      if (clu_end_off > off_begin) {
-
-         // The cluster ends *after* the beginning of our region
-         data = fat_get_pointer_to_cluster_data(d->hdr, clu);
+   /*
+    * Map each contiguous run of clusters in the region with a single call,
+    * finding the first one with a binary search in the file's extent map,
+    * instead of following the cluster chain from the beginning of the file.
+    */
 
-         if (off < off_begin) {
+   while (off < off_end) {
 
-            // Our region begins somewhere in the middle of this cluster.
-            // This can happen only with cluster_size > PAGE_SIZE.
-            off = off_begin;
-            data += off_begin - off;
-         }
+      offt contig_rem;
+      char *data = fat_get_data_at(fh, (offt)off, &contig_rem);
 
-         /*
-          * Calculate the number of pages to mmap, considering that:
-          *    - we cannot mmap in this iteration further than clu_end_off
-          *    - we must not mmap further than off_end
-          */
-         size_t pg_count = (MIN(clu_end_off, off_end) - off) >> PAGE_SHIFT;
+      if (!data)
+         break; /* We're past the last cluster of the file */
 
-         mapped_cnt = map_pages(pdir,
-                                (void *)vaddr,
-                                KERNEL_VA_TO_PA(data),
-                                pg_count,
-                                PAGING_FL_US | PAGING_FL_SHARED);
+      /*
+       * Calculate the number of pages to mmap, considering that:
+       *    - we cannot mmap in this iteration further than the extent's end
+       *    - we must not mmap further than off_end
+       *
+       * Note: `off` is always page-aligned, as clusters are page-aligned.
+       */
+      size_t pg_count = MIN((size_t)contig_rem, off_end - off) >> PAGE_SHIFT;
 
-         if (mapped_cnt != pg_count) {
+      mapped_cnt = map_pages(pdir,
+                             (void *)vaddr,
+                             KERNEL_VA_TO_PA(data),
+                             pg_count,
+                             PAGING_FL_US | PAGING_FL_SHARED);
 
-            /* mmap failed, we have to unmap the pages already mappped */
-            vaddr -= PAGE_SIZE;
+      if (mapped_cnt != pg_count) {
 
-            for (; vaddr >= um->vaddr; vaddr -= PAGE_SIZE) {
-               unmap_page_permissive(pdir, (void *)vaddr, false);
-            }
+         /* mmap failed, we have to unmap the pages already mappped */
+         vaddr += mapped_cnt << PAGE_SHIFT;
+         vaddr -= PAGE_SIZE;
 
-            return -ENOMEM;
+         for (; vaddr >= um->vaddr; vaddr -= PAGE_SIZE) {
+            unmap_page_permissive(pdir, (void *)vaddr, false);
          }
 
-         vaddr += pg_count << PAGE_SHIFT;
-         off += pg_count << PAGE_SHIFT;
-
-         // After each iteration, `off` must always be aligned at `cluster_size`
-         ASSERT((off % d->cluster_size) == 0);
-
-      } else {
-
-         // We skipped the whole cluster
-         off += d->cluster_size;
+         return -ENOMEM;
       }
 
-      // Get the next cluster# from the File Allocation Table
-      clu = fat_read_fat_entry(d->hdr, d->type, 0, clu);
-
-      // We do not expect BAD CLUSTERS
-      ASSERT(!fat_is_bad_cluster(d->type, clu));
-
-   } while (!fat_is_end_of_clusterchain(d->type, clu));
+      vaddr += pg_count << PAGE_SHIFT;
+      off += pg_count << PAGE_SHIFT;
+   }
 
    return 0;
 }
@@ -14,6 +14,9 @@
 
 #include <fcntl.h>      // system header
 
+/* Max number of bytes transferred by a single read() or write(), like Linux */
+#define MAX_RW_COUNT          0x7ffff000u
+
 static inline bool is_fd_in_valid_range(int fd)
 {
    return IN_RANGE(fd, 0, MAX_HANDLES);
@@ -57,6 +60,34 @@ fs_handle get_fs_handle(int fd)
    return handle;
 }
 
+/*
+ * Install the already created handle `h` in the lowest free slot of the current
+ * process' handles table. Returns the new fd or -EMFILE. On failure, the caller
+ * still owns the handle.
+ */
+int install_fs_handle(fs_handle h, bool cloexec)
+{
+   struct task *curr = get_curr_task();
+   int fd;
+
+   kmutex_lock(&curr->pi->fslock);
+
+   if ((fd = get_free_handle_num(curr->pi)) >= 0) {
+
+      if (cloexec)
+         ((struct fs_handle_base *)h)->fd_flags |= FD_CLOEXEC;
+
+      curr->pi->handles[fd] = h;
+
+   } else {
+
+      fd = -EMFILE;
+   }
+
+   kmutex_unlock(&curr->pi->fslock);
+   return fd;
+}
+
 
 int sys_open(const char *u_path, int flags, mode_t mode)
 {
@@ -172,6 +203,22 @@ int sys_mkdir(const char *u_path, mode_t mode)
    return vfs_mkdir(path, mode);
 }
 
+/*
+ * Handles with VFS_SPFL_NO_USER_COPY get the user buffer directly, without
+ * going through the `io_copybuf`: therefore, the buffer must be checked here,
+ * making sure that it's entirely in user space. The actual copy is done by the
+ * file system in a fault-safe way (see copy_to_any_buf()).
+ */
+static int check_direct_io_user_buf(const void *u_buf, size_t *count)
+{
+   *count = MIN(*count, MAX_RW_COUNT);
+
+   if ((ulong)u_buf >= KERNEL_BASE_VA || user_out_of_range(u_buf, *count))
+      return -EFAULT;
+
+   return 0;
+}
+
 int sys_read(int fd, void *u_buf, size_t count)
 {
    int ret;
@@ -194,8 +241,13 @@ int sys_read(int fd, void *u_buf, size_t count)
     * return type of sys_read().
     */
 
-   if (h->spec_flags & VFS_SPFL_NO_USER_COPY)
+   if (h->spec_flags & VFS_SPFL_NO_USER_COPY) {
+
+      if (check_direct_io_user_buf(u_buf, &count))
+         return -EFAULT;
+
       return (int) vfs_read(h, u_buf, count);
+   }
 
    count = MIN(count, IO_COPYBUF_SIZE);
    ret = (int) vfs_read(h, curr->io_copybuf, count);
@@ -218,8 +270,13 @@ int sys_write(int fd, const void *u_buf, size_t count)
    if (!(h = get_fs_handle(fd)))
       return -EBADF;
 
-   if (h->spec_flags & VFS_SPFL_NO_USER_COPY)
+   if (h->spec_flags & VFS_SPFL_NO_USER_COPY) {
+
+      if (check_direct_io_user_buf(u_buf, &count))
+         return -EFAULT;
+
       return (int)vfs_write(h, (void *)u_buf, count);
+   }
 
    count = MIN(count, IO_COPYBUF_SIZE);
 
@@ -239,6 +296,91 @@ int sys_ioctl(int fd, ulong request, void *argp)
    return vfs_ioctl(handle, request, argp);
 }
 
+static int check_pos_offset(s64 off)
+{
+   if (off < 0)
+      return -EINVAL;
+
+   if (off > LONG_MAX)
+      return -EOVERFLOW;
+
+   return 0;
+}
+
+/* Like sys_read(), but at the given offset, not touching the file position */
+static ssize_t
+do_pread(struct fs_handle_base *h, void *u_buf, size_t count, offt off)
+{
+   struct task *curr = get_curr_task();
+   ssize_t rc;
+
+   if (h->spec_flags & VFS_SPFL_NO_USER_COPY) {
+
+      if (check_direct_io_user_buf(u_buf, &count))
+         return -EFAULT;
+
+      return vfs_pread(h, u_buf, count, off);
+   }
+
+   count = MIN(count, IO_COPYBUF_SIZE);
+   rc = vfs_pread(h, curr->io_copybuf, count, off);
+
+   if (rc > 0 && copy_to_user(u_buf, curr->io_copybuf, (size_t)rc))
+      rc = -EFAULT;
+
+   return rc;
+}
+
+/* Like sys_write(), but at the given offset, not touching the file position */
+static ssize_t
+do_pwrite(struct fs_handle_base *h, const void *u_buf, size_t count, offt off)
+{
+   struct task *curr = get_curr_task();
+
+   if (h->spec_flags & VFS_SPFL_NO_USER_COPY) {
+
+      if (check_direct_io_user_buf(u_buf, &count))
+         return -EFAULT;
+
+      return vfs_pwrite(h, (void *)u_buf, count, off);
+   }
+
+   count = MIN(count, IO_COPYBUF_SIZE);
+
+   if (copy_from_user(curr->io_copybuf, u_buf, count))
+      return -EFAULT;
+
+   return vfs_pwrite(h, curr->io_copybuf, count, off);
+}
+
+int sys_pread64(int fd, void *u_buf, size_t count, s64 off)
+{
+   struct fs_handle_base *h;
+   int rc;
+
+   if (!(h = get_fs_handle(fd)))
+      return -EBADF;
+
+   if ((rc = check_pos_offset(off)))
+      return rc;
+
+   return (int)do_pread(h, u_buf, count, (offt)off);
+}
+
+int sys_pwrite64(int fd, const void *u_buf, size_t count, s64 off)
+{
+   struct fs_handle_base *h;
+   int rc;
+
+   if (!(h = get_fs_handle(fd)))
+      return -EBADF;
+
+   if ((rc = check_pos_offset(off)))
+      return rc;
+
+   return (int)do_pwrite(h, u_buf, count, (offt)off);
+}
+
 static bool iov_len_overflow(const struct iovec *iov, int iovcnt)
 {
    ssize_t tot_len = 0;
@@ -304,6 +446,249 @@ int sys_readv(int fd, const struct iovec *u_iov, int u_iovcnt)
    return (int)vfs_readv(handle, iov, u_iovcnt);
 }
 
+static int
+do_sendfile(int out_fd, int in_fd, offt *pos, size_t count)
+{
+   fs_handle in, out;
+
+   if (!(in = get_fs_handle(in_fd)) || !(out = get_fs_handle(out_fd)))
+      return -EBADF;
+
+   return (int)vfs_sendfile(out, in, pos, MIN(count, MAX_RW_COUNT));
+}
+
+int sys_sendfile(int out_fd, int in_fd, long *u_offset, size_t count)
+{
+   long off;
+   offt pos;
+   int rc;
+
+   if (!u_offset)
+      return do_sendfile(out_fd, in_fd, NULL, count);
+
+   if (copy_from_user(&off, u_offset, sizeof(off)))
+      return -EFAULT;
+
+   if (off < 0)
+      return -EINVAL;
+
+   pos = off;
+
+   if ((rc = do_sendfile(out_fd, in_fd, &pos, count)) < 0)
+      return rc;
+
+   off = pos;
+
+   if (copy_to_user(u_offset, &off, sizeof(off)))
+      return -EFAULT;
+
+   return rc;
+}
+
+int sys_sendfile64(int out_fd, int in_fd, s64 *u_offset, size_t count)
+{
+   s64 off;
+   offt pos;
+   int rc;
+
+   if (!u_offset)
+      return do_sendfile(out_fd, in_fd, NULL, count);
+
+   if (copy_from_user(&off, u_offset, sizeof(off)))
+      return -EFAULT;
+
+   if (off < 0)
+      return -EINVAL;
+
+   if (off > LONG_MAX)
+      return -EOVERFLOW;
+
+   pos = (offt)off;
+
+   if ((rc = do_sendfile(out_fd, in_fd, &pos, count)) < 0)
+      return rc;
+
+   off = pos;
+
+   if (copy_to_user(u_offset, &off, sizeof(off)))
+      return -EFAULT;
+
+   return rc;
+}
+
+static int
+do_preadv_pwritev(int fd,
+                  const struct iovec *u_iov,
+                  int u_iovcnt,
+                  s64 off,
+                  bool write)
+{
+   struct task *curr = get_curr_task();
+   struct iovec *iov = (void *)curr->args_copybuf;
+   const u32 iovcnt = (u32) u_iovcnt;
+   struct fs_handle_base *h;
+   ssize_t ret = 0;
+   ssize_t rc;
+   int err;
+
+   if (u_iovcnt <= 0)
+      return -EINVAL;
+
+   if (sizeof(struct iovec) * iovcnt > ARGS_COPYBUF_SIZE)
+      return -EINVAL;
+
+   if (copy_from_user(iov, u_iov, sizeof(struct iovec) * iovcnt))
+      return -EFAULT;
+
+   if (iov_len_overflow(iov, u_iovcnt))
+      return -EINVAL;
+
+   if (!(h = get_fs_handle(fd)))
+      return -EBADF;
+
+   if ((err = check_pos_offset(off)))
+      return err;
+
+   for (u32 i = 0; i < iovcnt; i++) {
+
+      char *base = iov[i].iov_base;
+      const size_t len = iov[i].iov_len;
+
+      /* do_pread() and do_pwrite() might transfer less than asked: loop */
+      for (size_t done = 0; done < len; done += (size_t)rc) {
+
+         if (write)
+            rc = do_pwrite(h, base + done, len - done, (offt)off);
+         else
+            rc = do_pread(h, base + done, len - done, (offt)off);
+
+         if (rc <= 0)
+            return ret > 0 ? (int)ret : (int)rc;
+
+         ret += rc;
+         off += rc;
+      }
+   }
+
+   return (int)ret;
+}
+
+int sys_preadv(int fd, const struct iovec *u_iov, int u_iovcnt,
+               ulong pos_l, ulong pos_h)
+{
+   const s64 off = (s64)(((u64)pos_h << 32) | pos_l);
+   return do_preadv_pwritev(fd, u_iov, u_iovcnt, off, false);
+}
+
+int sys_pwritev(int fd, const struct iovec *u_iov, int u_iovcnt,
+                ulong pos_l, ulong pos_h)
+{
+   const s64 off = (s64)(((u64)pos_h << 32) | pos_l);
+   return do_preadv_pwritev(fd, u_iov, u_iovcnt, off, true);
+}
+
+/*
+ * Move data between a pipe and another file, without any copy to or from user
+ * space. When moving data out of a pipe, whole pages are moved as they are to
+ * the destination file, if its file system supports that (see splice_page).
+ *
+ * Limitations: `u_off_out` is not supported when moving data out of a pipe and
+ * the flags are ignored.
+ */
+int sys_splice(int fd_in, s64 *u_off_in, int fd_out, s64 *u_off_out,
+               size_t len, u32 flags)
+{
+   struct fs_handle_base *in, *out;
+
+   if (!(in = get_fs_handle(fd_in)) || !(out = get_fs_handle(fd_out)))
+      return -EBADF;
+
+   if (is_pipe_read_end(in)) {
+
+      if (u_off_in)
+         return -ESPIPE;
+
+      if (u_off_out)
+         return -EINVAL;
+
+      if (!out->fops->write || !(out->fl_flags & (O_WRONLY | O_RDWR)))
+         return -EBADF;
+
+      if (out->fl_flags & O_APPEND)
+         return -EINVAL;
+
+      return (int)pipe_splice_to(in, out, MIN(len, MAX_RW_COUNT));
+   }
+
+   if (get_pipe(out)) {
+
+      if (u_off_out)
+         return -ESPIPE;
+
+      /* Moving data from a file to a pipe is exactly what sendfile() does */
+      return sys_sendfile64(fd_out, fd_in, u_off_in, len);
+   }
+
+   return -EINVAL;
+}
+
+/*
+ * Like readv() and writev() on a pipe, but with the user buffers passed
+ * directly to the pipe, without going through the `io_copybuf`.
+ */
+int sys_vmsplice(int fd, const struct iovec *u_iov, ulong nr_segs, u32 flags)
+{
+   struct task *curr = get_curr_task();
+   struct iovec *iov = (void *)curr->args_copybuf;
+   struct fs_handle_base *h;
+   ssize_t ret = 0;
+   ssize_t rc;
+   size_t len;
+
+   if (!(h = get_fs_handle(fd)))
+      return -EBADF;
+
+   if (!get_pipe(h))
+      return -EBADF;
+
+   if (!nr_segs || sizeof(struct iovec) * nr_segs > ARGS_COPYBUF_SIZE)
+      return -EINVAL;
+
+   if (copy_from_user(iov, u_iov, sizeof(struct iovec) * nr_segs))
+      return -EFAULT;
+
+   if (iov_len_overflow(iov, (int)nr_segs))
+      return -EINVAL;
+
+   for (ulong i = 0; i < nr_segs; i++) {
+
+      len = iov[i].iov_len;
+
+      if (check_direct_io_user_buf(iov[i].iov_base, &len))
+         return ret > 0 ? (int)ret : -EFAULT;
+
+      if (is_pipe_read_end(h))
+         rc = vfs_read(h, iov[i].iov_base, len);
+      else
+         rc = vfs_write(h, iov[i].iov_base, len);
+
+      if (rc < 0) {
+
+         if (!ret)
+            ret = rc;
+
+         break;
+      }
+
+      ret += rc;
+
+      if ((size_t)rc < len)
+         break;
+   }
+
+   return (int)ret;
+}
+
 static int
 call_vfs_stat64(const char *u_path,
                 struct stat64 *u_statbuf,
@@ -699,6 +1084,20 @@ int sys_fcntl64(int fd, int cmd, int arg)
       case F_GETFL:
          return hb->fl_flags;
 
+      case F_SETPIPE_SZ:
+      case F_GETPIPE_SZ:
+         {
+            struct pipe *p;
+
+            if (!(p = get_pipe(hb)))
+               return -EBADF;
+
+            if (cmd == F_GETPIPE_SZ)
+               return pipe_get_size(p);
+
+            return pipe_set_size(p, (u32)arg);
+         }
+
       default:
          printk("fcntl64: Ignored unknown cmd %d\n", cmd);
    }
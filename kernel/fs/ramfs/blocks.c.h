@@ -1,38 +1,68 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
-static struct ramfs_block *ramfs_new_block(offt page)
+static struct kmem_cache ramfs_block_cache =
+   STATIC_KMEM_CACHE_INIT(ramfs_block_cache,
+                          "ramfs_block",
+                          sizeof(struct ramfs_block));
+
+/*
+ * Create a block using `vaddr` as its data: it must be a `len` bytes buffer
+ * allocated on the kernel heap. On success, the block owns the buffer.
+ */
+static struct ramfs_block *
+ramfs_new_block_from_buf(offt page, void *vaddr, size_t len)
 {
    struct ramfs_block *b;
 
-   /* Allocate memory for the block object */
-   if (!(b = kalloc_obj(struct ramfs_block)))
-      return NULL;
+   ASSERT(IS_PAGE_ALIGNED(len));
 
-   /* Allocate block's data */
-   if (!(b->vaddr = kzmalloc(PAGE_SIZE))) {
-      kfree_obj(b, struct ramfs_block);
+   /* Allocate memory for the block object */
+   if (!(b = kmem_cache_alloc(&ramfs_block_cache)))
       return NULL;
-   }
 
-   /* Retain the pageframe used by this block */
-   retain_pageframes_mapped_at(get_kernel_pdir(), b->vaddr, PAGE_SIZE);
+   /* Retain the pageframes used by this block */
+   retain_pageframes_mapped_at(get_kernel_pdir(), vaddr, len);
 
    /* Init the block object */
    bintree_node_init(&b->node);
    b->offset = page;
+   b->len = len;
+   b->vaddr = vaddr;
+   return b;
+}
+
+static inline struct ramfs_block *
+ramfs_new_block_from_page(offt page, void *vaddr)
+{
+   return ramfs_new_block_from_buf(page, vaddr, PAGE_SIZE);
+}
+
+static struct ramfs_block *ramfs_new_block(offt page, size_t pages)
+{
+   struct ramfs_block *b;
+   const size_t len = pages << PAGE_SHIFT;
+   void *vaddr;
+
+   /* Allocate block's data */
+   if (!(vaddr = kzmalloc(len)))
+      return NULL;
+
+   if (!(b = ramfs_new_block_from_buf(page, vaddr, len)))
+      kfree2(vaddr, len);
+
    return b;
 }
 
 static void ramfs_destroy_block(struct ramfs_block *b)
 {
-   /* Release the pageframe used by this block */
-   release_pageframes_mapped_at(get_kernel_pdir(), b->vaddr, PAGE_SIZE);
+   /* Release the pageframes used by this block */
+   release_pageframes_mapped_at(get_kernel_pdir(), b->vaddr, b->len);
 
    /* Free the memory pointed by this block */
-   kfree2(b->vaddr, PAGE_SIZE);
+   kfree2(b->vaddr, b->len);
 
    /* Free the memory used by the block object itself */
-   kfree_obj(b, struct ramfs_block);
+   kmem_cache_free(&ramfs_block_cache, b);
 }
 
 static void
@@ -46,7 +76,93 @@ ramfs_append_new_block(struct ramfs_inode *inode, struct ramfs_block *block)
                          offset);
 
    ASSERT(success);
-   inode->blocks_count++;
+   inode->blocks_count += block->len >> PAGE_SHIFT;
+}
+
+static void
+ramfs_remove_block(struct ramfs_inode *inode, struct ramfs_block *block)
+{
+   bintree_remove_ptr(&inode->blocks_tree_root,
+                      block,
+                      struct ramfs_block,
+                      node,
+                      offset);
+
+   inode->blocks_count -= block->len >> PAGE_SHIFT;
+   ramfs_destroy_block(block);
+}
+
+/*
+ * Blocks never overlap: therefore, comparing an offset with a block as
+ * "before", "inside" or "after" it is a valid ordering for bintree_find().
+ */
+static long ramfs_block_off_cmp(const void *obj, const void *valptr)
+{
+   const struct ramfs_block *b = obj;
+   const offt off = *(const offt *)valptr;
+
+   if (b->offset > off)
+      return 1;
+
+   if (b->offset + (offt)b->len <= off)
+      return -1;
+
+   return 0;
+}
+
+/* Get the block containing the byte at offset `off`, if any */
+static struct ramfs_block *
+ramfs_get_block(struct ramfs_inode *inode, offt off)
+{
+   return bintree_find(inode->blocks_tree_root,
+                       &off,
+                       ramfs_block_off_cmp,
+                       struct ramfs_block,
+                       node);
+}
+
+/*
+ * Allocate a new block for the hole containing `page`, in order to write there
+ * `count` bytes starting from `page`.
+ *
+ * When the file is growing sequentially (no blocks after `page`), allocate a
+ * power-of-two number of pages proportional to the current size of the file
+ * or to the size of the write, whichever is bigger, up to RAMFS_MAX_BLOCK_PAGES.
+ * That bounds the wasted memory to the size of the file itself. In all the
+ * other cases (writes in holes) or when the heap is too fragmented for a bigger
+ * allocation, just allocate a single page.
+ */
+static struct ramfs_block *
+ramfs_alloc_block_at(struct ramfs_inode *inode, offt page, offt count)
+{
+   struct ramfs_block *last, *b;
+   size_t want, pages = 1;
+
+   ASSERT(IS_PAGE_ALIGNED(page));
+
+   last = bintree_get_last_obj(inode->blocks_tree_root,
+                               struct ramfs_block,
+                               node);
+
+   if (!last || last->offset + (offt)last->len <= page) {
+
+      want = MAX((size_t)(page >> PAGE_SHIFT),
+                 pow2_round_up_at((size_t)count, PAGE_SIZE) >> PAGE_SHIFT);
+
+      want = MIN(want, (size_t)RAMFS_MAX_BLOCK_PAGES);
+
+      while (pages * 2 <= want)
+         pages *= 2;
+   }
+
+   for (; pages > 0; pages /= 2) {
+      if ((b = ramfs_new_block(page, pages))) {
+         ramfs_append_new_block(inode, b);
+         return b;
+      }
+   }
+
+   return NULL;
 }
 
 static int ramfs_inode_extend(struct ramfs_inode *i, offt new_len)
@@ -2,9 +2,14 @@
 
 #define DEBUG_RAMFS_CREATE_INODE_PRINTK      0
 
+static struct kmem_cache ramfs_inode_cache =
+   STATIC_KMEM_CACHE_INIT(ramfs_inode_cache,
+                          "ramfs_inode",
+                          sizeof(struct ramfs_inode));
+
 static struct ramfs_inode *ramfs_new_inode(struct ramfs_data *d)
 {
-   struct ramfs_inode *i = kzalloc_obj(struct ramfs_inode);
+   struct ramfs_inode *i = kmem_cache_zalloc(&ramfs_inode_cache);
 
    if (!i)
       return NULL;
@@ -45,7 +50,7 @@ ramfs_create_inode_dir(struct ramfs_data *d,
    i->parent_dir = parent;
 
    if (ramfs_dir_add_entry(i, ".", i) < 0) {
-      kfree_obj(i, struct ramfs_inode);
+      kmem_cache_free(&ramfs_inode_cache, i);
       return NULL;
    }
 
@@ -54,7 +59,7 @@ ramfs_create_inode_dir(struct ramfs_data *d,
       struct ramfs_entry *e = i->entries_tree_root;
       ramfs_dir_remove_entry(i, e);
 
-      kfree_obj(i, struct ramfs_inode);
+      kmem_cache_free(&ramfs_inode_cache, i);
       return NULL;
    }
 
@@ -115,7 +120,7 @@ static int ramfs_destroy_inode(struct ramfs_data *d, struct ramfs_inode *i)
    }
 
    rwlock_wp_destroy(&i->rwlock);
-   kfree_obj(i, struct ramfs_inode);
+   kmem_cache_free(&ramfs_inode_cache, i);
    return 0;
 }
 
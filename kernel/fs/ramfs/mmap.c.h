@@ -40,30 +40,36 @@ ramfs_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
 
    while ((b = bintree_in_order_visit_next(&ctx))) {
 
-      if ((size_t)b->offset < off_begin)
+      const size_t b_begin = (size_t)b->offset;
+      const size_t b_end = b_begin + b->len;
+
+      if (b_end <= off_begin)
          continue; /* skip this block */
 
-      if ((size_t)b->offset >= off_end)
+      if (b_begin >= off_end)
          break;
 
-      rc = map_page(pdir,
-                    (void *)vaddr,
-                    KERNEL_VA_TO_PA(b->vaddr),
-                    pg_flags);
-
-      if (rc) {
-
-         /* mmap failed, we have to unmap the pages already mapped */
-         vaddr -= PAGE_SIZE;
-
-         for (; vaddr >= um->vaddr; vaddr -= PAGE_SIZE) {
-            unmap_page_permissive(pdir, (void *)vaddr, false);
+      /* Map the pages of this block falling inside [off_begin, off_end) */
+      for (size_t off = MAX(b_begin, off_begin);
+           off < MIN(b_end, off_end);
+           off += PAGE_SIZE)
+      {
+         vaddr = um->vaddr + (off - off_begin);
+
+         rc = map_page(pdir,
+                       (void *)vaddr,
+                       KERNEL_VA_TO_PA(b->vaddr + (off - b_begin)),
+                       pg_flags);
+
+         if (rc) {
+            /* mmap failed, we have to unmap the pages already mapped */
+            unmap_pages_permissive(pdir,
+                                   (void *)um->vaddr,
+                                   (vaddr - um->vaddr) >> PAGE_SHIFT,
+                                   false);
+            return rc;
          }
-
-         return rc;
       }
-
-      vaddr += PAGE_SIZE;
    }
 
 register_mapping:
@@ -83,6 +89,7 @@ ramfs_handle_fault_int(struct process *pi,
 {
    ulong vaddr = (ulong) vaddrp;
    ulong abs_off;
+   offt page;
    struct ramfs_block *block;
    int rc;
    struct user_mapping *um = process_get_user_mapping(vaddrp);
@@ -110,9 +117,14 @@ ramfs_handle_fault_int(struct process *pi,
    if (abs_off >= (ulong)rh->inode->fsize)
       return false; /* Read/write past EOF */
 
-   if (rw) {
+   page = (offt)(abs_off & PAGE_MASK);
+
+   /* The page might be part of a multi-page block, already allocated */
+   block = ramfs_get_block(rh->inode, page);
+
+   if (!block && rw) {
       /* Create and map on-the-fly a struct ramfs_block */
-      if (!(block = ramfs_new_block((offt)(abs_off & PAGE_MASK))))
+      if (!(block = ramfs_new_block(page, 1)))
          panic("Out-of-memory: unable to alloc a ramfs_block. No OOM killer");
 
       ramfs_append_new_block(rh->inode, block);
@@ -120,7 +132,9 @@ ramfs_handle_fault_int(struct process *pi,
 
    rc = map_page(pi->pdir,
                  (void *)(vaddr & PAGE_MASK),
-                 KERNEL_VA_TO_PA(rw ? block->vaddr : &zero_page),
+                 KERNEL_VA_TO_PA(block
+                                 ? block->vaddr + (page - block->offset)
+                                 : (void *)&zero_page),
                  PAGING_FL_US | PAGING_FL_RW | PAGING_FL_SHARED);
 
    if (rc)
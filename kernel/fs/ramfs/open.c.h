@@ -4,8 +4,12 @@ static const struct file_ops static_ops_ramfs =
 {
    .read = ramfs_read,
    .write = ramfs_write,
+   .pread = ramfs_pread,
+   .pwrite = ramfs_pwrite,
    .readv = ramfs_readv,
    .writev = ramfs_writev,
+   .sendfile = ramfs_sendfile,
+   .splice_page = ramfs_splice_page,
    .seek = ramfs_seek,
    .ioctl = ramfs_ioctl,
    .mmap = ramfs_mmap,
@@ -23,7 +27,7 @@ ramfs_open_int(struct fs *fs, struct ramfs_inode *inode, fs_handle *out, int fl)
 
    vfs_init_fs_handle_base_fields((void *)h, fs, &static_ops_ramfs);
    h->inode = inode;
-   h->spec_flags = VFS_SPFL_MMAP_SUPPORTED;
+   h->spec_flags = VFS_SPFL_MMAP_SUPPORTED | VFS_SPFL_NO_USER_COPY;
    retain_obj(inode);
 
    if (inode->type == VFS_DIR) {
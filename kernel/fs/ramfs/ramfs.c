@@ -372,7 +372,7 @@ struct fs *ramfs_create(void)
    }
 
    fs->device_id = vfs_get_new_device_id();
-   fs->flags = VFS_FS_RW;
+   fs->flags = VFS_FS_RW | VFS_FS_DCACHE;
    fs->fsops = &static_fsops_ramfs;
    return fs;
 }
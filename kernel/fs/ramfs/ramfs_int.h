@@ -20,10 +20,18 @@
 
 struct ramfs_inode;
 
+/*
+ * Max size of a ramfs block, in pages. Files growing sequentially get blocks
+ * (extents) of increasing power-of-two sizes, up to this limit: that keeps the
+ * number of tree nodes low and allows large memcpy() runs for big files.
+ */
+#define RAMFS_MAX_BLOCK_PAGES 32
+
 struct ramfs_block {
 
    struct bintree_node node;
    offt offset;                  /* MUST BE divisible by PAGE_SIZE */
+   size_t len;                   /* a power-of-two multiple of PAGE_SIZE */
    void *vaddr;
 };
 
@@ -66,7 +74,7 @@ struct ramfs_inode {
    struct rwlock_wp rwlock;
    nlink_t nlink;
    mode_t mode;
-   size_t blocks_count;                /* count of page-size blocks */
+   size_t blocks_count;                /* count of allocated pages */
    struct ramfs_inode *parent_dir;
    struct list mappings_list;          /* see ramfs_unmap_past_eof_mappings() */
 
@@ -202,21 +202,28 @@ static int ramfs_inode_truncate(struct ramfs_inode *i, offt len)
       struct ramfs_block *b =
          bintree_get_last_obj(i->blocks_tree_root, struct ramfs_block, node);
 
-      if (!b || b->offset < len)
+      if (!b)
          break;
 
-      /* Remove the block object from the tree */
-      bintree_remove_ptr(&i->blocks_tree_root,
-                         b,
-                         struct ramfs_block,
-                         node,
-                         offset);
+      if (b->offset < len) {
 
-      ramfs_destroy_block(b);
+         /*
+          * The last block survives, but part of it might be past the new EOF:
+          * zero that part, otherwise extending the file later would expose
+          * its old contents again.
+          */
+         const offt b_end = b->offset + (offt)b->len;
+
+         if (b_end > len)
+            bzero(b->vaddr + (len - b->offset), (size_t)(b_end - len));
+
+         break;
+      }
+
+      ramfs_remove_block(i, b);
    }
 
    i->fsize = len;
-   i->blocks_count = pow2_round_up_at((ulong) len, PAGE_SIZE);
    return 0;
 }
 
@@ -249,7 +256,7 @@ static int ramfs_truncate(struct fs *fs, vfs_inode_ptr_t i, offt len)
 }
 
 static ssize_t
-ramfs_read_nolock(struct ramfs_handle *rh, char *buf, size_t len)
+ramfs_read_nolock(struct ramfs_handle *rh, char *buf, size_t len, offt *pos)
 {
    struct ramfs_inode *inode = rh->inode;
    offt tot_read = 0;
@@ -262,36 +269,37 @@ ramfs_read_nolock(struct ramfs_handle *rh, char *buf, size_t len)
    while (buf_rem > 0) {
 
       struct ramfs_block *block;
-      const offt page     = rh->pos & (offt)PAGE_MASK;
-      const offt page_off = rh->pos & (offt)OFFSET_IN_PAGE_MASK;
-      const offt page_rem = (offt)PAGE_SIZE - page_off;
-      const offt file_rem = inode->fsize - rh->pos;
-      const offt to_read  = MIN3(page_rem, buf_rem, file_rem);
+      const offt file_rem = inode->fsize - *pos;
+      offt b_off, b_rem, to_read;
 
-      if (rh->pos >= inode->fsize)
+      if (*pos >= inode->fsize)
          break;
 
-      ASSERT(to_read >= 0);
+      if ((block = ramfs_get_block(inode, *pos))) {
+         b_off = *pos - block->offset;
+         b_rem = (offt)block->len - b_off;
+      } else {
+         /* A hole: read from the zero page, one page at a time */
+         b_off = *pos & (offt)OFFSET_IN_PAGE_MASK;
+         b_rem = (offt)PAGE_SIZE - b_off;
+      }
 
-      if (!to_read)
-         break;
+      to_read = MIN3(b_rem, buf_rem, file_rem);
+      ASSERT(to_read > 0);
 
-      block = bintree_find_ptr(inode->blocks_tree_root,
-                               page,
-                               struct ramfs_block,
-                               node,
-                               offset);
+      /* `buf` might be an user buffer: see VFS_SPFL_NO_USER_COPY */
+      if (copy_to_any_buf(buf + tot_read,
+                          block ? block->vaddr + b_off : zero_page,
+                          (size_t)to_read))
+      {
+         if (!tot_read)
+            return -EFAULT;
 
-      if (block) {
-         /* reading a regular block */
-         memcpy(buf + tot_read, block->vaddr + page_off, (size_t)to_read);
-      } else {
-         /* reading a hole */
-         memset(buf + tot_read, 0, (size_t)to_read);
+         break;
       }
 
       tot_read += to_read;
-      rh->pos  += to_read;
+      *pos     += to_read;
       buf_rem  -= to_read;
    }
 
@@ -305,14 +313,27 @@ static ssize_t ramfs_read(fs_handle h, char *buf, size_t len)
 
    ramfs_file_shlock(h);
    {
-      ret = ramfs_read_nolock(rh, buf, len);
+      ret = ramfs_read_nolock(rh, buf, len, &rh->pos);
+   }
+   ramfs_file_shunlock(h);
+   return ret;
+}
+
+static ssize_t ramfs_pread(fs_handle h, char *buf, size_t len, offt off)
+{
+   struct ramfs_handle *rh = h;
+   ssize_t ret;
+
+   ramfs_file_shlock(h);
+   {
+      ret = ramfs_read_nolock(rh, buf, len, &off);
    }
    ramfs_file_shunlock(h);
    return ret;
 }
 
 static ssize_t
-ramfs_write_nolock(struct ramfs_handle *rh, char *buf, size_t len)
+ramfs_write_nolock(struct ramfs_handle *rh, char *buf, size_t len, offt *pos)
 {
    struct ramfs_inode *inode = rh->inode;
    offt tot_written = 0;
@@ -321,43 +342,51 @@ ramfs_write_nolock(struct ramfs_handle *rh, char *buf, size_t len)
    /* We can be sure it's a file because dirs cannot be open for writing */
    ASSERT(inode->type == VFS_FILE);
 
-   if (rh->fl_flags & O_APPEND)
-      rh->pos = inode->fsize;
-
    while (buf_rem > 0) {
 
       struct ramfs_block *block;
-      const offt page     = rh->pos & (offt)PAGE_MASK;
-      const offt page_off = rh->pos & (offt)OFFSET_IN_PAGE_MASK;
-      const offt page_rem = (offt)PAGE_SIZE - page_off;
-      const offt to_write = MIN(page_rem, buf_rem);
+      offt b_off, to_write;
 
-      ASSERT(to_write > 0);
+      if (!(block = ramfs_get_block(inode, *pos))) {
 
-      block = bintree_find_ptr(inode->blocks_tree_root,
-                               page,
-                               struct ramfs_block,
-                               node,
-                               offset);
+         const offt page = *pos & (offt)PAGE_MASK;
+         const offt page_off = *pos & (offt)OFFSET_IN_PAGE_MASK;
 
-      /* Assert that if page_off > 0, the block is present */
-      ASSERT(!page_off || block);
+         if (!(block = ramfs_alloc_block_at(inode, page, page_off + buf_rem)))
+            break;
+      }
 
-      if (!block) {
+      b_off = *pos - block->offset;
+      to_write = MIN((offt)block->len - b_off, buf_rem);
+      ASSERT(to_write > 0);
 
-         if (!(block = ramfs_new_block(page)))
-            break;
+      /* `buf` might be an user buffer: see VFS_SPFL_NO_USER_COPY */
+      if (copy_from_any_buf(block->vaddr + b_off,
+                            buf + tot_written,
+                            (size_t)to_write))
+      {
+         /*
+          * The copy might have been interrupted by a fault after writing part
+          * of the data. Past EOF, that data must not stay in the block: holes
+          * are expected to read as zeros, after the file gets extended.
+          */
+         const offt eof_off = MAX(inode->fsize - block->offset, b_off);
+
+         if (eof_off < b_off + to_write)
+            bzero(block->vaddr + eof_off, (size_t)(b_off + to_write - eof_off));
+
+         if (!tot_written)
+            return -EFAULT;
 
-         ramfs_append_new_block(inode, block);
+         break;
       }
 
-      memcpy(block->vaddr + page_off, buf + tot_written, (size_t)to_write);
       tot_written += to_write;
       buf_rem     -= to_write;
-      rh->pos     += to_write;
+      *pos        += to_write;
 
-      if (rh->pos > inode->fsize)
-         inode->fsize = rh->pos;
+      if (*pos > inode->fsize)
+         inode->fsize = *pos;
    }
 
    if (len > 0 && !tot_written)
@@ -373,12 +402,162 @@ static ssize_t ramfs_write(fs_handle h, char *buf, size_t len)
 
    ramfs_file_exlock(h);
    {
-      ret = ramfs_write_nolock(rh, buf, len);
+      if (rh->fl_flags & O_APPEND)
+         rh->pos = rh->inode->fsize;
+
+      ret = ramfs_write_nolock(rh, buf, len, &rh->pos);
+   }
+   ramfs_file_exunlock(h);
+   return ret;
+}
+
+static ssize_t ramfs_pwrite(fs_handle h, char *buf, size_t len, offt off)
+{
+   struct ramfs_handle *rh = h;
+   ssize_t ret;
+
+   ramfs_file_exlock(h);
+   {
+      ret = ramfs_write_nolock(rh, buf, len, &off);
    }
    ramfs_file_exunlock(h);
    return ret;
 }
 
+/*
+ * Write the file's data to `out` directly from the ramfs blocks, holding the
+ * inode's shared lock. That's possible only when `out` is non-blocking: a full
+ * pipe or a stopped tty would otherwise keep every writer of this file waiting
+ * for as long as `out` is stalled (or forever, if out's reader is waiting for
+ * one of them). In all the other cases, and when `out` is a ramfs file as well
+ * (holding two inode locks at the same time could lead to deadlocks), copy each
+ * chunk to the `io_copybuf` first and write it after releasing the lock.
+ */
+static ssize_t
+ramfs_sendfile(fs_handle h, fs_handle out, offt *pos, size_t count)
+{
+   struct ramfs_handle *rh = h;
+   struct ramfs_inode *inode = rh->inode;
+   struct fs_handle_base *out_hb = out;
+   const bool bounce =
+      out_hb->fops->sendfile == &ramfs_sendfile ||
+      !(out_hb->fl_flags & O_NONBLOCK);
+   char *const buf = get_curr_task()->io_copybuf;
+   ssize_t tot = 0;
+   ssize_t rc;
+
+   if (inode->type != VFS_FILE)
+      return -EINVAL;
+
+   ramfs_file_shlock(h);
+
+   while (count > 0) {
+
+      struct ramfs_block *block;
+      const offt file_rem = inode->fsize - *pos;
+      offt b_off, b_rem, to_send;
+      void *src;
+
+      if (file_rem <= 0)
+         break;
+
+      if ((block = ramfs_get_block(inode, *pos))) {
+         b_off = *pos - block->offset;
+         b_rem = (offt)block->len - b_off;
+         src = block->vaddr + b_off;
+      } else {
+         b_off = *pos & (offt)OFFSET_IN_PAGE_MASK;
+         b_rem = (offt)PAGE_SIZE - b_off;
+         src = zero_page;
+      }
+
+      to_send = MIN3(b_rem, (offt)count, file_rem);
+
+      if (bounce)
+         to_send = MIN(to_send, (offt)IO_COPYBUF_SIZE);
+
+      if (bounce) {
+
+         memcpy(buf, src, (size_t)to_send);
+         ramfs_file_shunlock(h);
+         {
+            rc = vfs_write(out, buf, (size_t)to_send);
+         }
+         ramfs_file_shlock(h);
+
+      } else {
+
+         rc = vfs_write(out, src, (size_t)to_send);
+      }
+
+      if (rc <= 0) {
+
+         if (!tot)
+            tot = rc;
+
+         break;
+      }
+
+      tot   += rc;
+      *pos  += rc;
+      count -= (size_t)rc;
+
+      if (rc < to_send)
+         break;
+   }
+
+   ramfs_file_shunlock(h);
+   return tot;
+}
+
+/*
+ * Insert `page`, a full page of data allocated on the kernel heap, in the file
+ * at the current position, without copying it. That's possible only when the
+ * position is page-aligned and there's no block there yet: in all the other
+ * cases, the caller is expected to fall back to a regular write.
+ */
+static int ramfs_splice_page(fs_handle h, void *page)
+{
+   struct ramfs_handle *rh = h;
+   struct ramfs_inode *inode = rh->inode;
+   struct ramfs_block *block;
+   int rc = 0;
+
+   if (inode->type != VFS_FILE)
+      return inode->type == VFS_DIR ? -EISDIR : -EINVAL;
+
+   ramfs_file_exlock(h);
+   {
+      if (rh->fl_flags & O_APPEND)
+         rh->pos = inode->fsize;
+
+      if (rh->pos & (offt)OFFSET_IN_PAGE_MASK) {
+         rc = -EINVAL;
+         goto out;
+      }
+
+      if (ramfs_get_block(inode, rh->pos)) {
+         rc = -EEXIST;
+         goto out;
+      }
+
+      if (!(block = ramfs_new_block_from_page(rh->pos, page))) {
+         rc = -ENOMEM;
+         goto out;
+      }
+
+      ramfs_append_new_block(inode, block);
+      rh->pos += PAGE_SIZE;
+
+      if (rh->pos > inode->fsize)
+         inode->fsize = rh->pos;
+
+   out:;
+   }
+   ramfs_file_exunlock(h);
+   return rc;
+}
+
 static ssize_t
 ramfs_readv_nolock(struct ramfs_handle *rh, const struct iovec *iov, int iovcnt)
 {
@@ -390,7 +569,7 @@ ramfs_readv_nolock(struct ramfs_handle *rh, const struct iovec *iov, int iovcnt)
    for (int i = 0; i < iovcnt; i++) {
 
       len = MIN(iov[i].iov_len, IO_COPYBUF_SIZE);
-      rc = ramfs_read_nolock(rh, curr->io_copybuf, len);
+      rc = ramfs_read_nolock(rh, curr->io_copybuf, len, &rh->pos);
 
       if (rc < 0) {
          ret = rc;
@@ -438,7 +617,7 @@ ramfs_writev_nolock(struct ramfs_handle *h, const struct iovec *iov, int iovcnt)
       if (copy_from_user(curr->io_copybuf, iov[i].iov_base, len))
          return -EFAULT;
 
-      rc = ramfs_write_nolock(h, curr->io_copybuf, len);
+      rc = ramfs_write_nolock(h, curr->io_copybuf, len, &h->pos);
 
       if (rc < 0) {
          ret = rc;
@@ -462,6 +641,9 @@ ramfs_writev(fs_handle h, const struct iovec *iov, int iovcnt)
 
    ramfs_file_exlock(h);
    {
+      if (rh->fl_flags & O_APPEND)
+         rh->pos = rh->inode->fsize;
+
       ret = ramfs_writev_nolock(rh, iov, iovcnt);
    }
    ramfs_file_exunlock(h);
@@ -10,18 +10,25 @@
 #include <tilck/kernel/process_mm.h>
 #include <tilck/kernel/user.h>
 #include <tilck/kernel/debug_utils.h>
+#include <tilck/kernel/epoll.h>
 
 #include <dirent.h> // system header
 
 #include "../fs_int.h"
 #include "vfs_mp.c.h"
 #include "vfs_locking.c.h"
+#include "vfs_dcache.c.h"
 #include "vfs_resolve.c.h"
 #include "vfs_getdents.c.h"
 #include "vfs_op_ready.c.h"
 
 static u32 next_device_id;
 
+void init_vfs(void)
+{
+   init_vfs_dcache();
+}
+
 void
 vfs_init_fs_handle_base_fields(struct fs_handle_base *hb,
                                struct fs *fs,
@@ -43,6 +50,8 @@ void vfs_close2(struct process *pi, fs_handle h)
    struct fs_handle_base *hb = (struct fs_handle_base *) h;
    struct fs *fs = hb->fs;
 
+   epoll_on_handle_close(h);
+
    if (!pi->vforked)
       remove_all_mappings_of_handle(pi, h);
 
@@ -232,6 +241,9 @@ vfs_open_impl(struct fs *fs, struct vfs_path *p,
    if ((rc = fs->fsops->open(p, out, flags, mode)))
       return rc;
 
+   if (!p->fs_path.inode)
+      vfs_dcache_invalidate(p); /* a new file has been created */
+
    {
       struct fs_handle_base *hb = *out;
 
@@ -294,6 +306,8 @@ int vfs_stat64(const char *path, struct stat64 *statbuf, bool res_last_sl)
 static ALWAYS_INLINE int
 vfs_mkdir_impl(struct fs *fs, struct vfs_path *p, mode_t mode, ulong x, ulong y)
 {
+   int rc;
+
    if (!fs->fsops->mkdir)
       return -EPERM;
 
@@ -303,7 +317,10 @@ vfs_mkdir_impl(struct fs *fs, struct vfs_path *p, mode_t mode, ulong x, ulong y)
    if (p->fs_path.inode)
       return -EEXIST;
 
-   return fs->fsops->mkdir(p, mode);
+   if (!(rc = fs->fsops->mkdir(p, mode)))
+      vfs_dcache_invalidate(p);
+
+   return rc;
 }
 
 int vfs_mkdir(const char *path, mode_t mode)
@@ -322,6 +339,8 @@ int vfs_mkdir(const char *path, mode_t mode)
 static ALWAYS_INLINE int
 vfs_rmdir_impl(struct fs *fs, struct vfs_path *p, ulong u1, ulong u2, ulong u3)
 {
+   int rc;
+
    if (!fs->fsops->rmdir)
       return -EPERM;
 
@@ -331,7 +350,10 @@ vfs_rmdir_impl(struct fs *fs, struct vfs_path *p, ulong u1, ulong u2, ulong u3)
    if (!p->fs_path.inode)
       return -ENOENT;
 
-   return fs->fsops->rmdir(p);
+   if (!(rc = fs->fsops->rmdir(p)))
+      vfs_dcache_invalidate_fs(fs); /* see vfs_dcache.c.h */
+
+   return rc;
 }
 
 int vfs_rmdir(const char *path)
@@ -348,6 +370,8 @@ int vfs_rmdir(const char *path)
 static ALWAYS_INLINE int
 vfs_unlink_impl(struct fs *fs, struct vfs_path *p, ulong u1, ulong u2, ulong u3)
 {
+   int rc;
+
    if (!fs->fsops->unlink)
       return -EPERM;
 
@@ -357,7 +381,10 @@ vfs_unlink_impl(struct fs *fs, struct vfs_path *p, ulong u1, ulong u2, ulong u3)
    if (!p->fs_path.inode)
       return -ENOENT;
 
-   return fs->fsops->unlink(p);
+   if (!(rc = fs->fsops->unlink(p)))
+      vfs_dcache_invalidate(p);
+
+   return rc;
 }
 
 int vfs_unlink(const char *path)
@@ -418,6 +445,8 @@ static ALWAYS_INLINE int
 vfs_symlink_impl(struct fs *fs,
                  struct vfs_path *p, const char *target, ulong u1, ulong u2)
 {
+   int rc;
+
    if (!fs->fsops->symlink)
       return -EPERM;
 
@@ -427,7 +456,10 @@ vfs_symlink_impl(struct fs *fs,
    if (p->fs_path.inode)
       return -EEXIST; /* the linkpath already exists! */
 
-   return fs->fsops->symlink(target, p);
+   if (!(rc = fs->fsops->symlink(target, p)))
+      vfs_dcache_invalidate(p);
+
+   return rc;
 }
 
 int vfs_symlink(const char *target, const char *linkpath)
@@ -633,6 +665,14 @@ vfs_rename_or_link(const char *oldpath,
          : -EROFS /* read-only struct fs */
       : -EPERM; /* not supported */
 
+   if (!rc) {
+
+      if (func == fs->fsops->link)
+         vfs_dcache_invalidate(&newp);
+      else
+         vfs_dcache_invalidate_fs(fs); /* see vfs_dcache.c.h */
+   }
+
    /* We're done, release fs's exlock and its retain count */
    vfs_smart_fs_unlock(fs, true);
    release_obj(fs);
@@ -807,6 +847,171 @@ ssize_t vfs_writev(fs_handle h, const struct iovec *iov, int iovcnt)
    return ret;
 }
 
+/*
+ * Emulate pread() or pwrite() by temporarily moving the file position. Unlike
+ * the real ones, this is not atomic: other users of the same handle might
+ * observe the position changing.
+ */
+static ssize_t
+vfs_rw_at_with_seek(fs_handle h, void *buf, size_t size, offt off, bool write)
+{
+   struct fs_handle_base *hb = h;
+   offt saved_pos;
+   ssize_t rc;
+
+   if (!hb->fops->seek)
+      return -ESPIPE;
+
+   if ((saved_pos = hb->fops->seek(h, 0, SEEK_CUR)) < 0)
+      return saved_pos;
+
+   if ((rc = hb->fops->seek(h, off, SEEK_SET)) < 0)
+      return rc;
+
+   if (write)
+      rc = hb->fops->write(h, buf, size);
+   else
+      rc = hb->fops->read(h, buf, size);
+
+   hb->fops->seek(h, saved_pos, SEEK_SET);
+   return rc;
+}
+
+ssize_t vfs_pread(fs_handle h, void *buf, size_t buf_size, offt off)
+{
+   NO_TEST_ASSERT(is_preemption_enabled());
+   ASSERT(h != NULL);
+
+   struct fs_handle_base *hb = (struct fs_handle_base *) h;
+
+   if (!hb->fops->read)
+      return -EBADF;
+
+   if ((hb->fl_flags & O_WRONLY) && !(hb->fl_flags & O_RDWR))
+      return -EBADF; /* file not opened for reading */
+
+   if (off < 0)
+      return -EINVAL;
+
+   if (!hb->fops->pread)
+      return vfs_rw_at_with_seek(h, buf, buf_size, off, false);
+
+   return hb->fops->pread(h, buf, buf_size, off);
+}
+
+ssize_t vfs_pwrite(fs_handle h, void *buf, size_t buf_size, offt off)
+{
+   NO_TEST_ASSERT(is_preemption_enabled());
+   ASSERT(h != NULL);
+
+   struct fs_handle_base *hb = (struct fs_handle_base *) h;
+
+   if (!hb->fops->write)
+      return -EBADF;
+
+   if (!(hb->fl_flags & (O_WRONLY | O_RDWR)))
+      return -EBADF; /* file not opened for writing */
+
+   if (off < 0)
+      return -EINVAL;
+
+   if (!hb->fops->pwrite)
+      return vfs_rw_at_with_seek(h, buf, buf_size, off, true);
+
+   return hb->fops->pwrite(h, buf, buf_size, off);
+}
+
+/*
+ * Write to `out` up to `count` bytes read from `in`, without any copy to or
+ * from user space. If `pos` is not NULL, read starting from *pos and update
+ * it, leaving `in`'s file position unchanged. Otherwise, use and update `in`'s
+ * file position, as read() would do.
+ */
+ssize_t vfs_sendfile(fs_handle out, fs_handle in, offt *pos, size_t count)
+{
+   struct fs_handle_base *in_hb = in;
+   struct fs_handle_base *out_hb = out;
+   char *const buf = get_curr_task()->io_copybuf;
+   ssize_t ret = 0;
+   ssize_t rc, wrc;
+   size_t len;
+
+   NO_TEST_ASSERT(is_preemption_enabled());
+
+   if (!in_hb->fops->read)
+      return -EBADF;
+
+   if ((in_hb->fl_flags & O_WRONLY) && !(in_hb->fl_flags & O_RDWR))
+      return -EBADF; /* file not opened for reading */
+
+   if (!out_hb->fops->write)
+      return -EBADF;
+
+   if (!(out_hb->fl_flags & (O_WRONLY | O_RDWR)))
+      return -EBADF; /* file not opened for writing */
+
+   if (out_hb->fl_flags & O_APPEND)
+      return -EINVAL; /* Not supported, like on Linux */
+
+   if (in == out)
+      return -EINVAL;
+
+   if (in_hb->fops->sendfile)
+      return in_hb->fops->sendfile(in, out, pos ? pos : &in_hb->pos, count);
+
+   /*
+    * The file system does not support sendfile(): emulate it with read() and
+    * write() through the `io_copybuf`. When `pos` is not NULL, read at *pos
+    * with vfs_pread(), which leaves `in`'s file position unchanged.
+    */
+
+   while (count > 0) {
+
+      len = MIN(count, IO_COPYBUF_SIZE);
+      rc = pos ? vfs_pread(in, buf, len, *pos) : vfs_read(in, buf, len);
+
+      if (rc <= 0) {
+
+         if (!ret)
+            ret = rc;
+
+         break;
+      }
+
+      /* Write everything we've read, if possible */
+      for (ssize_t written = 0; written < rc; written += wrc) {
+
+         wrc = vfs_write(out, buf + written, (size_t)(rc - written));
+
+         if (wrc <= 0) {
+
+            /*
+             * Don't lose the data read but not written (e.g. because `out` is
+             * a full non-blocking pipe): with `pos`, just don't count it.
+             * Otherwise, move `in`'s position back, when it's seekable.
+             */
+            if (pos)
+               *pos += written;
+            else if (in_hb->fops->seek)
+               vfs_seek(in, -(s64)(rc - written), SEEK_CUR);
+
+            return ret + written > 0 ? ret + written : wrc;
+         }
+      }
+
+      if (pos)
+         *pos += rc;
+
+      ret += rc;
+      count -= (size_t)rc;
+
+      if ((size_t)rc < len)
+         break; /* Don't block waiting for more data (e.g. on pipes) */
+   }
+
+   return ret;
+}
+
 u32 vfs_get_new_device_id(void)
 {
    return next_device_id++;
@@ -827,6 +1032,7 @@ struct fs *create_fs_obj(const char *type)
 void destory_fs_obj(struct fs *fs)
 {
    ASSERT(!fs->pss_lock_root);
+   vfs_dcache_invalidate_fs(fs);
    kfree_obj(fs, struct fs);
 }
 
@@ -0,0 +1,271 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * VFS dentry cache
+ * -------------------
+ *
+ * A small, fixed-size cache of the results of fsops->get_entry(), keyed by
+ * (device_id, parent dir inode, name). Negative results (no such entry) are
+ * cached as well, with fs_path.inode == NULL. Only file systems having the
+ * VFS_FS_DCACHE flag participate: their namespace must change only through
+ * the VFS functions below, which invalidate the affected entries.
+ *
+ * The device_id is used instead of the struct fs pointer because it's never
+ * reused, while a struct fs might be allocated at the same address of a
+ * destroyed one. Inode pointers can be reused as well: that's why removing
+ * a name drops its entry and removing (rmdir) or moving (rename) a directory
+ * drops all the entries of its file system.
+ *
+ * Locking: lookups and insertions are done while holding (at least) the
+ * shared lock of the struct fs, while all the namespace-changing operations
+ * hold its exclusive lock. Therefore, a get_entry() result cannot become
+ * stale before being inserted in the cache. The cache itself is protected by
+ * its own mutex.
+ */
+
+#define DCACHE_ENTRIES              128
+#define DCACHE_BUCKETS               64
+#define DCACHE_NAME_MAX              32
+
+struct dcache_entry {
+
+   struct list_node bucket_node;
+   struct list_node lru_node;
+
+   u32 device_id;
+   u32 hash;
+   vfs_inode_ptr_t dir_inode;
+   struct fs_path fs_path;
+   u8 name_len;                        /* 0 means: unused entry */
+   char name[DCACHE_NAME_MAX];
+};
+
+static struct kmutex dcache_mutex = STATIC_KMUTEX_INIT(dcache_mutex, 0);
+static struct dcache_entry dcache_entries[DCACHE_ENTRIES];
+static struct list dcache_buckets[DCACHE_BUCKETS];
+static struct list dcache_lru = STATIC_LIST_INIT(dcache_lru);
+static struct vfs_dcache_stats dcache_stats;
+
+static void init_vfs_dcache(void)
+{
+   list_init(&dcache_lru);
+
+   for (int i = 0; i < DCACHE_BUCKETS; i++)
+      list_init(&dcache_buckets[i]);
+
+   for (int i = 0; i < DCACHE_ENTRIES; i++) {
+      dcache_entries[i].name_len = 0;
+      list_node_init(&dcache_entries[i].bucket_node);
+      list_add_tail(&dcache_lru, &dcache_entries[i].lru_node);
+   }
+
+   bzero(&dcache_stats, sizeof(dcache_stats));
+}
+
+static inline u32 dcache_name_hash(const char *name, size_t len)
+{
+   return fnv1a_hash(name, len, false);
+}
+
+static inline struct list *
+dcache_bucket(u32 device_id, vfs_inode_ptr_t dir_inode, u32 hash)
+{
+   const u32 h = hash ^ device_id ^ (u32)((ulong)dir_inode >> 4);
+   return &dcache_buckets[h % DCACHE_BUCKETS];
+}
+
+static inline bool
+dcache_can_cache(struct fs *fs, const char *name, ssize_t name_len)
+{
+   return (fs->flags & VFS_FS_DCACHE) &&
+          name_len > 0 && name_len <= DCACHE_NAME_MAX;
+}
+
+static struct dcache_entry *
+dcache_find_nolock(struct fs *fs,
+                   vfs_inode_ptr_t dir_inode,
+                   const char *name,
+                   size_t name_len,
+                   u32 hash)
+{
+   struct list *b = dcache_bucket(fs->device_id, dir_inode, hash);
+   struct dcache_entry *e;
+
+   ASSERT(kmutex_is_curr_task_holding_lock(&dcache_mutex));
+
+   list_for_each_ro(e, b, bucket_node) {
+
+      if (e->hash == hash &&
+          e->dir_inode == dir_inode &&
+          e->device_id == fs->device_id &&
+          e->name_len == name_len &&
+          !memcmp(e->name, name, name_len))
+      {
+         return e;
+      }
+   }
+
+   return NULL;
+}
+
+static void dcache_drop_nolock(struct dcache_entry *e)
+{
+   ASSERT(e->name_len > 0);
+
+   list_remove(&e->bucket_node);
+   list_node_init(&e->bucket_node);
+   e->name_len = 0;
+
+   /* Make it the first candidate for reuse */
+   list_remove(&e->lru_node);
+   list_add_tail(&dcache_lru, &e->lru_node);
+}
+
+/*
+ * Look for (fs, dir_inode, name) in the cache. On a hit, copy the cached
+ * result in `fs_path` and return true.
+ */
+static bool
+vfs_dcache_lookup(struct fs *fs,
+                  vfs_inode_ptr_t dir_inode,
+                  const char *name,
+                  ssize_t name_len,
+                  struct fs_path *fs_path)
+{
+   struct dcache_entry *e;
+   u32 hash;
+
+   if (!dcache_can_cache(fs, name, name_len))
+      return false;
+
+   hash = dcache_name_hash(name, (size_t)name_len);
+
+   kmutex_lock(&dcache_mutex);
+   {
+      if ((e = dcache_find_nolock(fs, dir_inode, name, (size_t)name_len, hash)))
+      {
+         *fs_path = e->fs_path;
+
+         /* Move the entry at the head of the LRU list */
+         list_remove(&e->lru_node);
+         list_add_head(&dcache_lru, &e->lru_node);
+
+         dcache_stats.hits++;
+         dcache_stats.neg_hits += !e->fs_path.inode;
+
+      } else {
+
+         dcache_stats.misses++;
+      }
+   }
+   kmutex_unlock(&dcache_mutex);
+   return e != NULL;
+}
+
+static void
+vfs_dcache_insert(struct fs *fs,
+                  vfs_inode_ptr_t dir_inode,
+                  const char *name,
+                  ssize_t name_len,
+                  const struct fs_path *fs_path)
+{
+   struct dcache_entry *e;
+   u32 hash;
+
+   if (!dcache_can_cache(fs, name, name_len))
+      return;
+
+   hash = dcache_name_hash(name, (size_t)name_len);
+
+   kmutex_lock(&dcache_mutex);
+   {
+      e = dcache_find_nolock(fs, dir_inode, name, (size_t)name_len, hash);
+
+      if (!e) {
+
+         /* Recycle the least recently used entry */
+         e = list_last_obj(&dcache_lru, struct dcache_entry, lru_node);
+
+         if (e->name_len) {
+            dcache_drop_nolock(e);
+            dcache_stats.evictions++;
+         }
+
+         e->device_id = fs->device_id;
+         e->hash = hash;
+         e->dir_inode = dir_inode;
+         e->name_len = (u8)name_len;
+         memcpy(e->name, name, (size_t)name_len);
+
+         list_add_tail(dcache_bucket(fs->device_id, dir_inode, hash),
+                       &e->bucket_node);
+      }
+
+      e->fs_path = *fs_path;
+      list_remove(&e->lru_node);
+      list_add_head(&dcache_lru, &e->lru_node);
+   }
+   kmutex_unlock(&dcache_mutex);
+}
+
+/* Drop the entry (if any) for the last component of the resolved path `p` */
+static void vfs_dcache_invalidate(struct vfs_path *p)
+{
+   struct fs *fs = p->fs;
+   const char *name = p->last_comp;
+   struct dcache_entry *e;
+   ssize_t name_len;
+
+   if (!(fs->flags & VFS_FS_DCACHE))
+      return;
+
+   for (name_len = 0; !slash_or_nul(name[name_len]); name_len++) { }
+
+   if (!dcache_can_cache(fs, name, name_len))
+      return;
+
+   kmutex_lock(&dcache_mutex);
+   {
+      e = dcache_find_nolock(fs,
+                             p->fs_path.dir_inode,
+                             name,
+                             (size_t)name_len,
+                             dcache_name_hash(name, (size_t)name_len));
+
+      if (e) {
+         dcache_drop_nolock(e);
+         dcache_stats.invalidations++;
+      }
+   }
+   kmutex_unlock(&dcache_mutex);
+}
+
+/* Drop all the entries belonging to `fs` */
+static void vfs_dcache_invalidate_fs(struct fs *fs)
+{
+   if (!(fs->flags & VFS_FS_DCACHE))
+      return;
+
+   kmutex_lock(&dcache_mutex);
+   {
+      for (int i = 0; i < DCACHE_ENTRIES; i++) {
+
+         struct dcache_entry *e = &dcache_entries[i];
+
+         if (e->name_len && e->device_id == fs->device_id) {
+            dcache_drop_nolock(e);
+            dcache_stats.invalidations++;
+         }
+      }
+   }
+   kmutex_unlock(&dcache_mutex);
+}
+
+void vfs_dcache_get_stats(struct vfs_dcache_stats *stats)
+{
+   kmutex_lock(&dcache_mutex);
+   {
+      *stats = dcache_stats;
+   }
+   kmutex_unlock(&dcache_mutex);
+}
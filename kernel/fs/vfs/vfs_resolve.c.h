@@ -70,7 +70,21 @@ __vfs_resolve_get_entry(vfs_inode_ptr_t idir,
 {
    DEBUG_VALIDATE_STACK_PTR();
 
-   vfs_get_entry(rp->fs, idir, pc, path - pc, &rp->fs_path);
+   /*
+    * Here `rp` still contains the parent's path. Use the dentry cache only
+    * for lookups in actual directories: that way, we don't have to care about
+    * cached negative entries under files, when their inodes get destroyed.
+    */
+   if (rp->fs_path.type != VFS_DIR) {
+
+      vfs_get_entry(rp->fs, idir, pc, path - pc, &rp->fs_path);
+
+   } else if (!vfs_dcache_lookup(rp->fs, idir, pc, path - pc, &rp->fs_path)) {
+
+      vfs_get_entry(rp->fs, idir, pc, path - pc, &rp->fs_path);
+      vfs_dcache_insert(rp->fs, idir, pc, path - pc, &rp->fs_path);
+   }
+
    rp->last_comp = pc;
 
    struct fs *target_fs = mp_get_retained_at(rp->fs, rp->fs_path.inode);
@@ -0,0 +1,363 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/atomics.h>
+
+#include <tilck/kernel/syscalls.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/paging.h>
+#include <tilck/kernel/paging_hw.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/fault_resumable.h>
+
+#include <linux/futex.h> // system header
+
+/*
+ * Futexes
+ * ----------
+ *
+ * The kernel gets involved only in the contended case: FUTEX_WAIT puts the
+ * current task to sleep on the wait_list of a hash bucket, using its wobj with
+ * type WOBJ_FUTEX and the physical address of the futex word as ptr. That key
+ * makes futexes work across processes sharing memory (MAP_SHARED mappings) as
+ * well. FUTEX_WAKE walks the bucket and wakes up the tasks having the same key.
+ *
+ * The check of the futex word's value and the enqueue happen with preemption
+ * disabled, so no wake-up can be lost in the meanwhile. Spurious wake-ups are
+ * possible (e.g. because of signals), as with any futex implementation.
+ *
+ * The physical address of a page still shared after fork() (copy-on-write) or
+ * of a never-written page (zero page) changes on the first write: therefore,
+ * the page of the futex word is always faulted-in for writing before getting
+ * its key (see futex_prefault()). Futexes on read-only pages are rejected with
+ * -EFAULT.
+ */
+
+#define FUTEX_HASH_BUCKETS          64
+
+static struct list futex_buckets[FUTEX_HASH_BUCKETS];
+
+static inline struct list *futex_bucket(ulong key)
+{
+   const u32 h = (u32)(key >> 2) * 0x9E3779B1u; /* Fibonacci hashing */
+   struct list *b = &futex_buckets[h >> (32 - 6)];
+
+   STATIC_ASSERT(FUTEX_HASH_BUCKETS == (1 << 6));
+
+   if (list_is_null(b))
+      list_init(b);
+
+   return b;
+}
+
+/*
+ * Read the futex word with an atomic add of 0: that's a write access which
+ * doesn't change the value, but makes the page fault (and get its own copy)
+ * when it's a copy-on-write or a zero page.
+ */
+static void futex_read_for_write(u32 *uaddr, u32 *val)
+{
+   *val = atomic_fetch_add_explicit((ATOMIC(u32) *)uaddr, 0, mo_relaxed);
+}
+
+/*
+ * Validate `uaddr` and make sure its page is mapped and writable, reading the
+ * futex word. Must be called with preemption enabled, as it might page-fault.
+ */
+static int futex_prefault(u32 *uaddr, u32 *val)
+{
+   u32 faults;
+
+   if ((ulong)uaddr & (sizeof(u32) - 1))
+      return -EINVAL;
+
+   if (user_out_of_range(uaddr, sizeof(u32)))
+      return -EFAULT;
+
+   faults = fault_resumable_call(PAGE_FAULT_MASK,
+                                 futex_read_for_write,
+                                 2,
+                                 uaddr,
+                                 val);
+
+   return !faults ? 0 : -EFAULT;
+}
+
+/* Get the futex key of `uaddr`: must be called with preemption disabled */
+static int futex_get_key(u32 *uaddr, ulong *key)
+{
+   ASSERT(!is_preemption_enabled());
+
+   if (get_mapping2(get_curr_pdir(), uaddr, key) < 0)
+      return -EFAULT; /* The page has been unmapped in the meanwhile */
+
+   return 0;
+}
+
+/*
+ * Wake up to `nr_wake` tasks waiting on `key` and then move up to `nr_requeue`
+ * of the remaining ones to `key2`. Returns the number of woken up tasks plus
+ * the number of requeued ones.
+ *
+ * The walk stops at the bucket's original tail: when `key2` hashes to the same
+ * bucket, the requeued waiters are appended to the list being walked and must
+ * not be visited again.
+ */
+static int
+futex_wake_int(ulong key, int nr_wake, ulong key2, int nr_requeue)
+{
+   struct list *b = futex_bucket(key);
+   struct list_node *const last = b->last;
+   struct wait_obj *wo, *temp;
+   int woken = 0, requeued = 0;
+   bool done = false;
+
+   ASSERT(!is_preemption_enabled());
+   ASSERT(key != key2 || !nr_requeue);
+
+   list_for_each(wo, temp, b, wait_list_node) {
+
+      struct task *ti = CONTAINER_OF(wo, struct task, wobj);
+
+      if (done || (woken >= nr_wake && requeued >= nr_requeue))
+         break;
+
+      done = &wo->wait_list_node == last;
+
+      ASSERT(wo->type == WOBJ_FUTEX);
+
+      if ((ulong)wait_obj_get_ptr(wo) != key)
+         continue;
+
+      if (ti->state != TASK_STATE_SLEEPING)
+         continue; /* Timed out or signaled: it will remove itself */
+
+      if (woken < nr_wake) {
+
+         task_cancel_wakeup_timer(ti);
+         wake_up(ti); /* NOTE: it resets the wobj */
+         woken++;
+
+      } else {
+
+         wait_obj_reset(wo);
+         wait_obj_set(wo, WOBJ_FUTEX, TO_PTR(key2), NO_EXTRA,
+                      futex_bucket(key2));
+         requeued++;
+      }
+   }
+
+   return woken + requeued;
+}
+
+static int futex_wait(u32 *uaddr, u32 val, const struct k_timespec64 *timeout)
+{
+   struct task *curr = get_curr_task();
+   u64 ticks = 0;
+   u32 curr_val;
+   ulong key;
+   void *ptr;
+   u32 rem;
+   int rc;
+
+   if (timeout) {
+
+      if (timeout->tv_sec < 0 || timeout->tv_nsec < 0 ||
+          timeout->tv_nsec >= BILLION)
+      {
+         return -EINVAL;
+      }
+
+      ticks = MAX(timespec_to_ticks(timeout), (u64)1);
+   }
+
+   if ((rc = futex_prefault(uaddr, &curr_val)))
+      return rc;
+
+   disable_preemption();
+
+   if ((rc = futex_get_key(uaddr, &key))) {
+      enable_preemption();
+      return rc;
+   }
+
+   /* Re-read the value, as it might have changed before disabling preemption */
+   if (virtual_read(get_curr_pdir(), uaddr, &curr_val, sizeof(u32)) < 0) {
+      enable_preemption();
+      return -EFAULT;
+   }
+
+   if (curr_val != val) {
+      enable_preemption();
+      return -EAGAIN;
+   }
+
+   prepare_to_wait_on(WOBJ_FUTEX, TO_PTR(key), NO_EXTRA, futex_bucket(key));
+
+   if (ticks)
+      task_set_wakeup_timer(curr, (u32)MIN(ticks, (u64)UINT32_MAX));
+
+   enter_sleep_wait_state();
+
+   /* ------------------- We've been woken up ------------------- */
+
+   /* futex_wake_int() resets our wobj: if it's still set, it wasn't a wake */
+   ptr = wait_obj_reset(&curr->wobj);
+   rem = task_cancel_wakeup_timer(curr);
+
+   if (!ptr)
+      return 0;
+
+   if (pending_signals())
+      return -EINTR;
+
+   if (ticks && !rem)
+      return -ETIMEDOUT;
+
+   return 0; /* spurious wake-up */
+}
+
+static int futex_wake(u32 *uaddr, int nr_wake)
+{
+   ulong key;
+   u32 val;
+   int rc;
+
+   if ((rc = futex_prefault(uaddr, &val)))
+      return rc;
+
+   disable_preemption();
+   {
+      if (!(rc = futex_get_key(uaddr, &key)))
+         rc = futex_wake_int(key, nr_wake, 0, 0);
+   }
+   enable_preemption();
+   return rc;
+}
+
+static int
+futex_requeue(u32 *uaddr, int nr_wake, u32 *uaddr2, int nr_requeue,
+              bool cmp, u32 val3)
+{
+   ulong key, key2;
+   u32 val, val2;
+   int rc;
+
+   if (nr_wake < 0 || nr_requeue < 0)
+      return -EINVAL;
+
+   if ((rc = futex_prefault(uaddr, &val)))
+      return rc;
+
+   if ((rc = futex_prefault(uaddr2, &val2)))
+      return rc;
+
+   disable_preemption();
+   {
+      if ((rc = futex_get_key(uaddr, &key)))
+         goto out;
+
+      if ((rc = futex_get_key(uaddr2, &key2)))
+         goto out;
+
+      if (cmp) {
+
+         if (virtual_read(get_curr_pdir(), uaddr, &val, sizeof(u32)) < 0) {
+            rc = -EFAULT;
+            goto out;
+         }
+
+         if (val != val3) {
+            rc = -EAGAIN;
+            goto out;
+         }
+      }
+
+      /* Requeueing on the same futex is a no-op: just wake */
+      if (key == key2)
+         nr_requeue = 0;
+
+      rc = futex_wake_int(key, nr_wake, key2, nr_requeue);
+   out:;
+   }
+   enable_preemption();
+   return rc;
+}
+
+static int
+do_futex(u32 *uaddr, int op, u32 val, const struct k_timespec64 *timeout,
+         ulong val2, u32 *uaddr2, u32 val3)
+{
+   /*
+    * Without threads, FUTEX_PRIVATE_FLAG makes no difference. The key is
+    * always the physical address, which works for private futexes too.
+    */
+   switch (op & FUTEX_CMD_MASK) {
+
+      case FUTEX_WAIT:
+
+         if (op & FUTEX_CLOCK_REALTIME)
+            return -ENOSYS; /* Like Linux: only for FUTEX_WAIT_BITSET */
+
+         return futex_wait(uaddr, val, timeout);
+
+      case FUTEX_WAKE:
+         return futex_wake(uaddr, (int)MIN(val, (u32)INT32_MAX));
+
+      case FUTEX_REQUEUE:
+         return futex_requeue(uaddr, (int)val, uaddr2, (int)val2, false, 0);
+
+      case FUTEX_CMP_REQUEUE:
+         return futex_requeue(uaddr, (int)val, uaddr2, (int)val2, true, val3);
+
+      default:
+         return -ENOSYS;
+   }
+}
+
+static inline bool futex_op_has_timeout(int op)
+{
+   return (op & FUTEX_CMD_MASK) == FUTEX_WAIT;
+}
+
+int sys_futex(u32 *uaddr, int op, u32 val,
+              const struct k_timespec64 *user_timeout,
+              u32 *uaddr2, u32 val3)
+{
+   struct k_timespec64 ts;
+
+   if (!futex_op_has_timeout(op) || !user_timeout)
+      return do_futex(uaddr, op, val, NULL,
+                      (ulong)user_timeout, uaddr2, val3);
+
+   if (copy_from_user(&ts, user_timeout, sizeof(ts)))
+      return -EFAULT;
+
+   return do_futex(uaddr, op, val, &ts, 0, uaddr2, val3);
+}
+
+int sys_futex_time32(u32 *uaddr, int op, u32 val,
+                     const struct k_timespec32 *user_timeout,
+                     u32 *uaddr2, u32 val3)
+{
+   struct k_timespec32 ts32;
+   struct k_timespec64 ts;
+
+   if (!futex_op_has_timeout(op) || !user_timeout)
+      return do_futex(uaddr, op, val, NULL,
+                      (ulong)user_timeout, uaddr2, val3);
+
+   if (copy_from_user(&ts32, user_timeout, sizeof(ts32)))
+      return -EFAULT;
+
+   ts = (struct k_timespec64) {
+      .tv_sec = ts32.tv_sec,
+      .tv_nsec = ts32.tv_nsec,
+   };
+
+   return do_futex(uaddr, op, val, &ts, 0, uaddr2, val3);
+}
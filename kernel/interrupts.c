@@ -24,6 +24,13 @@ void arch_irq_handling(regs_t *r);
  */
 ATOMIC(int) __in_irq_count;
 
+/*
+ * The registers saved on entry of the innermost IRQ being handled, or NULL.
+ * Used by the IRQ handlers that need to know the interrupted context (e.g. the
+ * sampling profiler, called by the timer IRQ handler).
+ */
+regs_t *__irq_regs;
+
 static ALWAYS_INLINE void inc_irq_count(void)
 {
    atomic_fetch_add_explicit(&__in_irq_count, 1, mo_relaxed);
@@ -202,6 +209,8 @@ static void irq_resched(regs_t *r)
 
 void irq_entry(regs_t *r)
 {
+   regs_t *const prev_irq_regs = __irq_regs;
+
    DEBUG_VALIDATE_STACK_PTR();
    ASSERT(get_curr_task() != NULL);
    DEBUG_check_not_same_interrupt_nested(regs_intnum(r));
@@ -216,7 +225,9 @@ void irq_entry(regs_t *r)
    inc_irq_count();
 
    /* Call the arch-dependent IRQ handling logic */
+   __irq_regs = r;
    arch_irq_handling(r);
+   __irq_regs = prev_irq_regs;
 
    /* Decrease the always-enabled in_irq_count counter */
    dec_irq_count();
@@ -98,21 +98,51 @@ kcond_signal_single(struct kcond *c, struct wait_obj *wo)
 void kcond_signal_int(struct kcond *c, bool all)
 {
    struct wait_obj *wo_pos, *temp;
+   bool signaled = false;
+
    disable_preemption();
    {
       DEBUG_ONLY(check_not_in_irq_handler());
 
       list_for_each(wo_pos, temp, &c->wait_list, wait_list_node) {
 
-         kcond_signal_single(c, wo_pos);
+         if (wo_pos->type == WOBJ_KCOND_WATCHER) {
+
+            struct kcond_watcher *w =
+               CONTAINER_OF(wo_pos, struct kcond_watcher, wobj);
 
-         if (!all) /* the non-broadcast signal() just signals the first task */
-            break;
+            /* Watchers are always notified, see kcond_add_watcher() */
+            w->cb(w);
+            continue;
+         }
+
+         /* the non-broadcast signal() just signals the first task */
+         if (signaled && !all)
+            continue;
+
+         kcond_signal_single(c, wo_pos);
+         signaled = true;
       }
    }
    enable_preemption();
 }
 
+void kcond_add_watcher(struct kcond *c,
+                       struct kcond_watcher *w,
+                       kcond_watcher_cb cb,
+                       void *arg)
+{
+   w->cb = cb;
+   w->arg = arg;
+   wait_obj_set(&w->wobj, WOBJ_KCOND_WATCHER, c, NO_EXTRA, &c->wait_list);
+}
+
+void kcond_remove_watcher(struct kcond_watcher *w)
+{
+   ASSERT(w->wobj.type == WOBJ_KCOND_WATCHER);
+   wait_obj_reset(&w->wobj);
+}
+
 void kcond_destory(struct kcond *c)
 {
    bzero(c, sizeof(struct kcond));
@@ -30,11 +30,15 @@ main_heaps_kmalloc(size_t *size, u32 flags)
       /*
        * The heap is too small (unlikely but possible) or the heap has not been
        * created yet, therefore has size = 0 or just there is not enough free
-       * space in it.
+       * space in it. Also, skip the heap if we know that it does not have a
+       * free block big enough for this allocation.
        */
       if (heap_size < *size || heap_free < *size)
          continue;
 
+      if (heaps[i]->max_free_hint < *size)
+         continue;
+
       if ((vaddr = per_heap_kmalloc(heaps[i], size, flags))) {
 
          if (KMALLOC_SUPPORT_LEAK_DETECTOR && leak_detector_enabled) {
@@ -51,22 +55,13 @@ main_heaps_kmalloc(size_t *size, u32 flags)
 static int
 main_heaps_kfree(void *ptr, size_t *size, u32 flags)
 {
-   struct kmalloc_heap *h = NULL;
+   struct kmalloc_heap *h;
    const ulong vaddr = (ulong) ptr;
    ASSERT(kmalloc_initialized);
 
-   for (int i = used_heaps - 1; i >= 0; i--) {
-
-      const ulong hva = heaps[i]->vaddr;
-      const ulong hend = heaps[i]->heap_last_byte-heaps[i]->min_block_size+1;
-
-      if (IN_RANGE_INC(vaddr, hva, hend)) {
-         h = heaps[i];
-         break;
-      }
-   }
+   h = kmalloc_find_heap_by_addr(vaddr);
 
-   if (!h)
+   if (!h || vaddr > h->heap_last_byte - h->min_block_size + 1)
       return -ENOENT;
 
    /*
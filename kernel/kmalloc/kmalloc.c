@@ -429,6 +429,14 @@ internal_kmalloc(struct kmalloc_heap *h,
       SIMULATE_RETURN_NULL();
    }
    NOREC_LOOP_END
+
+   /*
+    * The whole sub-tree has been visited and there's no free block of size
+    * >= `size` in it. If that sub-tree is the whole heap, lower the hint.
+    */
+   if (start_node == 0)
+      h->max_free_hint = MIN(h->max_free_hint, HALF(size));
+
    return NULL;
 }
 
@@ -452,6 +460,9 @@ per_heap_kmalloc_unsafe(struct kmalloc_heap *h, size_t *size, u32 flags)
    const size_t rounded_up_size =
       MAX(roundup_next_power_of_2(*size), h->min_block_size);
 
+   if (rounded_up_size > h->max_free_hint)
+      return NULL;
+
    if (!multi_step_alloc || ((rounded_up_size - *size) < h->min_block_size)) {
 
       *size = rounded_up_size;
@@ -566,6 +577,7 @@ internal_kfree(struct kmalloc_heap *h,
       int biggest_free_node = node;
       // Mark the parent nodes as free, when necessary.
       size_t biggest_free_size = set_free_uplevels(h, &biggest_free_node, size);
+      h->max_free_hint = MAX(h->max_free_hint, biggest_free_size);
 
       DEBUG_free_after_coaleshe;
 
@@ -919,6 +931,7 @@ void vfree2(void *ptr, size_t size)
 /* Natural continuation of this source file. Purpose: make this file shorter. */
 #include "kmalloc_stats.c.h"
 #include "kmalloc_small_heaps.c.h"
+#include "kmalloc_caches.c.h"
 #include "kmalloc_heaps.c.h"
 #include "general_kmalloc.c.h"
 #include "kmalloc_accelerator.c.h"
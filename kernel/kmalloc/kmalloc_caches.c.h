@@ -0,0 +1,262 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#ifndef _KMALLOC_C_
+
+   #error This is NOT a header file and it is not meant to be included
+
+   /*
+    * The only purpose of this file is to keep kmalloc.c shorter.
+    * Yes, this file could be turned into a regular C source file, but at the
+    * price of making several static functions and variables in kmalloc.c to be
+    * just non-static. We don't want that. Code isolation is a GOOD thing.
+    */
+
+#endif
+
+/*
+ * Object caches (slab allocator)
+ * ---------------------------------
+ *
+ * Each cache hands out objects of a single size, carved out of "slabs": blocks
+ * of `slab_size` bytes (a power of 2) allocated with general_kmalloc() and
+ * naturally aligned at their size. That allows us to get the slab of any object
+ * with a simple mask, while each slab keeps its own list of free objects. Both
+ * kmem_cache_alloc() and kmem_cache_free() are O(1), as long as there's no need
+ * to allocate or to release a whole slab.
+ *
+ * The slabs with at least one free object are kept in the `partial_slabs` list
+ * of the cache, while full slabs are not in any list. Allocations always use
+ * the first slab of the list. The list is NOT sorted: new slabs and slabs that
+ * were full until a free are added at the head (the latter have a single free
+ * object, so they'll likely get full again soon), while the only empty slab
+ * kept is moved to the tail, to be used last. Empty slabs are released
+ * immediately, except for one per cache, in order to avoid allocating and
+ * freeing a slab over and over again when a single object is allocated and
+ * freed in a loop.
+ */
+
+#define KMEM_CACHE_ALIGN                8
+#define KMEM_CACHE_MIN_OBJS_PER_SLAB    8
+
+struct kmem_slab {
+
+   struct list_node node;        /* node in cache's partial_slabs list */
+   void *free_list;              /* singly-linked list of free objects */
+   u32 used;                     /* number of allocated objects */
+};
+
+#define KMEM_SLAB_HDR_SIZE \
+   pow2_round_up_at(sizeof(struct kmem_slab), KMEM_CACHE_ALIGN)
+
+static struct list kmem_caches_list = STATIC_LIST_INIT(kmem_caches_list);
+
+static void kmem_cache_setup_geometry(struct kmem_cache *c)
+{
+   u32 min_slab_size;
+
+   c->obj_size = MAX(c->obj_size, (u32)sizeof(void *));
+   c->obj_size = (u32)pow2_round_up_at(c->obj_size, KMEM_CACHE_ALIGN);
+
+   min_slab_size =
+      KMEM_SLAB_HDR_SIZE + c->obj_size * KMEM_CACHE_MIN_OBJS_PER_SLAB;
+
+   c->slab_size = MAX((u32)PAGE_SIZE, roundup_next_power_of_2(min_slab_size));
+   c->objs_per_slab = (c->slab_size - KMEM_SLAB_HDR_SIZE) / c->obj_size;
+
+   VERIFY(c->slab_size <= KMALLOC_MAX_ALIGN);
+}
+
+static inline struct kmem_slab *
+kmem_cache_obj_to_slab(struct kmem_cache *c, void *obj)
+{
+   return (void *)((ulong)obj & ~((ulong)c->slab_size - 1));
+}
+
+static struct kmem_slab *kmem_cache_grow(struct kmem_cache *c)
+{
+   struct kmem_slab *s;
+   size_t actual_size;
+   char *obj;
+
+   if (!c->slab_size)
+      kmem_cache_setup_geometry(c);
+
+   if (list_node_is_empty(&c->node))
+      list_add_tail(&kmem_caches_list, &c->node);
+
+   actual_size = c->slab_size;
+
+   if (!(s = general_kmalloc(&actual_size, 0)))
+      return NULL;
+
+   ASSERT(actual_size == c->slab_size);
+   ASSERT(((ulong)s & (c->slab_size - 1)) == 0);
+
+   s->free_list = NULL;
+   s->used = 0;
+   obj = (char *)s + KMEM_SLAB_HDR_SIZE + c->obj_size * c->objs_per_slab;
+
+   /* Build the free list backwards, so that it starts at the lowest address */
+   for (u32 i = 0; i < c->objs_per_slab; i++) {
+      obj -= c->obj_size;
+      *(void **)obj = s->free_list;
+      s->free_list = obj;
+   }
+
+   list_add_head(&c->partial_slabs, &s->node);
+   c->slabs_count++;
+   c->empty_slabs++;
+   return s;
+}
+
+static void kmem_cache_release_slab(struct kmem_cache *c, struct kmem_slab *s)
+{
+   size_t actual_size = c->slab_size;
+
+   ASSERT(s->used == 0);
+   list_remove(&s->node);
+   c->slabs_count--;
+   c->empty_slabs--;
+
+   general_kfree(s, &actual_size, 0);
+   ASSERT(actual_size == c->slab_size);
+}
+
+void kmem_cache_create(struct kmem_cache *c, const char *name, u32 obj_size)
+{
+   ASSERT(obj_size > 0);
+
+   *c = (struct kmem_cache) {
+      .name = name,
+      .obj_size = obj_size,
+   };
+
+   list_init(&c->partial_slabs);
+   list_node_init(&c->node);
+   kmem_cache_setup_geometry(c);
+}
+
+void kmem_cache_destroy(struct kmem_cache *c)
+{
+   struct kmem_slab *s, *tmp;
+
+   disable_preemption();
+   {
+      VERIFY(c->allocated_objs == 0);
+
+      list_for_each(s, tmp, &c->partial_slabs, node)
+         kmem_cache_release_slab(c, s);
+
+      ASSERT(c->slabs_count == 0);
+
+      if (list_is_node_in_list(&c->node))
+         list_remove(&c->node);
+   }
+   enable_preemption();
+}
+
+void *kmem_cache_alloc(struct kmem_cache *c)
+{
+   struct kmem_slab *s;
+   void *obj = NULL;
+
+   ASSERT(kmalloc_initialized);
+
+   disable_preemption();
+   {
+      if (UNLIKELY(list_is_empty(&c->partial_slabs)))
+         if (!kmem_cache_grow(c))
+            goto out;
+
+      s = list_first_obj(&c->partial_slabs, struct kmem_slab, node);
+
+      if (!s->used)
+         c->empty_slabs--;
+
+      obj = s->free_list;
+      s->free_list = *(void **)obj;
+      s->used++;
+      c->allocated_objs++;
+
+      if (!s->free_list)
+         list_remove(&s->node);    /* The slab is full now */
+   }
+
+out:
+   enable_preemption();
+   return obj;
+}
+
+void *kmem_cache_zalloc(struct kmem_cache *c)
+{
+   void *obj = kmem_cache_alloc(c);
+
+   if (obj)
+      bzero(obj, c->obj_size);
+
+   return obj;
+}
+
+void kmem_cache_free(struct kmem_cache *c, void *obj)
+{
+   struct kmem_slab *s;
+
+   if (!obj)
+      return;
+
+   s = kmem_cache_obj_to_slab(c, obj);
+
+   if (KMALLOC_FREE_MEM_POISONING)
+      memset32(obj, FREE_MEM_POISON_VAL, c->obj_size / 4);
+
+   disable_preemption();
+   {
+      ASSERT(s->used > 0);
+      ASSERT(c->allocated_objs > 0);
+
+      if (!s->free_list) {
+
+         /* The slab was full: make it available again */
+         list_add_head(&c->partial_slabs, &s->node);
+      }
+
+      *(void **)obj = s->free_list;
+      s->free_list = obj;
+      s->used--;
+      c->allocated_objs--;
+
+      if (!s->used) {
+
+         c->empty_slabs++;
+
+         if (c->empty_slabs > 1) {
+            kmem_cache_release_slab(c, s);
+         } else {
+            /* Keep the empty slab, but use the other ones first */
+            list_remove(&s->node);
+            list_add_tail(&c->partial_slabs, &s->node);
+         }
+      }
+   }
+   enable_preemption();
+}
+
+/*
+ * Called by early_init_kmalloc(): forget about all the slabs, as they belonged
+ * to the heaps that have just been (re-)initialized. Useful only in the unit
+ * tests, where kmalloc is initialized many times.
+ */
+static void kmem_caches_reset(void)
+{
+   struct kmem_cache *c, *tmp;
+
+   list_for_each(c, tmp, &kmem_caches_list, node) {
+      list_init(&c->partial_slabs);
+      list_node_init(&c->node);
+      c->slabs_count = 0;
+      c->empty_slabs = 0;
+      c->allocated_objs = 0;
+   }
+
+   list_init(&kmem_caches_list);
+}
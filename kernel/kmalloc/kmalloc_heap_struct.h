@@ -30,6 +30,13 @@ struct kmalloc_heap {
    ulong heap_last_byte; /* addr + size - 1 */
    /* -- */
 
+   /*
+    * Upper bound for the size of the biggest free block in the heap: it's
+    * lowered when an allocation fails and raised by kfree(). Allows skipping
+    * heaps that certainly cannot satisfy a given allocation.
+    */
+   size_t max_free_hint;
+
    bool linear_mapping;
 
    /*
@@ -19,6 +19,9 @@
 STATIC struct kmalloc_heap first_heap_struct;
 STATIC struct kmalloc_heap *heaps[KMALLOC_HEAPS_COUNT];
 STATIC int used_heaps;
+
+/* Same as heaps[], but sorted by vaddr: used to find a heap by address */
+static struct kmalloc_heap *heaps_by_addr[KMALLOC_HEAPS_COUNT];
 STATIC size_t max_tot_heap_mem_free;
 
 #ifndef UNIT_TEST_ENVIRONMENT
@@ -103,6 +106,7 @@ kmalloc_create_heap(struct kmalloc_heap *h,
 
    bzero(h->metadata_nodes, h->metadata_size);
    h->linear_mapping = linear_mapping;
+   h->max_free_hint = size;
    return true;
 }
 
@@ -179,6 +183,9 @@ kmalloc_heap_dup_expanded(struct kmalloc_heap *h, size_t new_size)
    kmalloc_heap_set_pre_calculated_values(new_heap);
    bzero(new_heap->metadata_nodes, new_heap->metadata_size);
 
+   /* The new right half of the heap is free */
+   new_heap->max_free_hint = HALF(new_size);
+
    struct block_node *new_nodes = new_heap->metadata_nodes;
    struct block_node *old_nodes = h->metadata_nodes;
    size_t nodes_per_row = 1;
@@ -209,6 +216,50 @@ kmalloc_heap_dup(struct kmalloc_heap *h)
    return kmalloc_heap_dup_expanded(h, h->size);
 }
 
+static long heap_vaddr_cmp(const void *a, const void *b)
+{
+   const struct kmalloc_heap *const *ha_ref = a;
+   const struct kmalloc_heap *const *hb_ref = b;
+
+   const struct kmalloc_heap *ha = *ha_ref;
+   const struct kmalloc_heap *hb = *hb_ref;
+
+   if (ha->vaddr < hb->vaddr)
+      return -1;
+
+   if (ha->vaddr == hb->vaddr)
+      return 0;
+
+   return 1;
+}
+
+static void kmalloc_build_heaps_index(void)
+{
+   memcpy(heaps_by_addr, heaps, sizeof(heaps));
+   insertion_sort_ptr(heaps_by_addr, (u32)used_heaps, heap_vaddr_cmp);
+}
+
+/* Binary search in heaps_by_addr[]: O(log(used_heaps)) */
+static struct kmalloc_heap *kmalloc_find_heap_by_addr(ulong vaddr)
+{
+   int lo = 0, hi = used_heaps - 1;
+
+   while (lo <= hi) {
+
+      const int mid = lo + HALF(hi - lo);
+      struct kmalloc_heap *h = heaps_by_addr[mid];
+
+      if (vaddr < h->vaddr)
+         hi = mid - 1;
+      else if (vaddr > h->heap_last_byte)
+         lo = mid + 1;
+      else
+         return h;
+   }
+
+   return NULL;
+}
+
 static size_t find_biggest_heap_size(ulong vaddr, ulong limit)
 {
    ulong curr_max = 512 * MB;
@@ -283,7 +334,10 @@ static int kmalloc_internal_add_heap(void *vaddr, size_t heap_size)
     */
 
    VERIFY(md_allocated == vaddr);
-   return used_heaps++;
+   used_heaps++;
+
+   kmalloc_build_heaps_index();
+   return used_heaps - 1;
 }
 
 static long greater_than_heap_cmp(const void *a, const void *b)
@@ -341,6 +395,7 @@ void early_init_kmalloc(void)
    ASSERT(!kmalloc_initialized);
    list_init(&small_heaps_list);
    list_init(&avail_small_heaps_list);
+   kmem_caches_reset();
 
    used_heaps = 0;
    bzero(heaps, sizeof(heaps));
@@ -0,0 +1,326 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/latency.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/syscalls.h>
+#include <tilck/kernel/elf_utils.h>
+#include <tilck/kernel/debug_utils.h>
+#include <tilck/kernel/fs/devfs.h>
+#include <tilck/kernel/fs/vfs.h>
+
+#define LAT_LINE_BUF_SZ                          512
+
+/*
+ * Records (lines) produced by /dev/latency, in order. Empty histograms produce
+ * no output. The handle's position counts the records, not the bytes.
+ */
+#define LAT_REC_HEADER                             0
+#define LAT_REC_HEADER_LINES                       4
+#define LAT_REC_IRQS             (LAT_REC_HEADER + LAT_REC_HEADER_LINES)
+#define LAT_REC_PAGE_FAULTS        (LAT_REC_IRQS + LAT_HIST_IRQS)
+#define LAT_REC_WAKEUP              (LAT_REC_PAGE_FAULTS + 1)
+#define LAT_REC_SYSCALLS                (LAT_REC_WAKEUP + 1)
+#define LAT_REC_COUNT            (LAT_REC_SYSCALLS + MAX_SYSCALLS)
+
+struct lat_hist lat_irq_hists[LAT_HIST_IRQS];
+struct lat_hist lat_page_fault_hist;
+struct lat_hist lat_wakeup_hist;
+
+/* Allocated on the first call of each syscall */
+static struct lat_hist *syscall_hists[MAX_SYSCALLS];
+
+static struct kmutex lat_mutex;
+static char line_buf[LAT_LINE_BUF_SZ];
+
+static ALWAYS_INLINE u32 lat_bucket(u64 cycles)
+{
+   const u32 hi = (u32)(cycles >> 32);
+   u32 log2;
+
+   if (cycles < (1u << LAT_HIST_MIN_SHIFT))
+      return 0;
+
+   if (hi)
+      log2 = 63 - (u32)__builtin_clz(hi);
+   else
+      log2 = 31 - (u32)__builtin_clz((u32)cycles);
+
+   return MIN(log2 - LAT_HIST_MIN_SHIFT + 1, (u32)LAT_HIST_BUCKETS - 1);
+}
+
+void lat_hist_add(struct lat_hist *h, u64 cycles)
+{
+   const u32 b = lat_bucket(cycles);
+   ulong var;
+
+   disable_interrupts(&var);
+   {
+      h->count++;
+      h->buckets[b]++;
+      h->sum += cycles;
+   }
+   enable_interrupts(&var);
+}
+
+void lat_syscall_add(u32 sn, u64 cycles)
+{
+   struct lat_hist *h = syscall_hists[sn];
+
+   if (UNLIKELY(!h)) {
+
+      if (!(h = kzalloc_obj(struct lat_hist)))
+         return; /* Out of memory: just skip the measurement */
+
+      disable_preemption();
+      {
+         if (!syscall_hists[sn]) {
+            syscall_hists[sn] = h;
+         } else {
+            kfree_obj(h, struct lat_hist);
+            h = syscall_hists[sn];
+         }
+      }
+      enable_preemption();
+   }
+
+   lat_hist_add(h, cycles);
+}
+
+bool lat_hist_get(const struct lat_hist *h, struct lat_hist *out)
+{
+   ulong var;
+
+   if (!h)
+      return false;
+
+   disable_interrupts(&var);
+   {
+      *out = *h;
+   }
+   enable_interrupts(&var);
+   return out->count > 0;
+}
+
+const struct lat_hist *lat_get_syscall_hist(u32 sn)
+{
+   return sn < MAX_SYSCALLS ? syscall_hists[sn] : NULL;
+}
+
+u64 lat_hist_percentile(const struct lat_hist *h, u32 pct)
+{
+   const u64 target = ((u64)h->count * pct + 99) / 100;
+   u64 sum = 0;
+   u32 i;
+
+   for (i = 0; i < LAT_HIST_BUCKETS - 1; i++) {
+
+      sum += h->buckets[i];
+
+      if (sum >= target)
+         break;
+   }
+
+   return i < LAT_HIST_BUCKETS - 1
+      ? 1ull << (i + LAT_HIST_MIN_SHIFT)
+      : 1ull << (i + LAT_HIST_MIN_SHIFT - 1);
+}
+
+void lat_reset_all(void)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      bzero(lat_irq_hists, sizeof(lat_irq_hists));
+      bzero(&lat_page_fault_hist, sizeof(lat_page_fault_hist));
+      bzero(&lat_wakeup_hist, sizeof(lat_wakeup_hist));
+
+      for (u32 i = 0; i < MAX_SYSCALLS; i++) {
+         if (syscall_hists[i])
+            bzero(syscall_hists[i], sizeof(struct lat_hist));
+      }
+   }
+   enable_interrupts(&var);
+}
+
+void lat_get_syscall_name(u32 sn, char *buf, size_t size)
+{
+   const char *sym = NULL;
+   long off = 0;
+   u32 sym_size;
+   void *func;
+
+   if ((func = get_syscall_func_ptr(sn)))
+      sym = find_sym_at_addr((ulong)func, &off, &sym_size);
+
+   if (sym && !off && !strncmp(sym, "sys_", 4))
+      snprintk(buf, size, "%s/%u", sym + 4, sn);
+   else
+      snprintk(buf, size, "%u", sn);
+}
+
+static size_t
+lat_header_line(u32 n, char *buf, size_t size)
+{
+   switch (n) {
+
+      case 0:
+         return (size_t)snprintk(buf, size,
+                                 "# Tilck latency histograms (TSC cycles)\n");
+
+      case 1:
+         return (size_t)snprintk(buf, size,
+                                 "# bucket 0: < 2^%u, bucket i: < 2^(i+%u), "
+                                 "last: >= 2^%u\n",
+                                 LAT_HIST_MIN_SHIFT,
+                                 LAT_HIST_MIN_SHIFT,
+                                 LAT_HIST_BUCKETS + LAT_HIST_MIN_SHIFT - 2);
+
+      case 2:
+
+         if (!tsc_clock_enabled())
+            return (size_t)snprintk(buf, size, "# cycles_per_us: unknown\n");
+
+         return (size_t)snprintk(buf, size,
+                                 "# cycles_per_us: %llu\n",
+                                 1000000000ull / tsc_cycles_to_ns(MILLION));
+
+      case 3:
+         return (size_t)snprintk(buf, size,
+                                 "# type name count sum_cycles buckets...\n");
+   }
+
+   NOT_REACHED();
+}
+
+static size_t
+lat_hist_line(const char *type,
+              const char *name,
+              const struct lat_hist *h,
+              char *buf,
+              size_t size)
+{
+   struct lat_hist hc;
+   size_t len;
+
+   if (!lat_hist_get(h, &hc))
+      return 0;
+
+   len = (size_t)snprintk(buf, size, "%s %s %u %llu",
+                          type, name, hc.count, hc.sum);
+
+   for (u32 i = 0; i < LAT_HIST_BUCKETS; i++)
+      len += (size_t)snprintk(buf + len, size - len, " %u", hc.buckets[i]);
+
+   len += (size_t)snprintk(buf + len, size - len, "\n");
+   return len;
+}
+
+static size_t
+lat_record_line(u32 n, char *buf, size_t size)
+{
+   char name[32];
+
+   if (n < LAT_REC_IRQS)
+      return lat_header_line(n - LAT_REC_HEADER, buf, size);
+
+   if (n < LAT_REC_PAGE_FAULTS) {
+      snprintk(name, sizeof(name), "%u", n - LAT_REC_IRQS);
+      return lat_hist_line("irq", name, &lat_irq_hists[n - LAT_REC_IRQS],
+                           buf, size);
+   }
+
+   if (n == LAT_REC_PAGE_FAULTS)
+      return lat_hist_line("page_fault", "-", &lat_page_fault_hist, buf, size);
+
+   if (n == LAT_REC_WAKEUP)
+      return lat_hist_line("wakeup", "-", &lat_wakeup_hist, buf, size);
+
+   n -= LAT_REC_SYSCALLS;
+
+   if (!syscall_hists[n])
+      return 0;
+
+   lat_get_syscall_name(n, name, sizeof(name));
+   return lat_hist_line("syscall", name, syscall_hists[n], buf, size);
+}
+
+static ssize_t
+latency_dev_read(fs_handle h, char *buf, size_t size)
+{
+   struct devfs_handle *dh = h;
+   size_t tot = 0, len;
+   ssize_t rc = 0;
+
+   kmutex_lock(&lat_mutex);
+
+   while (dh->pos < LAT_REC_COUNT) {
+
+      len = lat_record_line((u32)dh->pos, line_buf, sizeof(line_buf));
+
+      if (tot + len > size) {
+
+         if (!tot)
+            rc = -EINVAL; /* The buffer cannot contain even a single line */
+
+         break;
+      }
+
+      if (len && copy_to_any_buf(buf + tot, line_buf, len)) {
+
+         if (!tot)
+            rc = -EFAULT;
+
+         break;
+      }
+
+      tot += len;
+      dh->pos++;
+   }
+
+   kmutex_unlock(&lat_mutex);
+   return rc ? rc : (ssize_t)tot;
+}
+
+static int
+create_latency_device(int minor,
+                      const struct file_ops **fops_ref,
+                      enum vfs_entry_type *t,
+                      int *spec_flags_ref)
+{
+   static const struct file_ops static_ops_latency = {
+      .read = latency_dev_read,
+   };
+
+   *t = VFS_CHAR_DEV;
+   *fops_ref = &static_ops_latency;
+   *spec_flags_ref = VFS_SPFL_NO_USER_COPY;
+   return 0;
+}
+
+void init_latency(void)
+{
+   struct driver_info *di;
+   int major, rc;
+
+   kmutex_init(&lat_mutex, 0);
+
+   if (!(di = kzalloc_obj(struct driver_info)))
+      panic("Unable to allocate driver_info in init_latency()");
+
+   di->name = "latency";
+   di->create_dev_file = create_latency_device;
+   major = register_driver(di, -1);
+
+   if ((rc = create_dev_file("latency", (u16)major, 0 /* minor */, NULL)))
+      panic("Unable to create /dev/latency (error: %d)", rc);
+}
@@ -31,6 +31,7 @@
 #include <tilck/kernel/term.h>
 #include <tilck/kernel/process.h>
 #include <tilck/kernel/fs/kernelfs.h>
+#include <tilck/kernel/latency.h>
 #include <tilck/kernel/fs/vfs.h>
 
 #include <tilck/mods/console.h>
@@ -328,8 +329,10 @@ run_init_or_selftest(void)
 
 static void do_async_init()
 {
+   init_vfs();
    mount_initrd();
    init_devfs();
+   init_latency();
    init_modules();
    init_extra_debug_features();
 
@@ -4,6 +4,11 @@
 #include <tilck/kernel/process.h>
 #include <tilck/kernel/paging_hw.h>
 
+static struct kmem_cache user_mapping_cache =
+   STATIC_KMEM_CACHE_INIT(user_mapping_cache,
+                          "user_mapping",
+                          sizeof(struct user_mapping));
+
 struct user_mapping *
 process_add_user_mapping(fs_handle h,
                          void *vaddr,
@@ -19,7 +24,7 @@ process_add_user_mapping(fs_handle h,
    ASSERT(!process_get_user_mapping(vaddr));
    ASSERT(pi->mi);
 
-   if (!(um = kzalloc_obj(struct user_mapping)))
+   if (!(um = kmem_cache_zalloc(&user_mapping_cache)))
       return NULL;
 
    list_node_init(&um->pi_node);
@@ -42,7 +47,7 @@ void process_remove_user_mapping(struct user_mapping *um)
 
    list_remove(&um->pi_node);
    list_remove(&um->inode_node);
-   kfree_obj(um, struct user_mapping);
+   kmem_cache_free(&user_mapping_cache, um);
 }
 
 struct user_mapping *process_get_user_mapping(void *vaddrp)
@@ -156,7 +161,7 @@ duplicate_mappings_info(struct process *new_pi, struct mappings_info *mi)
 
    list_for_each_ro(um, &mi->mappings, pi_node) {
 
-      if (!(um2 = kalloc_obj(struct user_mapping)))
+      if (!(um2 = kmem_cache_alloc(&user_mapping_cache)))
          goto oom_case;
 
       /* First just copy the mapping info */
@@ -193,7 +198,7 @@ oom_case:
 
       list_for_each(um, um2, &new_mi->mappings, pi_node) {
          list_remove(&um->pi_node);
-         kfree_obj(um, struct user_mapping);
+         kmem_cache_free(&user_mapping_cache, um);
       }
 
       kfree_obj(new_mi, struct mappings_info);
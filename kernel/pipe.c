@@ -8,16 +8,38 @@
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/pipe.h>
 #include <tilck/kernel/fs/kernelfs.h>
-#include <tilck/kernel/ringbuf.h>
+#include <tilck/kernel/user.h>
 #include <tilck/kernel/sync.h>
 #include <tilck/kernel/signal.h>
 
+/*
+ * The data in a pipe is stored in a chain of page-sized buffers, kept in the
+ * circular array `slots`. Pages are allocated only when needed and released as
+ * soon as they're fully consumed (keeping just one spare page), so that a pipe
+ * can have a big capacity (see F_SETPIPE_SZ) without wasting memory when it's
+ * mostly empty. Also, a full page can be moved as it is to a file (see
+ * pipe_splice_to()), avoiding any copy.
+ */
+
+struct pipe_slot {
+
+   char *page;
+   u16 off;                   /* offset of the first unread byte */
+   u16 len;                   /* number of unread bytes */
+};
+
 struct pipe {
 
    KOBJ_BASE_FIELDS
 
-   char *buf;
-   struct ringbuf rb;
+   struct pipe_slot *slots;   /* circular array of `max_slots` elements */
+   u32 max_slots;
+   u32 head;                  /* index of the first used slot */
+   u32 used;                  /* number of used slots */
+   size_t bytes;              /* number of unread bytes in the pipe */
+   char *spare_page;
+   bool splice_busy;          /* the first slot is being spliced out */
+
    struct kmutex mutex;
    struct kcond rcond;
    struct kcond wcond;
@@ -27,56 +49,209 @@ struct pipe {
    ATOMIC(int) write_handles;
 };
 
-static ssize_t pipe_read(fs_handle h, char *buf, size_t size)
+static struct kmem_cache pipe_cache =
+   STATIC_KMEM_CACHE_INIT(pipe_cache, "pipe", sizeof(struct pipe));
+
+static inline struct pipe_slot *pipe_slot(struct pipe *p, u32 n)
 {
-   struct kfs_handle *kh = h;
-   struct pipe *p = (void *)kh->kobj;
-   bool was_buffer_full;
-   ssize_t rc = 0;
+   return &p->slots[(p->head + n) % p->max_slots];
+}
 
-   if (!size)
-      return 0;
+static inline bool pipe_is_empty(struct pipe *p)
+{
+   return p->bytes == 0;
+}
 
-   kmutex_lock(&p->mutex);
-   {
-   again:
-      was_buffer_full = ringbuf_is_full(&p->rb);
+static bool pipe_is_full(struct pipe *p)
+{
+   struct pipe_slot *tail;
 
-      if (!(rc = (ssize_t)ringbuf_read_bytes(&p->rb, (u8 *)buf, size))) {
+   if (p->used < p->max_slots)
+      return false;
 
-         if (atomic_load_explicit(&p->write_handles, mo_relaxed) == 0) {
-            /* No more writers, always return 0, no matter what. */
-            goto end;
+   tail = pipe_slot(p, p->used - 1);
+   return tail->off + tail->len == PAGE_SIZE;
+}
+
+static char *pipe_get_page(struct pipe *p)
+{
+   char *page = p->spare_page;
+
+   if (page) {
+      p->spare_page = NULL;
+      return page;
+   }
+
+   return kmalloc(PAGE_SIZE);
+}
+
+static void pipe_put_page(struct pipe *p, char *page)
+{
+   if (!p->spare_page)
+      p->spare_page = page;
+   else
+      kfree2(page, PAGE_SIZE);
+}
+
+/* Remove the first slot, returning its page */
+static char *pipe_pop_slot(struct pipe *p)
+{
+   struct pipe_slot *s = pipe_slot(p, 0);
+   char *page = s->page;
+
+   ASSERT(p->used > 0);
+   p->bytes -= s->len;
+   *s = (struct pipe_slot) { 0 };
+   p->head = (p->head + 1) % p->max_slots;
+   p->used--;
+   return page;
+}
+
+/*
+ * Copy up to `size` bytes from the pipe to `buf` (an user or kernel buffer).
+ * Returns the number of bytes read or -EFAULT if nothing could be copied.
+ */
+static ssize_t pipe_read_bytes(struct pipe *p, char *buf, size_t size)
+{
+   ssize_t tot = 0;
+
+   while (size > 0 && p->used > 0) {
+
+      struct pipe_slot *s = pipe_slot(p, 0);
+      const u16 n = (u16)MIN(size, s->len);
+
+      if (copy_to_any_buf(buf + tot, s->page + s->off, n))
+         return tot ? tot : -EFAULT;
+
+      s->off += n;
+      s->len -= n;
+      p->bytes -= n;
+      tot += n;
+      size -= n;
+
+      if (!s->len)
+         pipe_put_page(p, pipe_pop_slot(p));
+   }
+
+   return tot;
+}
+
+/*
+ * Copy up to `size` bytes from `buf` (an user or kernel buffer) to the pipe.
+ * Returns the number of bytes written, -EFAULT or -ENOMEM if nothing could be
+ * written because of a bad buffer or because we ran out of memory.
+ */
+static ssize_t pipe_write_bytes(struct pipe *p, char *buf, size_t size)
+{
+   ssize_t tot = 0;
+
+   while (size > 0) {
+
+      struct pipe_slot *s = p->used ? pipe_slot(p, p->used - 1) : NULL;
+
+      if (!s || s->off + s->len == PAGE_SIZE) {
+
+         char *page;
+
+         if (p->used == p->max_slots)
+            break; /* The pipe is full */
+
+         if (!(page = pipe_get_page(p)))
+            return tot ? tot : -ENOMEM;
+
+         s = pipe_slot(p, p->used++);
+         *s = (struct pipe_slot) { .page = page };
+      }
+
+      const u16 n = (u16)MIN(size, PAGE_SIZE - s->off - s->len);
+
+      if (copy_from_any_buf(s->page + s->off + s->len, buf + tot, n)) {
+
+         if (!s->len) {
+            /* Don't leave an empty slot at the end */
+            p->used--;
+            pipe_put_page(p, s->page);
+            *s = (struct pipe_slot) { 0 };
          }
 
-         if (kh->fl_flags & O_NONBLOCK) {
-            rc = -EAGAIN;
-            goto end;
+         return tot ? tot : -EFAULT;
+      }
+
+      s->len += n;
+      p->bytes += n;
+      tot += n;
+      size -= n;
+   }
+
+   return tot;
+}
+
+/*
+ * Wait until there's something to read in the pipe. Returns 0 when it's
+ * possible to read, 1 in case of EOF (no writers), or a negative errno.
+ */
+static int pipe_wait_for_data(struct kfs_handle *kh, struct pipe *p)
+{
+   ASSERT(kmutex_is_curr_task_holding_lock(&p->mutex));
+
+   while (pipe_is_empty(p) || p->splice_busy) {
+
+      if (!p->splice_busy) {
+
+         if (atomic_load_explicit(&p->write_handles, mo_relaxed) == 0) {
+            /* No more writers, always return 0, no matter what. */
+            return 1;
          }
 
          /* Wake-up all the writers waiting on the readers cond */
          kcond_signal_all(&p->rcond);
+      }
 
-         /* Wait on the writers cond */
-         kcond_wait(&p->wcond, &p->mutex, KCOND_WAIT_FOREVER);
+      if (kh->fl_flags & O_NONBLOCK)
+         return -EAGAIN;
 
-         if (pending_signals())
-            goto end;
+      /* Wait on the writers cond */
+      kcond_wait(&p->wcond, &p->mutex, KCOND_WAIT_FOREVER);
 
-         goto again;
-      }
+      if (pending_signals())
+         return -EINTR;
+   }
 
-      if (!ringbuf_is_empty(&p->rb)) {
-         /* Notify other readers that's possible to read from the pipe */
-         kcond_signal_all(&p->rcond);
-      }
+   return 0;
+}
 
-      if (was_buffer_full) {
-         /* Notify all writers that now is possible to write to the pipe */
-         kcond_signal_all(&p->wcond);
-      }
+static void pipe_notify_after_read(struct pipe *p, bool was_full)
+{
+   if (!pipe_is_empty(p)) {
+      /* Notify other readers that's possible to read from the pipe */
+      kcond_signal_all(&p->rcond);
+   }
 
-   end:;
+   if (was_full) {
+      /* Notify all writers that now is possible to write to the pipe */
+      kcond_signal_all(&p->wcond);
+   }
+}
+
+static ssize_t pipe_read(fs_handle h, char *buf, size_t size)
+{
+   struct kfs_handle *kh = h;
+   struct pipe *p = (void *)kh->kobj;
+   bool was_buffer_full;
+   ssize_t rc = 0;
+
+   if (!size)
+      return 0;
+
+   kmutex_lock(&p->mutex);
+   {
+      if (!(rc = pipe_wait_for_data(kh, p))) {
+         was_buffer_full = pipe_is_full(p);
+         rc = pipe_read_bytes(p, buf, size);
+         pipe_notify_after_read(p, was_buffer_full);
+      } else if (rc > 0) {
+         rc = 0; /* EOF */
+      }
    }
    kmutex_unlock(&p->mutex);
 
@@ -99,7 +274,7 @@ static ssize_t pipe_write(fs_handle h, char *buf, size_t size)
    kmutex_lock(&p->mutex);
    {
    again:
-      was_buffer_empty = ringbuf_is_empty(&p->rb);
+      was_buffer_empty = pipe_is_empty(p);
 
       if (atomic_load_explicit(&p->read_handles, mo_relaxed) == 0) {
 
@@ -112,7 +287,10 @@ static ssize_t pipe_write(fs_handle h, char *buf, size_t size)
          goto end;
       }
 
-      if (!(rc = (ssize_t)ringbuf_write_bytes(&p->rb, (u8 *)buf, size))) {
+      if ((rc = pipe_write_bytes(p, buf, size)) < 0)
+         goto end;
+
+      if (!rc) {
 
          if (kh->fl_flags & O_NONBLOCK) {
             rc = -EAGAIN;
@@ -131,12 +309,12 @@ static ssize_t pipe_write(fs_handle h, char *buf, size_t size)
          goto again;
       }
 
-      if (!ringbuf_is_full(&p->rb)) {
+      if (!pipe_is_full(p)) {
          /* Notify other writers that now it possible to write on the pipe */
          kcond_signal_all(&p->wcond);
       }
 
-      if (was_buffer_empty) {
+      if (was_buffer_empty && !pipe_is_empty(p)) {
          /* Notify all readers that now is possible to read from the pipe */
          kcond_signal_all(&p->rcond);
       }
@@ -159,7 +337,7 @@ static int pipe_read_ready(fs_handle h)
 
    kmutex_lock(&p->mutex);
    {
-      ret = !ringbuf_is_empty(&p->rb) ||
+      ret = !pipe_is_empty(p) ||
             atomic_load_explicit(&p->write_handles, mo_relaxed) == 0;
    }
    kmutex_unlock(&p->mutex);
@@ -181,7 +359,7 @@ static int pipe_write_ready(fs_handle h)
 
    kmutex_lock(&p->mutex);
    {
-      ret = !ringbuf_is_full(&p->rb) ||
+      ret = !pipe_is_full(p) ||
             atomic_load_explicit(&p->read_handles, mo_relaxed) == 0;
    }
    kmutex_unlock(&p->mutex);
@@ -244,9 +422,15 @@ void destroy_pipe(struct pipe *p)
    kcond_destory(&p->wcond);
    kcond_destory(&p->rcond);
    kmutex_destroy(&p->mutex);
-   ringbuf_destory(&p->rb);
-   kfree2(p->buf, PIPE_BUF_SIZE);
-   kfree_obj(p, struct pipe);
+
+   while (p->used > 0)
+      kfree2(pipe_pop_slot(p), PAGE_SIZE);
+
+   if (p->spare_page)
+      kfree2(p->spare_page, PAGE_SIZE);
+
+   kfree_array_obj(p->slots, struct pipe_slot, p->max_slots);
+   kmem_cache_free(&pipe_cache, p);
 }
 
 static void pipe_on_handle_close(fs_handle h)
@@ -286,18 +470,19 @@ struct pipe *create_pipe(void)
 {
    struct pipe *p;
 
-   if (!(p = (void *)kzalloc_obj(struct pipe)))
+   if (!(p = kmem_cache_zalloc(&pipe_cache)))
       return NULL;
 
-   if (!(p->buf = kmalloc(PIPE_BUF_SIZE))) {
-      kfree_obj(p, struct pipe);
+   p->max_slots = PIPE_DEF_SIZE / PAGE_SIZE;
+
+   if (!(p->slots = kzalloc_array_obj(struct pipe_slot, p->max_slots))) {
+      kmem_cache_free(&pipe_cache, p);
       return NULL;
    }
 
    p->on_handle_close = &pipe_on_handle_close;
    p->on_handle_dup = &pipe_on_handle_dup;
    p->destory_obj = (void *)&destroy_pipe;
-   ringbuf_init(&p->rb, PIPE_BUF_SIZE, 1, p->buf);
    kmutex_init(&p->mutex, 0);
    kcond_init(&p->rcond);
    kcond_init(&p->wcond);
@@ -311,8 +496,10 @@ fs_handle pipe_create_read_handle(struct pipe *p)
 
    res = kfs_create_new_handle(&static_ops_pipe_read_end, (void *)p, O_RDONLY);
 
-   if (res != NULL)
+   if (res != NULL) {
+      ((struct kfs_handle *)res)->spec_flags = VFS_SPFL_NO_USER_COPY;
       atomic_fetch_add_explicit(&p->read_handles, 1, mo_relaxed);
+   }
 
    return res;
 }
@@ -323,8 +510,171 @@ fs_handle pipe_create_write_handle(struct pipe *p)
 
    res = kfs_create_new_handle(&static_ops_pipe_write_end, (void*)p, O_WRONLY);
 
-   if (res != NULL)
+   if (res != NULL) {
+      ((struct kfs_handle *)res)->spec_flags = VFS_SPFL_NO_USER_COPY;
       atomic_fetch_add_explicit(&p->write_handles, 1, mo_relaxed);
+   }
 
    return res;
 }
+
+struct pipe *get_pipe(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+
+   if (kh->fops != &static_ops_pipe_read_end &&
+       kh->fops != &static_ops_pipe_write_end)
+   {
+      return NULL;
+   }
+
+   return (void *)kh->kobj;
+}
+
+bool is_pipe_read_end(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   return kh->fops == &static_ops_pipe_read_end;
+}
+
+int pipe_get_size(struct pipe *p)
+{
+   return (int)(p->max_slots * PAGE_SIZE);
+}
+
+/*
+ * Change the capacity of the pipe, rounding it up to a power-of-two number of
+ * pages, like Linux does. Returns the new capacity or a negative errno.
+ */
+int pipe_set_size(struct pipe *p, ulong size)
+{
+   struct pipe_slot *slots;
+   u32 max_slots = 1;
+
+   if (size > PIPE_MAX_SIZE)
+      return -EPERM;
+
+   while (max_slots * PAGE_SIZE < size)
+      max_slots <<= 1;
+
+   kmutex_lock(&p->mutex);
+   {
+      if (max_slots == p->max_slots)
+         goto end;
+
+      /*
+       * The slots array cannot be replaced while pipe_splice_to() is using the
+       * first slot without holding the mutex.
+       */
+      if (max_slots < p->used || p->splice_busy) {
+         kmutex_unlock(&p->mutex);
+         return -EBUSY;
+      }
+
+      if (!(slots = kzalloc_array_obj(struct pipe_slot, max_slots))) {
+         kmutex_unlock(&p->mutex);
+         return -ENOMEM;
+      }
+
+      for (u32 i = 0; i < p->used; i++)
+         slots[i] = *pipe_slot(p, i);
+
+      kfree_array_obj(p->slots, struct pipe_slot, p->max_slots);
+      p->slots = slots;
+      p->max_slots = max_slots;
+      p->head = 0;
+
+      /* A bigger pipe might have room for the writers now */
+      kcond_signal_all(&p->rcond);
+   end:;
+   }
+   kmutex_unlock(&p->mutex);
+   return (int)(max_slots * PAGE_SIZE);
+}
+
+/*
+ * Move up to `len` bytes from the pipe to `out`. Whole pages are given to `out`
+ * as they are when its file system supports that (see splice_page), otherwise
+ * they're written with vfs_write(). The pipe's mutex is NOT held while writing
+ * to `out`, which might need to acquire other locks or block: the first slot
+ * is just marked as busy, in order to keep other readers away from it.
+ */
+ssize_t pipe_splice_to(fs_handle h, fs_handle out, size_t len)
+{
+   struct kfs_handle *kh = h;
+   struct fs_handle_base *out_hb = out;
+   struct pipe *p = (void *)kh->kobj;
+   struct pipe_slot *s;
+   ssize_t tot = 0;
+   ssize_t rc = 0;
+   bool donated;
+   char *page;
+   size_t n;
+   u16 off;
+
+   ASSERT(is_pipe_read_end(h));
+
+   if (get_pipe(out) == p)
+      return -EINVAL;
+
+   kmutex_lock(&p->mutex);
+
+   if ((rc = pipe_wait_for_data(kh, p))) {
+      kmutex_unlock(&p->mutex);
+      return rc > 0 ? 0 : rc;
+   }
+
+   while (len > 0 && !pipe_is_empty(p)) {
+
+      s = pipe_slot(p, 0);
+      n = MIN(len, s->len);
+      page = s->page;
+      off = s->off;
+      donated = false;
+      p->splice_busy = true;
+
+      /*
+       * From now on, the first slot's data cannot be touched by anybody else:
+       * readers wait for `splice_busy` to be cleared and writers only append
+       * data after `off + n`. The `slots` array itself might still be replaced
+       * by pipe_set_size(), therefore `s` must not be used without the mutex.
+       */
+      kmutex_unlock(&p->mutex);
+      {
+         if (n == PAGE_SIZE && out_hb->fops->splice_page)
+            donated = !out_hb->fops->splice_page(out, page);
+
+         rc = donated ? (ssize_t)n : vfs_write(out, page + off, n);
+      }
+      kmutex_lock(&p->mutex);
+
+      s = pipe_slot(p, 0);
+      p->splice_busy = false;
+
+      if (rc > 0) {
+
+         s->off += (u16)rc;
+         s->len -= (u16)rc;
+         p->bytes -= (size_t)rc;
+
+         if (donated) {
+            pipe_pop_slot(p);   /* The page is now owned by `out` */
+         } else if (!s->len) {
+            pipe_put_page(p, pipe_pop_slot(p));
+         }
+
+         tot += rc;
+         len -= (size_t)rc;
+      }
+
+      /* Wake-up both the readers waiting for `splice_busy` and the writers */
+      kcond_signal_all(&p->wcond);
+      kcond_signal_all(&p->rcond);
+
+      if (rc < (ssize_t)n)
+         break;
+   }
+
+   kmutex_unlock(&p->mutex);
+   return tot > 0 ? tot : rc;
+}
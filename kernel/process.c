@@ -167,7 +167,7 @@ void free_mem_for_zombie_task(struct task *ti)
 void init_task_lists(struct task *ti)
 {
    bintree_node_init(&ti->tree_by_tid_node);
-   list_node_init(&ti->runnable_node);
+   bintree_node_init(&ti->runnable_node);
    list_node_init(&ti->sleeping_node);
    list_node_init(&ti->zombie_node);
    list_node_init(&ti->wakeup_timer_node);
@@ -240,6 +240,7 @@ allocate_new_process(struct task *parent, int pid, pdir_t *new_pdir)
    ti->tid = pid;
    ti->is_main_thread = true;
    ti->timer_ready = false;
+   ti->wakeup_deadline = 0;
 
    /* Reset sched ticks in the new process */
    bzero(&ti->ticks, sizeof(ti->ticks));
@@ -42,6 +42,17 @@ bool safe_ringbuf_is_full(struct safe_ringbuf *rb)
    return cs.full;
 }
 
+u16 safe_ringbuf_get_elems(struct safe_ringbuf *rb)
+{
+   struct generic_safe_ringbuf_stat cs;
+   cs.__raw = atomic_load_explicit(&rb->s.raw, mo_relaxed);
+
+   if (cs.full)
+      return rb->max_elems;
+
+   return (u16)((cs.write_pos + rb->max_elems - cs.read_pos) % rb->max_elems);
+}
+
 static ALWAYS_INLINE void
 begin_debug_write_checks(struct safe_ringbuf *rb)
 {
@@ -10,6 +10,7 @@
 #include <tilck/kernel/worker_thread.h>
 #include <tilck/kernel/timer.h>
 #include <tilck/kernel/errno.h>
+#include <tilck/kernel/latency.h>
 
 /* Shared global variables */
 struct task *__current;
@@ -19,12 +20,13 @@ ATOMIC(bool) __need_resched;              /* see docs/atomics.md */
 struct task *kernel_process;
 struct process *kernel_process_pi;
 
-struct list runnable_tasks_list;
 struct list sleeping_tasks_list;
 struct list zombie_tasks_list;
 
 /* Static variables */
 static struct task *tree_by_tid_root;
+static struct task *runnable_tasks_root;
+static u64 runnable_seq;
 static u64 idle_ticks;
 static int runnable_tasks_count;
 static int current_max_pid = -1;
@@ -363,6 +365,26 @@ int iterate_over_tasks(bintree_visit_cb func, void *arg)
                                  tree_by_tid_node);
 }
 
+static void idle_tickless_halt(void)
+{
+   disable_preemption();
+   disable_interrupts_forced();
+
+   if (need_reschedule() || runnable_tasks_count > 0) {
+      enable_interrupts_forced();
+      enable_preemption_nosched();
+      return;
+   }
+
+   timer_idle_enter();
+   enable_interrupts_and_halt();
+
+   disable_interrupts_forced();
+   timer_idle_exit();
+   enable_interrupts_forced();
+   enable_preemption_nosched();
+}
+
 static void idle(void)
 {
    while (true) {
@@ -370,7 +392,11 @@ static void idle(void)
       ASSERT(is_preemption_enabled());
 
       idle_ticks++;
-      halt();
+
+      if (KRN_TICKLESS_IDLE)
+         idle_tickless_halt();
+      else
+         halt();
 
       if (need_reschedule() || runnable_tasks_count > 0)
          kernel_yield();
@@ -387,7 +413,6 @@ static void create_kernel_process(void)
    struct task *s_kernel_ti = (struct task *)kernel_proc_buf;
    struct process *s_kernel_pi = (struct process *)(s_kernel_ti + 1);
 
-   list_init(&runnable_tasks_list);
    list_init(&sleeping_tasks_list);
    list_init(&zombie_tasks_list);
 
@@ -453,6 +478,66 @@ void set_current_task_in_kernel(void)
    get_curr_task()->running_in_kernel = true;
 }
 
+/*
+ * The runnable tasks are kept in an AVL tree sorted by (runnable_key, seq),
+ * where `runnable_key` is a snapshot of the task's `ticks.total` taken when the
+ * task became runnable. That allows schedule() to pick the task that ran less
+ * in O(log N), instead of walking all the runnable tasks. The snapshot is
+ * necessary because `ticks.total` of a RUNNABLE task might still grow, in the
+ * corner case where the task is woken-up while it's the current task, and the
+ * key of an object must never change while it's in the tree.
+ *
+ * Tasks woken up by their timer (timer_ready) get key 0 in order to be always
+ * selected first, as they would be before any other runnable task. The `seq`
+ * tie-breaker makes tasks with the same key to be picked in FIFO order, like
+ * in a round-robin list.
+ */
+static long runnable_tree_cmp(const void *a, const void *b)
+{
+   const struct task *t1 = a;
+   const struct task *t2 = b;
+
+   if (t1->runnable_key != t2->runnable_key)
+      return t1->runnable_key < t2->runnable_key ? -1 : 1;
+
+   if (t1->runnable_seq != t2->runnable_seq)
+      return t1->runnable_seq < t2->runnable_seq ? -1 : 1;
+
+   return 0;
+}
+
+static void runnable_tree_insert(struct task *ti)
+{
+   DEBUG_ONLY_UNSAFE(bool inserted);
+
+   ti->runnable_key = ti->timer_ready ? 0 : ti->ticks.total + 1;
+   ti->runnable_seq = ++runnable_seq;
+   bintree_node_init(&ti->runnable_node);
+
+   DEBUG_ONLY_UNSAFE(inserted =)
+      bintree_insert(&runnable_tasks_root,
+                     ti,
+                     runnable_tree_cmp,
+                     struct task,
+                     runnable_node);
+
+   ASSERT(inserted);
+}
+
+static void runnable_tree_remove(struct task *ti)
+{
+   DEBUG_ONLY_UNSAFE(void *removed);
+
+   DEBUG_ONLY_UNSAFE(removed =)
+      bintree_remove(&runnable_tasks_root,
+                     ti,
+                     runnable_tree_cmp,
+                     struct task,
+                     runnable_node);
+
+   ASSERT(removed == ti);
+}
+
 static void task_add_to_state_list(struct task *ti)
 {
    if (is_worker_thread(ti))
@@ -461,7 +546,7 @@ static void task_add_to_state_list(struct task *ti)
    switch (atomic_load_explicit(&ti->state, mo_relaxed)) {
 
       case TASK_STATE_RUNNABLE:
-         list_add_tail(&runnable_tasks_list, &ti->runnable_node);
+         runnable_tree_insert(ti);
          runnable_tasks_count++;
          break;
 
@@ -490,7 +575,7 @@ static void task_remove_from_state_list(struct task *ti)
    switch (atomic_load_explicit(&ti->state, mo_relaxed)) {
 
       case TASK_STATE_RUNNABLE:
-         list_remove(&ti->runnable_node);
+         runnable_tree_remove(ti);
          runnable_tasks_count--;
          ASSERT(runnable_tasks_count >= 0);
          break;
@@ -520,6 +605,9 @@ void task_change_state(struct task *ti, enum task_state new_state)
 
    disable_interrupts(&var);
    {
+      if (ti->state == TASK_STATE_SLEEPING && new_state == TASK_STATE_RUNNABLE)
+         ti->ticks.wakeup_cycles = RDTSC();
+
       task_remove_from_state_list(ti);
       ti->state = new_state;
       task_add_to_state_list(ti);
@@ -527,6 +615,24 @@ void task_change_state(struct task *ti, enum task_state new_state)
    enable_interrupts(&var);
 }
 
+/*
+ * Re-position a RUNNABLE task in the runnable tree, after its `timer_ready`
+ * flag changed. Must be called with interrupts disabled.
+ */
+void sched_update_runnable_task(struct task *ti)
+{
+   ASSERT(!are_interrupts_enabled());
+
+   if (is_worker_thread(ti))
+      return;
+
+   if (atomic_load_explicit(&ti->state, mo_relaxed) != TASK_STATE_RUNNABLE)
+      return;
+
+   runnable_tree_remove(ti);
+   runnable_tree_insert(ti);
+}
+
 void add_task(struct task *ti)
 {
    disable_preemption();
@@ -586,11 +692,71 @@ void sched_account_ticks(void)
    }
 }
 
+/* Account the time elapsed between the wakeup of `ti` and its run */
+static void sched_account_wakeup(struct task *ti, u64 now)
+{
+   if (ti->ticks.wakeup_cycles) {
+      lat_hist_add(&lat_wakeup_hist, now - ti->ticks.wakeup_cycles);
+      ti->ticks.wakeup_cycles = 0;
+   }
+}
+
+/*
+ * Called by switch_to_task(): account the CPU time of the tasks in TSC cycles,
+ * used for CLOCK_PROCESS_CPUTIME_ID when the TSC is the clocksource.
+ */
+void sched_account_task_switch(struct task *prev, struct task *next)
+{
+   const u64 now = RDTSC();
+   ASSERT(!is_preemption_enabled());
+
+   if (prev->ticks.cycles_start)
+      prev->ticks.cycles += now - prev->ticks.cycles_start;
+
+   next->ticks.cycles_start = now;
+   sched_account_wakeup(next, now);
+}
+
+static struct task *sched_pick_runnable_task(void)
+{
+   struct bintree_walk_ctx ctx;
+   struct task *pos;
+   ulong var;
+
+   /*
+    * Interrupts must be disabled while walking the tree because the timer IRQ
+    * handler might wake up tasks, changing the tree structure.
+    *
+    * NOTE: typically, the first task in the tree (the one which ran less) is
+    * the one we're looking for. Only the idle task, the current task and the
+    * stopped tasks have to be skipped.
+    */
+   disable_interrupts(&var);
+
+   bintree_in_order_visit_start(&ctx,
+                                runnable_tasks_root,
+                                struct task,
+                                runnable_node,
+                                false);
+
+   while ((pos = bintree_in_order_visit_next(&ctx))) {
+
+      ASSERT(pos->state == TASK_STATE_RUNNABLE);
+
+      if (pos->stopped || pos == idle_task || pos == get_curr_task())
+         continue;
+
+      break;
+   }
+
+   enable_interrupts(&var);
+   return pos;
+}
+
 void schedule(void)
 {
    enum task_state curr_state = get_curr_task_state();
    struct task *selected = NULL;
-   struct task *pos;
 
    ASSERT(!is_preemption_enabled());
 
@@ -639,24 +805,7 @@ void schedule(void)
    if (selected)
       switch_to_task(selected);
 
-   list_for_each_ro(pos, &runnable_tasks_list, runnable_node) {
-
-      ASSERT(pos->state == TASK_STATE_RUNNABLE);
-
-      if (pos->stopped || pos == idle_task)
-         continue;
-
-      if (pos->timer_ready) {
-         selected = pos;
-         break;
-      }
-
-      if (pos == get_curr_task())
-         continue;
-
-      if (!selected || pos->ticks.total < selected->ticks.total)
-         selected = pos;
-   }
+   selected = sched_pick_runnable_task();
 
    if (!selected) {
 
@@ -664,6 +813,7 @@ void schedule(void)
          selected = get_curr_task();
          task_change_state(selected, TASK_STATE_RUNNING);
          selected->ticks.timeslice = 0;
+         sched_account_wakeup(selected, RDTSC());
          return;
       }
 
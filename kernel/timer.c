@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
 #include <tilck_gen_headers/config_debug.h>
+#include <tilck_gen_headers/config_modules.h>
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/printk.h>
@@ -13,6 +14,9 @@
 #include <tilck/kernel/elf_utils.h>
 #include <tilck/kernel/worker_thread.h>
 #include <tilck/kernel/datetime.h>
+#include <tilck/kernel/vdso.h>
+#include <tilck/kernel/interrupts.h>
+#include <tilck/mods/profiler.h>
 
 /* Jiffies */
 static u64 __ticks;        /* ticks since the timer started */
@@ -25,14 +29,25 @@ int __tick_adj_ticks_rem;
 
 /* Debug counters */
 u32 slow_timer_irq_handler_count;
+u32 tickless_idle_count;
 
 /* Temporary global used by asm_do_bogomips_loop() */
 volatile ATOMIC(u32) __bogo_loops;
 
 /* Static variables */
 static struct list timer_wakeup_list = STATIC_LIST_INIT(timer_wakeup_list);
+static struct list ktimer_list = STATIC_LIST_INIT(ktimer_list);
 static u32 loops_per_tick;        /* Tilck bogoMips expressed as loops/tick */
 static u32 loops_per_us = 5000;   /* loops/microsecond (initial value) */
+static u32 oneshot_ticks;         /* ticks covered by the pending one-shot IRQ */
+
+/* TSC clocksource */
+static bool tsc_clock;            /* the TSC is used as monotonic clocksource */
+static u32 tsc_mult;              /* ns = (cycles * tsc_mult) >> tsc_shift */
+static u32 tsc_shift;
+static u32 tsc_khz;
+static u64 tsc_tick_cycles;       /* TSC value at the last tick */
+static u64 tsc_tick_ns;           /* monotonic ns at `tsc_tick_cycles` */
 
 u64 get_ticks(void)
 {
@@ -47,6 +62,122 @@ u64 get_ticks(void)
    return curr_ticks;
 }
 
+/*
+ * TSC clocksource
+ * -----------------
+ *
+ * When the TSC is invariant (constant rate, not stopped in deep C-states), it
+ * gets calibrated against the timer during the bogoMips measurement and then
+ * used for CLOCK_MONOTONIC, for the CPU time of the tasks and for delay_us(),
+ * with nanosecond resolution. The monotonic time is a snapshot taken at every
+ * tick (tsc_tick_ns) plus the TSC cycles elapsed since then, converted to
+ * nanoseconds. The vdso-like page uses exactly the same snapshot and the same
+ * math, so that the two paths always agree.
+ *
+ * Otherwise, everything keeps using the tick-based clock.
+ */
+
+bool tsc_clock_enabled(void)
+{
+   return tsc_clock;
+}
+
+u64 tsc_cycles_to_ns(u64 cycles)
+{
+   /* Split the multiplication in order to avoid 64-bit overflows */
+   const u64 hi = (cycles >> 32) * tsc_mult;
+   const u64 lo = (cycles & 0xffffffff) * tsc_mult;
+
+   return (hi << (32 - tsc_shift)) + (lo >> tsc_shift);
+}
+
+u64 tsc_clock_get_ns(void)
+{
+   u64 cycles, ns;
+   ulong var;
+
+   ASSERT(tsc_clock);
+
+   disable_interrupts(&var);
+   {
+      cycles = RDTSC() - tsc_tick_cycles;
+      ns = tsc_tick_ns;
+   }
+   enable_interrupts(&var);
+   return ns + tsc_cycles_to_ns(cycles);
+}
+
+static void tsc_clock_tick(void)
+{
+   const u64 now = RDTSC();
+   ASSERT(!are_interrupts_enabled());
+
+   tsc_tick_ns += tsc_cycles_to_ns(now - tsc_tick_cycles);
+   tsc_tick_cycles = now;
+}
+
+/*
+ * Called by the bogoMips IRQ handler, with interrupts disabled: `cycles` TSC
+ * cycles have elapsed in `ns` nanoseconds, measured by the timer.
+ */
+static void tsc_clock_setup(u64 now, u64 cycles, u64 ns)
+{
+   u32 shift = 31;      /* NOTE: the vdso code requires shift < 32 */
+   u64 mult;
+
+   ASSERT(!are_interrupts_enabled());
+
+   if (!x86_cpu_features.invariant_TSC || !cycles)
+      return;
+
+   /* Use the biggest shift (precision) keeping `mult` in 32 bits */
+   while ((mult = (ns << shift) / cycles) > UINT32_MAX)
+      shift--;
+
+   tsc_mult = (u32)mult;
+   tsc_shift = shift;
+   tsc_khz = (u32)(cycles * MILLION / ns);
+   tsc_tick_cycles = now;
+   tsc_tick_ns = __time_ns;
+   tsc_clock = true;
+
+   vdso_enable_tsc(tsc_mult, tsc_shift, tsc_tick_cycles, tsc_tick_ns);
+}
+
+/*
+ * The wakeup timers are kept in `timer_wakeup_list`, sorted by their absolute
+ * deadline (in ticks). This way, at each tick, the timer IRQ handler has just
+ * to check the head of the list, instead of decrementing a counter for each
+ * sleeping task: the per-tick cost is O(1), no matter how many tasks are
+ * sleeping. The price for that is an O(N) insertion, but that happens in the
+ * sleep path, not in the IRQ handler. Also, the cancellation of a timer is
+ * just a list_remove(), which is light-fast, as required by IRQ handlers.
+ *
+ * Since the list node lives in struct task, no kmalloc() is needed to sleep.
+ */
+static void timer_list_insert(struct task *ti)
+{
+   struct task *pos;
+   ASSERT(!are_interrupts_enabled());
+
+   /*
+    * Look for the right position starting from the tail, as the new timers
+    * tend to expire after the ones already in the list. Tasks having the same
+    * deadline are woken-up in FIFO order.
+    */
+   pos = list_last_obj(&timer_wakeup_list, struct task, wakeup_timer_node);
+
+   while (&pos->wakeup_timer_node != (struct list_node *)&timer_wakeup_list) {
+
+      if (pos->wakeup_deadline <= ti->wakeup_deadline)
+         break;
+
+      pos = list_prev_obj(pos, wakeup_timer_node);
+   }
+
+   list_add_after(&pos->wakeup_timer_node, &ti->wakeup_timer_node);
+}
+
 void task_set_wakeup_timer(struct task *ti, u32 ticks)
 {
    ulong var;
@@ -54,14 +185,15 @@ void task_set_wakeup_timer(struct task *ti, u32 ticks)
 
    disable_interrupts(&var);
    {
-      if (ti->ticks_before_wake_up == 0) {
+      if (ti->wakeup_deadline == 0) {
          ASSERT(!list_is_node_in_list(&ti->wakeup_timer_node));
-         list_add_tail(&timer_wakeup_list, &ti->wakeup_timer_node);
       } else {
          ASSERT(list_is_node_in_list(&ti->wakeup_timer_node));
+         list_remove(&ti->wakeup_timer_node);
       }
 
-      ti->ticks_before_wake_up = ticks;
+      ti->wakeup_deadline = __ticks + ticks;
+      timer_list_insert(ti);
    }
    enable_interrupts(&var);
 }
@@ -73,9 +205,11 @@ void task_update_wakeup_timer_if_any(struct task *ti, u32 new_ticks)
 
    disable_interrupts(&var);
    {
-      if (ti->ticks_before_wake_up > 0) {
+      if (ti->wakeup_deadline > 0) {
          ASSERT(list_is_node_in_list(&ti->wakeup_timer_node));
-         ti->ticks_before_wake_up = new_ticks;
+         list_remove(&ti->wakeup_timer_node);
+         ti->wakeup_deadline = __ticks + new_ticks;
+         timer_list_insert(ti);
       }
    }
    enable_interrupts(&var);
@@ -84,14 +218,25 @@ void task_update_wakeup_timer_if_any(struct task *ti, u32 new_ticks)
 u32 task_cancel_wakeup_timer(struct task *ti)
 {
    ulong var;
-   u32 old;
+   u32 old = 0;
    disable_interrupts(&var);
    {
-      old = ti->ticks_before_wake_up;
+      if (ti->wakeup_deadline > 0) {
+
+         if (UNLIKELY(ti->timer_ready)) {
+            ti->timer_ready = false;
+            sched_update_runnable_task(ti);
+         }
 
-      if (old > 0) {
-         ti->timer_ready = false;
-         ti->ticks_before_wake_up = 0;
+         /*
+          * NOTE: wakeup_deadline == __ticks is possible when we're called by
+          * an IRQ handler preempting the timer handler right after __ticks has
+          * been incremented, but before tick_all_timers() ran. In that case,
+          * the timer has still (at most) one tick to go.
+          */
+         ASSERT(ti->wakeup_deadline >= __ticks);
+         old = (u32)MAX(ti->wakeup_deadline - __ticks, (u64)1);
+         ti->wakeup_deadline = 0;
          list_remove(&ti->wakeup_timer_node);
       }
    }
@@ -99,51 +244,155 @@ u32 task_cancel_wakeup_timer(struct task *ti)
    return old;
 }
 
+/*
+ * Kernel timers live in `ktimer_list`, sorted by deadline exactly like the
+ * wakeup timers above, for the same reasons.
+ */
+static void ktimer_list_insert(struct ktimer *t)
+{
+   struct ktimer *pos;
+   ASSERT(!are_interrupts_enabled());
+
+   pos = list_last_obj(&ktimer_list, struct ktimer, node);
+
+   while (&pos->node != (struct list_node *)&ktimer_list) {
+
+      if (pos->deadline <= t->deadline)
+         break;
+
+      pos = list_prev_obj(pos, node);
+   }
+
+   list_add_after(&pos->node, &t->node);
+}
+
+void ktimer_init(struct ktimer *t, ktimer_cb cb)
+{
+   list_node_init(&t->node);
+   t->deadline = 0;
+   t->interval = 0;
+   t->cb = cb;
+}
+
+/*
+ * Arm the timer `t` to expire in `ticks` ticks and then, if `interval` is not
+ * zero, every `interval` ticks. Re-arming an already armed timer is allowed.
+ */
+void ktimer_set(struct ktimer *t, u64 ticks, u64 interval)
+{
+   ulong var;
+   ASSERT(ticks > 0);
+
+   disable_interrupts(&var);
+   {
+      if (t->deadline)
+         list_remove(&t->node);
+
+      t->deadline = __ticks + ticks;
+      t->interval = interval;
+      ktimer_list_insert(t);
+   }
+   enable_interrupts(&var);
+}
+
+/* Disarm the timer `t`, returning the ticks it had still to go (or 0) */
+u64 ktimer_cancel(struct ktimer *t)
+{
+   u64 old = 0;
+   ulong var;
+
+   disable_interrupts(&var);
+   {
+      if (t->deadline) {
+         old = t->deadline > __ticks ? t->deadline - __ticks : 1;
+         t->deadline = 0;
+         list_remove(&t->node);
+      }
+
+      t->interval = 0;
+   }
+   enable_interrupts(&var);
+   return old;
+}
+
+u64 ktimer_get_remaining(struct ktimer *t)
+{
+   u64 ret = 0;
+   ulong var;
+
+   disable_interrupts(&var);
+   {
+      if (t->deadline)
+         ret = t->deadline > __ticks ? t->deadline - __ticks : 1;
+   }
+   enable_interrupts(&var);
+   return ret;
+}
+
+static void tick_ktimers(void)
+{
+   struct ktimer *t;
+   u32 n;
+
+   ASSERT(!are_interrupts_enabled());
+
+   while (!list_is_empty(&ktimer_list)) {
+
+      t = list_first_obj(&ktimer_list, struct ktimer, node);
+
+      if (t->deadline > __ticks)
+         break;
+
+      list_remove(&t->node);
+
+      if (t->interval) {
+
+         /*
+          * Periodic timer: count all the periods elapsed so far, in case we
+          * accounted several ticks at once (see timer_idle_exit()).
+          */
+         for (n = 0; t->deadline <= __ticks; n++)
+            t->deadline += t->interval;
+
+         ktimer_list_insert(t);
+
+      } else {
+
+         t->deadline = 0;
+         n = 1;
+      }
+
+      t->cb(t, n);
+   }
+}
+
 static void tick_all_timers(void)
 {
-   struct task *pos, *temp;
+   struct task *pos;
    bool any_woken_up_task = false;
    ulong var;
 
-   /*
-    * This is *NOT* the best we can do. In particular, it's terrible to keep
-    * the interrupts disabled while iterating the _whole_ timer_wakeup_list.
-    * A better solution is to keep the tasks to wake-up in a sort of ordered
-    * list and then use relative timers. This way, at each tick we'll have to
-    * decrement just one single counter. We'll start decrement the next counter
-    * only when the first counter reaches 0 and the list node is removed.
-    *
-    * Of course, if we cannot use kmalloc() in case of sleep, it gets much
-    * harder to create such an ordered list and make it live inside a member
-    * of struct task. Maybe a BST will do the job, but that would require
-    * paying O(logN) per tick for finding the earliest timer. Not sure how
-    * better would be now for N < 50 (typical), given the huge added constant
-    * for the BST functions. Also, the cancellation of a timer would require
-    * some extra effort in order to re-calculate the relative timer values,
-    * while we want the cancellation to be light-fast because it's run by IRQ
-    * handlers.
-    *
-    * In conclusion, for the moment, given the very limited scale of Tilck (tens
-    * of tasks at most running on the whole system), this solution is safe and
-    * good-enough but, at some point a smarter ad-hoc solution for Tilck should
-    * be devised.
-    */
    disable_interrupts(&var);
 
-   list_for_each(pos, temp, &timer_wakeup_list, wakeup_timer_node) {
+   tick_ktimers();
 
-      /* If task is part of this list, it's counter must be > 0 */
-      ASSERT(pos->ticks_before_wake_up > 0);
+   while (!list_is_empty(&timer_wakeup_list)) {
 
-      if (UNLIKELY(--pos->ticks_before_wake_up == 0)) {
+      pos = list_first_obj(&timer_wakeup_list, struct task, wakeup_timer_node);
 
-         pos->timer_ready = true;
-         list_remove(&pos->wakeup_timer_node);
+      /* The list is sorted: no other timer can be expired after this one */
+      if (pos->wakeup_deadline > __ticks)
+         break;
 
-         if (pos->state == TASK_STATE_SLEEPING) {
-            task_change_state(pos, TASK_STATE_RUNNABLE);
-            any_woken_up_task = true;
-         }
+      pos->wakeup_deadline = 0;
+      pos->timer_ready = true;
+      list_remove(&pos->wakeup_timer_node);
+
+      if (pos->state == TASK_STATE_SLEEPING) {
+         task_change_state(pos, TASK_STATE_RUNNABLE);
+         any_woken_up_task = true;
+      } else {
+         sched_update_runnable_task(pos);
       }
    }
 
@@ -169,14 +418,14 @@ void kernel_sleep(u64 ticks)
     *    }
     *    kernel_yield();
     *
-    * But that would require task->ticks_before_wake_up to be actually 64-bit,
-    * wide and that's bad on 32-bit systems because:
+    * But that would require the `ticks` param of task_set_wakeup_timer() to be
+    * actually 64-bit wide and that's bad on 32-bit systems because:
     *
     *    - it would require using the soft 64-bit integers (slow)
     *    - it would make impossible, in the case we wanted that, the counter
     *      to be atomic.
     *
-    * Therefore, in order to use a 32-bit value for 'ticks_before_wake_up' and,
+    * Therefore, in order to use a 32-bit value for the wakeup ticks and,
     * at the same time being able to sleep for more than 2^32-1 ticks, we need
     * a more tricky implementation (below), and the little extra runtime price
     * for it is totally fine, since we're going to sleep anyways!
@@ -185,7 +434,7 @@ void kernel_sleep(u64 ticks)
     * ----------------------
     *
     * The simpler way to explain the algorithm is to just assume everything
-    * is in base 10 and that ticks_before_wake_up has 2 digits, while we want
+    * is in base 10 and that the wakeup ticks value has 2 digits, while we want
     * to support 4 digits sleep time. For example, we want to sleep for 234
     * ticks. The algorithm first computes 534 % 100 = 34 and then 534 / 100 = 5.
     * After that, it sleeps q (= 5) times for 99 ticks (max allowed). Clearly,
@@ -257,47 +506,164 @@ static ALWAYS_INLINE bool timer_nested_irq(void)
    return res;
 }
 
-static enum irq_action timer_irq_handler(void *ctx)
+static void account_ticks(u32 n)
 {
    u32 ns_delta;
+   ulong var;
+
+   for (u32 i = 0; i < n; i++) {
+
+      /*
+       * Compute `ns_delta` by reading `__tick_duration` and `__tick_adj_val`
+       * here without disabling interrupts, because it's safe to do so. Also,
+       * decrement `__tick_adj_ticks_rem` too. Why it's safe:
+       *
+       *    1. `__tick_duration` is immutable
+       *    2. `__tick_adj_val` is changed only by datetime.c while keeping
+       *       interrupts disabled and it's read only here, either by the timer
+       *       IRQ handler (nested timer IRQs are ignored, see below) or by the
+       *       idle task with interrupts disabled, in timer_idle_exit().
+       *       No other IRQ handler should read it.
+       */
+
+      if (__tick_adj_ticks_rem) {
+         ns_delta = (u32)((s32)__tick_duration + __tick_adj_val);
+         __tick_adj_ticks_rem--;
+      } else {
+         ns_delta = __tick_duration;
+      }
+
+      disable_interrupts(&var);
+      {
+         /*
+          * Alter __ticks and __time_ns here, while keeping the interrupts
+          * disabled because other IRQ handlers might need to use them. While,
+          * as explained above, `__tick_adj_val` and `__tick_adj_ticks_rem` will
+          * never need to be read or written by IRQ handlers.
+          */
+         __ticks++;
+         __time_ns += ns_delta;
+
+         if (tsc_clock)
+            tsc_clock_tick();
+
+         vdso_update_time(__time_ns, tsc_tick_cycles, tsc_tick_ns);
+      }
+      enable_interrupts(&var);
+
+      sched_account_ticks();
+   }
+}
+
+/*
+ * Dynamic tick (KRN_TICKLESS_IDLE): called by the idle task, with interrupts
+ * disabled, just before halting the CPU. When nothing but the idle task is
+ * runnable, there's no point in getting a timer IRQ at every tick: program the
+ * timer to fire just once, at the next timer deadline (if any). Because the PIT
+ * is a 16-bit counter, that cannot be farther than ~55 ms in the future.
+ */
+void timer_idle_enter(void)
+{
+   u64 ticks = UINT32_MAX;
+   u32 n;
+
+   ASSERT(!are_interrupts_enabled());
+
+   if (oneshot_ticks)
+      return; /* The timer is already in one-shot mode */
+
+   if (!list_is_empty(&timer_wakeup_list)) {
+
+      struct task *ti =
+         list_first_obj(&timer_wakeup_list, struct task, wakeup_timer_node);
+
+      if (ti->wakeup_deadline <= __ticks + 1)
+         return; /* The next timer will expire at the next tick */
+
+      ticks = ti->wakeup_deadline - __ticks;
+   }
+
+   if (!list_is_empty(&ktimer_list)) {
+
+      struct ktimer *t = list_first_obj(&ktimer_list, struct ktimer, node);
+
+      if (t->deadline <= __ticks + 1)
+         return; /* The next timer will expire at the next tick */
+
+      ticks = MIN(ticks, t->deadline - __ticks);
+   }
+
+   n = (u32)MIN(ticks, (u64)hw_timer_max_oneshot_ticks());
+
+   if (n < 2)
+      return; /* Not worth it */
+
+   hw_timer_set_oneshot(n);
+   oneshot_ticks = n;
+   tickless_idle_count++;
+}
+
+/*
+ * Called by the idle task, with interrupts disabled, after the CPU has been
+ * woken up by an IRQ. If that IRQ was not the one-shot timer IRQ, catch up
+ * with the ticks elapsed so far and make the timer to fire at the very next
+ * tick boundary, where the periodic mode will be restored.
+ */
+void timer_idle_exit(void)
+{
+   u32 elapsed;
+   ASSERT(!are_interrupts_enabled());
+   ASSERT(!is_preemption_enabled());
+
+   if (oneshot_ticks <= 1)
+      return; /* Nothing to do, the timer IRQ will restore the periodic mode */
+
+   if (hw_timer_oneshot_fired())
+      return; /* The timer IRQ is pending: it will do the job */
+
+   elapsed = hw_timer_oneshot_cut(oneshot_ticks);
+   oneshot_ticks = 1;
+
+   account_ticks(elapsed);
+}
+
+static u32 timer_irq_get_ticks_to_account(void)
+{
+   u32 n = 1;
+   ulong var;
+
+   disable_interrupts(&var);
+
+   /*
+    * The IRQ might be a periodic tick that has been already latched by the
+    * PIC before switching to the one-shot mode: in that case, just account it
+    * as a regular tick and keep waiting for the one-shot IRQ.
+    */
+   if (oneshot_ticks && hw_timer_oneshot_fired()) {
+      n = oneshot_ticks;
+      oneshot_ticks = 0;
+      hw_timer_set_periodic();
+   }
+
+   enable_interrupts(&var);
+   return n;
+}
+
+static enum irq_action timer_irq_handler(void *ctx)
+{
    ASSERT(are_interrupts_enabled());
 
    if (KRN_TRACK_NESTED_INTERR)
       if (timer_nested_irq())
          return IRQ_HANDLED;
 
-   /*
-    * Compute `ns_delta` by reading `__tick_duration` and `__tick_adj_val` here
-    * without disabling interrupts, because it's safe to do so. Also, decrement
-    * `__tick_adj_ticks_rem` too. Why it's safe:
-    *
-    *    1. `__tick_duration` is immutable
-    *    2. `__tick_adj_val` is changed only by datetime.c while keeping
-    *       interrupts disabled and it's read only here. Nested timer IRQs
-    *       will be ignored (see above). No other IRQ handler should read it.
-    */
+   profiler_tick(get_irq_regs());
 
-   if (__tick_adj_ticks_rem) {
-      ns_delta = (u32)((s32)__tick_duration + __tick_adj_val);
-      __tick_adj_ticks_rem--;
-   } else {
-      ns_delta = __tick_duration;
-   }
+   if (KRN_TICKLESS_IDLE)
+      account_ticks(timer_irq_get_ticks_to_account());
+   else
+      account_ticks(1);
 
-   disable_interrupts_forced();
-   {
-      /*
-       * Alter __ticks and __time_ns here, while keeping the interrupts disabled
-       * because other IRQ handlers might need to use them. While, as explained
-       * above, `__tick_adj_val` and `__tick_adj_ticks_rem` will never need to
-       * be read or written by IRQ handlers.
-       */
-      __ticks++;
-      __time_ns += ns_delta;
-   }
-   enable_interrupts_forced();
-
-   sched_account_ticks();
    tick_all_timers();
    return IRQ_HANDLED;
 }
@@ -311,6 +677,7 @@ struct bogo_measure_ctx {
    bool started;
    bool pass_start;
    u32 ticks;
+   u64 tsc_start;
 };
 
 static enum irq_action measure_bogomips_irq_handler(void *arg)
@@ -332,6 +699,7 @@ static enum irq_action measure_bogomips_irq_handler(void *arg)
        * from now, when the timer IRQ just arrived.
        */
       __bogo_loops = 0;
+      ctx->tsc_start = RDTSC();
       ctx->pass_start = true;
       return IRQ_NOT_HANDLED;
    }
@@ -344,9 +712,15 @@ static enum irq_action measure_bogomips_irq_handler(void *arg)
 
       disable_interrupts_forced();
       {
+         const u64 now = RDTSC();
+
          loops_per_tick = __bogo_loops * BOGOMIPS_CONST/MEASURE_BOGOMIPS_TICKS;
          loops_per_us = loops_per_tick / (1000000 / TIMER_HZ);
          __bogo_loops = -1;
+
+         tsc_clock_setup(now,
+                         now - ctx->tsc_start,
+                         (u64)MEASURE_BOGOMIPS_TICKS * __tick_duration);
       }
       enable_interrupts_forced();
    }
@@ -367,12 +741,24 @@ static void do_bogomips_loop(void *arg)
    }
    enable_preemption();
    printk("Tilck bogoMips: %u\n", loops_per_us);
+
+   if (tsc_clock)
+      printk("TSC clocksource: %u.%03u MHz\n", tsc_khz / 1000, tsc_khz % 1000);
 }
 
 void delay_us(u32 us)
 {
    FASTCALL void asm_nop_loop(u32 iters);
    ASSERT(!is_preemption_enabled());
+
+   if (tsc_clock) {
+
+      const u64 end = RDTSC() + (u64)us * tsc_khz / 1000;
+
+      while (RDTSC() < end) { }
+      return;
+   }
+
    asm_nop_loop(us * loops_per_us);
 }
 
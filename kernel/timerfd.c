@@ -0,0 +1,448 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/syscalls.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/worker_thread.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/kernelfs.h>
+
+#include <sys/timerfd.h> // system header
+
+/*
+ * timerfd: a file descriptor counting the expirations of a kernel timer.
+ *
+ * The ktimer callback runs in the timer IRQ handler, where it's not possible
+ * to signal kconds. Therefore, it just updates the expiration counter and
+ * enqueues a "bottom half" job on a worker thread, which wakes up the readers.
+ * The counter (and the `bh_pending` and `dead` flags) are protected by
+ * disabling the interrupts.
+ *
+ * Since a job might be still pending when the last handle is closed, in that
+ * case destroy_timerfd() leaves the object to the job, which will free it.
+ */
+
+struct timerfd {
+
+   KOBJ_BASE_FIELDS
+
+   struct ktimer timer;
+   clockid_t clockid;
+   u64 expirations;
+   bool bh_pending;           /* a timerfd_bh() job has been enqueued */
+   bool dead;                 /* no more handles: timerfd_bh() will free it */
+   struct kcond cond;
+};
+
+static struct kmem_cache timerfd_cache =
+   STATIC_KMEM_CACHE_INIT(timerfd_cache, "timerfd", sizeof(struct timerfd));
+
+static const struct file_ops static_ops_timerfd;
+
+static void free_timerfd(struct timerfd *t)
+{
+   kcond_destory(&t->cond);
+   kmem_cache_free(&timerfd_cache, t);
+}
+
+static void timerfd_bh(void *arg)
+{
+   struct timerfd *t = arg;
+   bool dead;
+   ulong var;
+
+   /* Prevent destroy_timerfd() from running in the middle */
+   disable_preemption();
+   {
+      disable_interrupts(&var);
+      {
+         t->bh_pending = false;
+         dead = t->dead;
+      }
+      enable_interrupts(&var);
+
+      if (!dead)
+         kcond_signal_all(&t->cond);
+   }
+   enable_preemption();
+
+   if (dead)
+      free_timerfd(t);
+}
+
+static void timerfd_expired(struct ktimer *timer, u32 n)
+{
+   struct timerfd *t = CONTAINER_OF(timer, struct timerfd, timer);
+   ASSERT(!are_interrupts_enabled());
+
+   t->expirations += n;
+
+   if (t->bh_pending)
+      return;
+
+   if (wth_enqueue_anywhere(WTH_PRIO_HIGHEST, &timerfd_bh, t))
+      t->bh_pending = true;
+   else
+      printk("WARNING: timerfd: unable to enqueue job\n");
+}
+
+static void destroy_timerfd(struct timerfd *t)
+{
+   bool bh_pending;
+   ulong var;
+
+   disable_interrupts(&var);
+   {
+      ktimer_cancel(&t->timer);
+      t->dead = true;
+      bh_pending = t->bh_pending;
+   }
+   enable_interrupts(&var);
+
+   if (!bh_pending)
+      free_timerfd(t);
+}
+
+static inline struct timerfd *get_timerfd(fs_handle h)
+{
+   return (void *)((struct kfs_handle *)h)->kobj;
+}
+
+static u64 timerfd_take_expirations(struct timerfd *t)
+{
+   u64 ret;
+   ulong var;
+
+   disable_interrupts(&var);
+   {
+      ret = t->expirations;
+      t->expirations = 0;
+   }
+   enable_interrupts(&var);
+   return ret;
+}
+
+static ssize_t timerfd_read(fs_handle h, char *buf, size_t size)
+{
+   struct kfs_handle *kh = h;
+   struct timerfd *t = get_timerfd(h);
+   u64 val;
+
+   if (size < sizeof(u64))
+      return -EINVAL;
+
+   while (true) {
+
+      /*
+       * Check the counter with preemption disabled, until we're in cond's
+       * wait_list: timerfd_bh() cannot signal the cond in the meanwhile.
+       */
+      disable_preemption();
+
+      if ((val = timerfd_take_expirations(t))) {
+         enable_preemption();
+         break;
+      }
+
+      if (kh->fl_flags & O_NONBLOCK) {
+         enable_preemption();
+         return -EAGAIN;
+      }
+
+      prepare_to_wait_on(WOBJ_KCOND, &t->cond, NO_EXTRA, &t->cond.wait_list);
+      enter_sleep_wait_state();
+      wait_obj_reset(&get_curr_task()->wobj);
+
+      if (pending_signals())
+         return -EINTR;
+   }
+
+   memcpy(buf, &val, sizeof(val));
+   return sizeof(val);
+}
+
+static int timerfd_read_ready(fs_handle h)
+{
+   struct timerfd *t = get_timerfd(h);
+   bool ret;
+   ulong var;
+
+   disable_interrupts(&var);
+   {
+      ret = t->expirations > 0;
+   }
+   enable_interrupts(&var);
+   return ret;
+}
+
+static struct kcond *timerfd_get_rready_cond(fs_handle h)
+{
+   return &get_timerfd(h)->cond;
+}
+
+static const struct file_ops static_ops_timerfd =
+{
+   .read = timerfd_read,
+   .read_ready = timerfd_read_ready,
+   .get_rready_cond = timerfd_get_rready_cond,
+};
+
+int sys_timerfd_create(clockid_t clockid, int flags)
+{
+   struct kfs_handle *h;
+   struct timerfd *t;
+   int fd;
+
+   if (clockid != CLOCK_REALTIME && clockid != CLOCK_MONOTONIC)
+      return -EINVAL;
+
+   if (flags & ~(TFD_CLOEXEC | TFD_NONBLOCK))
+      return -EINVAL;
+
+   if (!(t = kmem_cache_zalloc(&timerfd_cache)))
+      return -ENOMEM;
+
+   t->destory_obj = (void *)&destroy_timerfd;
+   t->clockid = clockid;
+   ktimer_init(&t->timer, &timerfd_expired);
+   kcond_init(&t->cond);
+
+   h = kfs_create_new_handle(&static_ops_timerfd,
+                             (void *)t,
+                             O_RDONLY | (flags & TFD_NONBLOCK));
+
+   if (!h) {
+      destroy_timerfd(t);
+      return -ENOMEM;
+   }
+
+   if ((fd = install_fs_handle(h, !!(flags & TFD_CLOEXEC))) < 0) {
+      kfs_destroy_handle(h);
+      destroy_timerfd(t);
+   }
+
+   return fd;
+}
+
+static struct timerfd *timerfd_from_fd(int fd, int *rc)
+{
+   struct fs_handle_base *h;
+
+   if (!(h = get_fs_handle(fd))) {
+      *rc = -EBADF;
+      return NULL;
+   }
+
+   if (h->fops != &static_ops_timerfd) {
+      *rc = -EINVAL;
+      return NULL;
+   }
+
+   return get_timerfd(h);
+}
+
+static inline bool is_valid_timespec(const struct k_timespec64 *ts)
+{
+   return ts->tv_sec >= 0 && ts->tv_nsec >= 0 && ts->tv_nsec < BILLION;
+}
+
+static struct k_timespec64 ticks_to_timespec(u64 ticks)
+{
+   return (struct k_timespec64) {
+      .tv_sec = (s64)(ticks / TIMER_HZ),
+      .tv_nsec = (long)(ticks % TIMER_HZ) * (BILLION / TIMER_HZ),
+   };
+}
+
+static void
+timerfd_get_value(struct timerfd *t, struct k_itimerspec64 *curr)
+{
+   u64 remaining, interval;
+   ulong var;
+
+   disable_interrupts(&var);
+   {
+      remaining = ktimer_get_remaining(&t->timer);
+      interval = t->timer.interval;
+   }
+   enable_interrupts(&var);
+
+   curr->it_value = ticks_to_timespec(remaining);
+   curr->it_interval = ticks_to_timespec(interval);
+}
+
+static int
+timerfd_settime_int(int fd,
+                    int flags,
+                    const struct k_itimerspec64 *val,
+                    struct k_itimerspec64 *old)
+{
+   struct k_timespec64 now;
+   struct timerfd *t;
+   u64 ticks, interval;
+   s64 ns;
+   ulong var;
+   int rc;
+
+   /* TFD_TIMER_CANCEL_ON_SET is not supported */
+   if (flags & ~TFD_TIMER_ABSTIME)
+      return -EINVAL;
+
+   if (!is_valid_timespec(&val->it_value) ||
+       !is_valid_timespec(&val->it_interval))
+   {
+      return -EINVAL;
+   }
+
+   if (!(t = timerfd_from_fd(fd, &rc)))
+      return rc;
+
+   ticks = timespec_to_ticks(&val->it_value);
+   interval = timespec_to_ticks(&val->it_interval);
+
+   if (ticks && (flags & TFD_TIMER_ABSTIME)) {
+
+      /* Convert the absolute expiration time to a relative one */
+      do_clock_gettime(t->clockid, &now);
+
+      ns = (val->it_value.tv_sec - now.tv_sec) * BILLION +
+           (val->it_value.tv_nsec - now.tv_nsec);
+
+      if (ns > 0)
+         ticks = ((u64)ns + BILLION / TIMER_HZ - 1) / (BILLION / TIMER_HZ);
+      else
+         ticks = 1; /* Already expired: expire at the next tick */
+   }
+
+   if (old)
+      timerfd_get_value(t, old);
+
+   disable_interrupts(&var);
+   {
+      ktimer_cancel(&t->timer);
+      t->expirations = 0;
+
+      if (ticks)
+         ktimer_set(&t->timer, ticks, interval);
+   }
+   enable_interrupts(&var);
+   return 0;
+}
+
+static int timerfd_gettime_int(int fd, struct k_itimerspec64 *curr)
+{
+   struct timerfd *t;
+   int rc;
+
+   if (!(t = timerfd_from_fd(fd, &rc)))
+      return rc;
+
+   timerfd_get_value(t, curr);
+   return 0;
+}
+
+static inline struct k_itimerspec64
+from_itimerspec32(const struct k_itimerspec32 *v)
+{
+   return (struct k_itimerspec64) {
+      .it_interval = { v->it_interval.tv_sec, v->it_interval.tv_nsec },
+      .it_value = { v->it_value.tv_sec, v->it_value.tv_nsec },
+   };
+}
+
+static inline struct k_itimerspec32
+to_itimerspec32(const struct k_itimerspec64 *v)
+{
+   return (struct k_itimerspec32) {
+      .it_interval = { (s32)v->it_interval.tv_sec, v->it_interval.tv_nsec },
+      .it_value = { (s32)v->it_value.tv_sec, v->it_value.tv_nsec },
+   };
+}
+
+int sys_timerfd_settime(int fd,
+                        int flags,
+                        const struct k_itimerspec64 *user_val,
+                        struct k_itimerspec64 *user_old)
+{
+   struct k_itimerspec64 val, old;
+   int rc;
+
+   if (copy_from_user(&val, user_val, sizeof(val)))
+      return -EFAULT;
+
+   if ((rc = timerfd_settime_int(fd, flags, &val, user_old ? &old : NULL)))
+      return rc;
+
+   if (user_old && copy_to_user(user_old, &old, sizeof(old)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_timerfd_gettime(int fd, struct k_itimerspec64 *user_curr)
+{
+   struct k_itimerspec64 curr;
+   int rc;
+
+   if ((rc = timerfd_gettime_int(fd, &curr)))
+      return rc;
+
+   if (copy_to_user(user_curr, &curr, sizeof(curr)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_timerfd_settime32(int fd,
+                          int flags,
+                          const struct k_itimerspec32 *user_val,
+                          struct k_itimerspec32 *user_old)
+{
+   struct k_itimerspec32 val32, old32;
+   struct k_itimerspec64 val, old;
+   int rc;
+
+   if (copy_from_user(&val32, user_val, sizeof(val32)))
+      return -EFAULT;
+
+   val = from_itimerspec32(&val32);
+
+   if ((rc = timerfd_settime_int(fd, flags, &val, user_old ? &old : NULL)))
+      return rc;
+
+   if (user_old) {
+
+      old32 = to_itimerspec32(&old);
+
+      if (copy_to_user(user_old, &old32, sizeof(old32)))
+         return -EFAULT;
+   }
+
+   return 0;
+}
+
+int sys_timerfd_gettime32(int fd, struct k_itimerspec32 *user_curr)
+{
+   struct k_itimerspec32 curr32;
+   struct k_itimerspec64 curr;
+   int rc;
+
+   if ((rc = timerfd_gettime_int(fd, &curr)))
+      return rc;
+
+   curr32 = to_itimerspec32(&curr);
+
+   if (copy_to_user(user_curr, &curr32, sizeof(curr32)))
+      return -EFAULT;
+
+   return 0;
+}
@@ -0,0 +1,86 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/page_size.h>
+
+#include <tilck/kernel/vdso.h>
+#include <tilck/kernel/hal.h>
+
+STATIC_ASSERT(OFFSET_OF(struct vdso_data, seq) == VDSO_DATA_SEQ_OFF);
+STATIC_ASSERT(OFFSET_OF(struct vdso_data, time_ns) == VDSO_DATA_TIME_NS_OFF);
+STATIC_ASSERT(
+   OFFSET_OF(struct vdso_data, boot_timestamp) == VDSO_DATA_BOOT_TS_OFF
+);
+STATIC_ASSERT(OFFSET_OF(struct vdso_data, flags) == VDSO_DATA_FLAGS_OFF);
+STATIC_ASSERT(
+   OFFSET_OF(struct vdso_data, tsc_cycles) == VDSO_DATA_TSC_CYCLES_OFF
+);
+STATIC_ASSERT(OFFSET_OF(struct vdso_data, tsc_ns) == VDSO_DATA_TSC_NS_OFF);
+STATIC_ASSERT(OFFSET_OF(struct vdso_data, tsc_mult) == VDSO_DATA_TSC_MULT_OFF);
+STATIC_ASSERT(
+   OFFSET_OF(struct vdso_data, tsc_shift) == VDSO_DATA_TSC_SHIFT_OFF
+);
+
+/*
+ * The data area of the vdso-like page (see <tilck/common/vdso.h>). It's NULL
+ * until the arch code has set up the page.
+ */
+static struct vdso_data *vdata;
+
+void init_vdso_data(void *vdso_page)
+{
+   STATIC_ASSERT(VDSO_DATA_OFF + sizeof(struct vdso_data) <= PAGE_SIZE);
+   vdata = (void *)((char *)vdso_page + VDSO_DATA_OFF);
+}
+
+/*
+ * Called by the timer IRQ handler with interrupts disabled: user space might
+ * read the data in any moment, but it cannot run in the middle of the update.
+ * Still, it might get preempted in the middle of its reads: hence the seqlock.
+ */
+void vdso_update_time(u64 time_ns, u64 tsc_cycles, u64 tsc_ns)
+{
+   ASSERT(!are_interrupts_enabled());
+
+   if (!vdata)
+      return;
+
+   vdata->seq++;
+   vdata->time_ns = time_ns;
+   vdata->tsc_cycles = tsc_cycles;
+   vdata->tsc_ns = tsc_ns;
+   vdata->seq++;
+}
+
+/* Called once the TSC clocksource has been calibrated, from IRQ context */
+void vdso_enable_tsc(u32 mult, u32 shift, u64 tsc_cycles, u64 tsc_ns)
+{
+   ASSERT(!are_interrupts_enabled());
+
+   if (!vdata)
+      return;
+
+   vdata->seq++;
+   vdata->tsc_mult = mult;
+   vdata->tsc_shift = shift;
+   vdata->tsc_cycles = tsc_cycles;
+   vdata->tsc_ns = tsc_ns;
+   vdata->flags |= VDSO_FL_TSC;
+   vdata->seq++;
+}
+
+void vdso_set_boot_timestamp(s64 ts)
+{
+   ulong var;
+
+   if (!vdata)
+      return;
+
+   disable_interrupts(&var);
+   {
+      vdata->seq++;
+      vdata->boot_timestamp = ts;
+      vdata->seq++;
+   }
+   enable_interrupts(&var);
+}
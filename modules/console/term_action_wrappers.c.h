@@ -55,13 +55,26 @@ static void term_execute_action(struct vterm *t, struct term_action *a)
    }
 }
 
+/*
+ * Execute a top-level action and then draw whatever it left dirty. Nested
+ * actions (the ones returned by the filter) are executed directly through
+ * term_execute_action() instead, as term_action_write() flushes on its own.
+ */
+static void term_exec_and_flush(struct vterm *t, struct term_action *a)
+{
+   term_execute_action(t, a);
+
+   if (term_flush(t) && t->cursor_enabled && ts_is_at_bottom(t))
+      t->vi->move_cursor(t->r, t->c, get_curr_cell_color(t));
+}
+
 static void
 term_execute_or_enqueue_action(struct vterm *t, struct term_action *a)
 {
    term_execute_or_enqueue_action_template(t,
                                            &t->rb_data,
                                            a,
-                                           (void *)&term_execute_action);
+                                           (void *)&term_exec_and_flush);
 }
 
 static void
@@ -60,6 +60,10 @@ struct vterm {
    bool *main_tabs_buf;
    bool *alt_tabs_buf;
 
+   bool *dirty_rows;          /* != NULL only with TERM_BATCHED_RENDERING */
+   u16 dirty_start;           /* first dirty row */
+   u16 dirty_end;             /* last dirty row + 1 (empty if <= start) */
+
    struct term_action actions_buf[32];
 
    term_filter filter;
@@ -154,6 +158,101 @@ static ALWAYS_INLINE bool ts_is_at_bottom(term *_t)
    return t->scroll == t->max_scroll;
 }
 
+/*
+ * Batched rendering (TERM_BATCHED_RENDERING)
+ * ---------------------------------------------
+ *
+ * Instead of pushing every single change to the video device, the term actions
+ * just update the buffer and mark the affected rows as dirty. At the end of
+ * each (top-level) action, term_flush() redraws the dirty rows with one
+ * set_row() call each, in a single FPU context. That's a big win when a lot of
+ * text is written at once: scrolling by N lines in a single write costs one
+ * redraw of the screen, not N, and each row gets redrawn once, no matter how
+ * many characters have been written in it.
+ */
+
+static ALWAYS_INLINE bool term_is_batched(term *_t)
+{
+   struct vterm *const t = _t;
+   return TERM_BATCHED_RENDERING && t->dirty_rows != NULL;
+}
+
+static ALWAYS_INLINE void term_mark_row_dirty(term *_t, u16 row)
+{
+   struct vterm *const t = _t;
+
+   t->dirty_rows[row] = true;
+   t->dirty_start = MIN(t->dirty_start, row);
+   t->dirty_end = MAX(t->dirty_end, (u16)(row + 1));
+}
+
+static void term_mark_rows_dirty(term *_t, u16 s, u16 e)
+{
+   struct vterm *const t = _t;
+
+   if (s >= e)
+      return;
+
+   memset(&t->dirty_rows[s], true, e - s);
+   t->dirty_start = MIN(t->dirty_start, s);
+   t->dirty_end = MAX(t->dirty_end, e);
+}
+
+/* Redraw the dirty rows, if any. Returns true if something has been drawn. */
+static bool term_flush(term *_t)
+{
+   struct vterm *const t = _t;
+   const bool fpu_allowed = !in_irq();
+
+   if (!term_is_batched(t) || t->dirty_start >= t->dirty_end)
+      return false;
+
+   if (fpu_allowed)
+      fpu_context_begin();
+
+   for (u16 row = t->dirty_start; row < t->dirty_end; row++) {
+
+      if (t->dirty_rows[row]) {
+         t->dirty_rows[row] = false;
+         t->vi->set_row(row, get_buf_row(t, row), fpu_allowed);
+      }
+   }
+
+   if (fpu_allowed)
+      fpu_context_end();
+
+   t->dirty_start = t->rows;
+   t->dirty_end = 0;
+   return true;
+}
+
+static ALWAYS_INLINE void
+ts_set_char_at(term *_t, u16 row, u16 col, u16 entry)
+{
+   struct vterm *const t = _t;
+   buf_set_entry(t, row, col, entry);
+
+   if (term_is_batched(t))
+      term_mark_row_dirty(t, row);
+   else
+      t->vi->set_char_at(row, col, entry);
+}
+
+/* Redraw the columns [col, cols) of `row`, after changing them in the buffer */
+static void ts_redraw_row_from(term *_t, u16 row, u16 col)
+{
+   struct vterm *const t = _t;
+   u16 *const buf_row = get_buf_row(t, row);
+
+   if (term_is_batched(t)) {
+      term_mark_row_dirty(t, row);
+      return;
+   }
+
+   for (u16 c = col; c < t->cols; c++)
+      t->vi->set_char_at(row, c, buf_row[c]);
+}
+
 static ALWAYS_INLINE u8 get_curr_cell_color(term *_t)
 {
    struct vterm *const t = _t;
@@ -190,6 +289,11 @@ static void term_redraw2(term *_t, u16 s, u16 e)
    if (!t->buffer)
       return;
 
+   if (term_is_batched(t)) {
+      term_mark_rows_dirty(t, s, e);
+      return;
+   }
+
    if (fpu_allowed)
       fpu_context_begin();
 
@@ -277,7 +381,11 @@ static void ts_clear_row(term *_t, u16 row, u8 color)
 {
    struct vterm *const t = _t;
    ts_buf_clear_row(t, row, color);
-   t->vi->clear_row(row, color);
+
+   if (term_is_batched(t))
+      term_mark_row_dirty(t, row);
+   else
+      t->vi->clear_row(row, color);
 }
 
 /* ---------------- term actions --------------------- */
@@ -427,7 +535,7 @@ static void term_internal_incr_row(term *_t)
 
    t->max_scroll++;
 
-   if (t->vi->scroll_one_line_up) {
+   if (t->vi->scroll_one_line_up && !term_is_batched(t)) {
       t->scroll++;
       t->vi->scroll_one_line_up();
    } else {
@@ -440,9 +548,7 @@ static void term_internal_incr_row(term *_t)
 static void term_internal_write_printable_char(term *_t, u8 c, u8 color)
 {
    struct vterm *const t = _t;
-   const u16 entry = make_vgaentry(c, color);
-   buf_set_entry(t, t->r, t->c, entry);
-   t->vi->set_char_at(t->r, t->c, entry);
+   ts_set_char_at(t, t->r, t->c, make_vgaentry(c, color));
    t->c++;
 }
 
@@ -475,8 +581,7 @@ static void term_internal_write_backspace(term *_t, u8 color)
    t->c--;
 
    if (!t->tabs_buf || !t->tabs_buf[t->r * t->cols + t->c]) {
-      buf_set_entry(t, t->r, t->c, space_entry);
-      t->vi->set_char_at(t->r, t->c, space_entry);
+      ts_set_char_at(t, t->r, t->c, space_entry);
       return;
    }
 
@@ -587,6 +692,8 @@ static void term_action_write(term *_t, char *buf, u32 len, u8 color)
          term_execute_action(t, &a);
    }
 
+   term_flush(t);
+
    if (t->cursor_enabled)
       vi->move_cursor(t->r, t->c, get_curr_cell_color(t));
 }
@@ -647,10 +754,8 @@ static void term_action_erase_in_display(term *_t, int mode, ...)
 
          /* Clear the screen from the cursor position up to the end */
 
-         for (u16 col = t->c; col < t->cols; col++) {
-            buf_set_entry(t, t->r, col, entry);
-            t->vi->set_char_at(t->r, col, entry);
-         }
+         for (u16 col = t->c; col < t->cols; col++)
+            ts_set_char_at(t, t->r, col, entry);
 
          for (u16 i = t->r + 1; i < t->rows; i++)
             ts_clear_row(t, i, DEFAULT_COLOR16);
@@ -664,10 +769,8 @@ static void term_action_erase_in_display(term *_t, int mode, ...)
          for (u16 i = 0; i < t->r; i++)
             ts_clear_row(t, i, DEFAULT_COLOR16);
 
-         for (u16 col = 0; col < t->c; col++) {
-            buf_set_entry(t, t->r, col, entry);
-            t->vi->set_char_at(t->r, col, entry);
-         }
+         for (u16 col = 0; col < t->c; col++)
+            ts_set_char_at(t, t->r, col, entry);
 
          break;
 
@@ -705,17 +808,13 @@ static void term_action_erase_in_line(term *_t, int mode, ...)
    switch (mode) {
 
       case 0:
-         for (u16 col = t->c; col < t->cols; col++) {
-            buf_set_entry(t, t->r, col, entry);
-            t->vi->set_char_at(t->r, col, entry);
-         }
+         for (u16 col = t->c; col < t->cols; col++)
+            ts_set_char_at(t, t->r, col, entry);
          break;
 
       case 1:
-         for (u16 col = 0; col < t->c; col++) {
-            buf_set_entry(t, t->r, col, entry);
-            t->vi->set_char_at(t->r, col, entry);
-         }
+         for (u16 col = 0; col < t->c; col++)
+            ts_set_char_at(t, t->r, col, entry);
          break;
 
       case 2:
@@ -767,8 +866,7 @@ static void term_action_ins_blank_chars(term *_t, u16 n, ...)
    for (u16 c = t->c; c < t->c + n; c++)
       buf_row[c] = make_vgaentry(' ', vgaentry_get_color(buf_row[c]));
 
-   for (u16 c = t->c; c < t->cols; c++)
-      t->vi->set_char_at(row, c, buf_row[c]);
+   ts_redraw_row_from(t, row, t->c);
 }
 
 static void term_action_del_chars_in_line(term *_t, u16 n, ...)
@@ -784,8 +882,7 @@ static void term_action_del_chars_in_line(term *_t, u16 n, ...)
    for (u16 c = t->c + cN; c < MIN(t->c + cN + n - maxN, t->cols); c++)
       buf_row[c] = make_vgaentry(' ', vgaentry_get_color(buf_row[c]));
 
-   for (u16 c = t->c; c < t->cols; c++)
-      t->vi->set_char_at(row, c, buf_row[c]);
+   ts_redraw_row_from(t, row, t->c);
 }
 
 static void term_action_erase_chars_in_line(term *_t, u16 n, ...)
@@ -797,8 +894,7 @@ static void term_action_erase_chars_in_line(term *_t, u16 n, ...)
    for (u16 c = t->c; c < MIN(t->cols, t->c + n); c++)
       buf_row[c] = make_vgaentry(' ', vgaentry_get_color(buf_row[c]));
 
-   for (u16 c = t->c; c < t->cols; c++)
-      t->vi->set_char_at(row, c, buf_row[c]);
+   ts_redraw_row_from(t, row, t->c);
 }
 
 static void term_action_pause_video_output(term *_t, ...)
@@ -1003,6 +1099,7 @@ debug_term_dump_font_table(term *_t)
 
    term_internal_incr_row(t);
    t->c = 0;
+   term_flush(t);
 }
 
 #endif
@@ -1039,6 +1136,11 @@ dispose_term(term *_t)
       t->main_tabs_buf = NULL;
    }
 
+   if (t->dirty_rows) {
+      kfree2(t->dirty_rows, t->rows);
+      t->dirty_rows = NULL;
+   }
+
    if (t->alt_tabs_buf) {
       kfree2(t->alt_tabs_buf, t->cols * t->rows);
       t->alt_tabs_buf = NULL;
@@ -1156,6 +1258,14 @@ init_vterm(term *_t,
          printk("WARNING: unable to allocate main_tabs_buf\n");
       }
 
+      if (TERM_BATCHED_RENDERING) {
+
+         /* If the allocation fails, just draw everything immediately */
+         t->dirty_rows = kzmalloc(t->rows);
+         t->dirty_start = t->rows;
+         t->dirty_end = 0;
+      }
+
    } else {
 
       /* We're in panic or we were unable to allocate the buffer */
@@ -1181,6 +1291,7 @@ init_vterm(term *_t,
    for (u16 i = 0; i < t->rows; i++)
       ts_clear_row(t, i, DEFAULT_COLOR16);
 
+   term_flush(t);
    t->initialized = true;
    return 0;
 }
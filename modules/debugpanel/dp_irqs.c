@@ -24,6 +24,16 @@ static void debug_dump_slow_irq_handler_count(void)
    }
 }
 
+static void debug_dump_tickless_idle_count(void)
+{
+   extern u32 tickless_idle_count;
+
+   if (KRN_TICKLESS_IDLE) {
+      dp_write(row++, 0, "   Tickless idle periods: %u",
+               tickless_idle_count);
+   }
+}
+
 static void debug_dump_spur_irq_count(void)
 {
    extern u32 spur_irq_count;
@@ -68,6 +78,7 @@ static void dp_show_irq_stats(void)
 
    dp_write(row++, 0, "Kernel IRQ-related counters");
    debug_dump_slow_irq_handler_count();
+   debug_dump_tickless_idle_count();
    debug_dump_spur_irq_count();
    debug_dump_unhandled_irq_count();
 }
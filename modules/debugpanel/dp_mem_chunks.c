@@ -243,7 +243,7 @@ static void dp_show_chunks(void)
 static struct dp_screen dp_chunks_screen =
 {
    .index = 5,
-   .label = "MemChunks",
+   .label = "Chunks",
    .draw_func = dp_show_chunks,
    .on_dp_enter = dp_chunks_enter,
    .on_dp_exit = dp_chunks_exit,
@@ -76,12 +76,15 @@ static void dp_show_opts(void)
 
    DUMP_LABEL("Disabled by default");
    DUMP_BOOL_OPT(TERM_BIG_SCROLL_BUF);
+   DUMP_BOOL_OPT(TERM_BATCHED_RENDERING);
    DUMP_BOOL_OPT(KRN_RESCHED_ENABLE_PREEMPT);
+   DUMP_BOOL_OPT(KRN_TICKLESS_IDLE);
    DUMP_BOOL_OPT(KERNEL_BIG_IO_BUF);
    DUMP_BOOL_OPT(PS2_DO_SELFTEST);
    DUMP_BOOL_OPT(PS2_VERBOSE_DEBUG_LOG);
    DUMP_BOOL_OPT(KERNEL_GCOV);
    DUMP_BOOL_OPT(FORK_NO_COW);
+   DUMP_BOOL_OPT(FORK_SHARE_PAGE_TABLES);
    DUMP_BOOL_OPT(MMAP_NO_COW);
    DUMP_BOOL_OPT(PANIC_SHOW_REGS);
    DUMP_BOOL_OPT(KMALLOC_HEAVY_STATS);
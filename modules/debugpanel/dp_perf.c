@@ -0,0 +1,281 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck_gen_headers/config_modules.h>
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/latency.h>
+#include <tilck/kernel/syscalls.h>
+#include <tilck/mods/profiler.h>
+
+#include "termutil.h"
+#include "dp_int.h"
+
+#define DP_PERF_MAX_FUNCS                                64
+
+enum dp_perf_view {
+   dp_perf_view_prof,
+   dp_perf_view_lat,
+};
+
+static enum dp_perf_view view = MOD_tracing ? dp_perf_view_prof
+                                            : dp_perf_view_lat;
+
+static struct prof_stats prof_st;
+static struct prof_func_stats prof_funcs[DP_PERF_MAX_FUNCS];
+static int prof_funcs_count;
+static int row;
+
+static void dp_perf_refresh(void)
+{
+   if (MOD_tracing && view == dp_perf_view_prof) {
+      prof_funcs_count =
+         profiler_get_top_funcs(&prof_st, prof_funcs, DP_PERF_MAX_FUNCS);
+   }
+}
+
+static void dp_perf_enter(void)
+{
+   dp_perf_refresh();
+}
+
+static enum kb_handler_action
+dp_perf_prof_keypress(struct key_event ke)
+{
+   switch (ke.print_char) {
+
+      case 's':
+
+         if (profiler_is_enabled())
+            profiler_stop();
+         else if (profiler_start() == -ENOMEM)
+            modal_msg = "Not enough memory for the profiler";
+
+         return kb_handler_ok_and_continue;
+
+      case 'c':
+         profiler_reset();
+         return kb_handler_ok_and_continue;
+   }
+
+   return kb_handler_nak;
+}
+
+static enum kb_handler_action
+dp_perf_keypress(struct key_event ke)
+{
+   enum kb_handler_action rc = kb_handler_ok_and_continue;
+
+   switch (ke.print_char) {
+
+      case 'p':
+
+         if (!MOD_tracing)
+            modal_msg = "The tracing module is NOT built-in";
+         else
+            view = dp_perf_view_prof;
+
+         break;
+
+      case 'l':
+         view = dp_perf_view_lat;
+         break;
+
+      case 'r':
+         break;
+
+      default:
+
+         if (MOD_tracing && view == dp_perf_view_prof)
+            rc = dp_perf_prof_keypress(ke);
+         else if (ke.print_char == 'c')
+            lat_reset_all();
+         else
+            rc = kb_handler_nak;
+   }
+
+   if (rc == kb_handler_ok_and_continue) {
+      dp_perf_refresh();
+      ui_need_update = true;
+   }
+
+   return rc;
+}
+
+/* Returns the value of `n` / `tot` in tenths of percent */
+static u32 dp_perf_permille(u32 n, u32 tot)
+{
+   return tot ? (u32)((u64)n * 1000 / tot) : 0;
+}
+
+static void dp_show_prof(void)
+{
+   const u32 tot = prof_st.samples;
+
+   dp_writeln(
+      E_COLOR_BR_WHITE "l" RESET_ATTRS ": latency view " TERM_VLINE " "
+      E_COLOR_BR_WHITE "s" RESET_ATTRS ": start/stop " TERM_VLINE " "
+      E_COLOR_BR_WHITE "c" RESET_ATTRS ": clear " TERM_VLINE " "
+      E_COLOR_BR_WHITE "r" RESET_ATTRS ": refresh"
+   );
+
+   dp_writeln("");
+
+   dp_writeln("Profiler: %s" RESET_ATTRS "    Samples: %u/%u    Lost: %u",
+              profiler_is_enabled()
+                 ? E_COLOR_BR_GREEN "ON "
+                 : E_COLOR_BR_RED "OFF",
+              tot, PROF_MAX_SAMPLES, prof_st.lost);
+
+   dp_writeln("User mode: %u (%u.%u%%)    Unknown: %u    "
+              "Export: /dev/profiler",
+              prof_st.user,
+              dp_perf_permille(prof_st.user, tot) / 10,
+              dp_perf_permille(prof_st.user, tot) % 10,
+              prof_st.unknown);
+
+   dp_writeln("");
+
+   dp_writeln(
+                 "   Self  "
+      TERM_VLINE "  Self %% "
+      TERM_VLINE "  Total  "
+      TERM_VLINE " Total %% "
+      TERM_VLINE " Function"
+   );
+
+   dp_writeln(
+      GFX_ON
+      "qqqqqqqqqnqqqqqqqqqnqqqqqqqqqnqqqqqqqqqn"
+      "qqqqqqqqqqqqqqqqqqqqqqqqqqqqqqq"
+      GFX_OFF
+   );
+
+   for (int i = 0; i < prof_funcs_count; i++) {
+
+      const struct prof_func_stats *f = &prof_funcs[i];
+      const u32 self_pm = dp_perf_permille(f->self, tot);
+      const u32 total_pm = dp_perf_permille(f->total, tot);
+
+      dp_writeln("%8u "
+                 TERM_VLINE " %4u.%u%% "
+                 TERM_VLINE "%8u "
+                 TERM_VLINE " %4u.%u%% "
+                 TERM_VLINE " %.30s",
+                 f->self,
+                 self_pm / 10, self_pm % 10,
+                 f->total,
+                 total_pm / 10, total_pm % 10,
+                 f->name);
+   }
+
+   dp_writeln("");
+}
+
+static u64 dp_lat_value(u64 cycles)
+{
+   return tsc_clock_enabled() ? tsc_cycles_to_ns(cycles) / 1000 : cycles;
+}
+
+static void dp_show_lat_hist(const char *name, const struct lat_hist *h)
+{
+   struct lat_hist hc;
+
+   if (!lat_hist_get(h, &hc))
+      return;
+
+   dp_writeln("%-19s"
+              TERM_VLINE " %8u "
+              TERM_VLINE " %9llu "
+              TERM_VLINE " %9llu "
+              TERM_VLINE " %9llu "
+              TERM_VLINE " %9llu",
+              name,
+              hc.count,
+              dp_lat_value(hc.sum / hc.count),
+              dp_lat_value(lat_hist_percentile(&hc, 50)),
+              dp_lat_value(lat_hist_percentile(&hc, 99)),
+              dp_lat_value(lat_hist_percentile(&hc, 100)));
+}
+
+static void dp_show_lat(void)
+{
+   char name[32];
+
+   dp_writeln(
+      E_COLOR_BR_WHITE "p" RESET_ATTRS ": profiler view " TERM_VLINE " "
+      E_COLOR_BR_WHITE "c" RESET_ATTRS ": clear " TERM_VLINE " "
+      E_COLOR_BR_WHITE "r" RESET_ATTRS ": refresh " TERM_VLINE " "
+      "Export: /dev/latency"
+   );
+
+   dp_writeln("");
+
+   dp_writeln("Latencies in %s. Percentiles are log2 buckets' upper bounds.",
+              tsc_clock_enabled() ? "microseconds" : "TSC cycles");
+
+   dp_writeln("");
+
+   dp_writeln(
+                 " Path              "
+      TERM_VLINE "   Count  "
+      TERM_VLINE "    Avg    "
+      TERM_VLINE "   p50 <   "
+      TERM_VLINE "   p99 <   "
+      TERM_VLINE "   Max <"
+   );
+
+   dp_writeln(
+      GFX_ON
+      "qqqqqqqqqqqqqqqqqqqnqqqqqqqqqqnqqqqqqqqqqqnqqqqqqqqqqqn"
+      "qqqqqqqqqqqnqqqqqqqqqqq"
+      GFX_OFF
+   );
+
+   for (int i = 0; i < LAT_HIST_IRQS; i++) {
+      snprintk(name, sizeof(name), "IRQ #%d", i);
+      dp_show_lat_hist(name, &lat_irq_hists[i]);
+   }
+
+   dp_show_lat_hist("Page faults", &lat_page_fault_hist);
+   dp_show_lat_hist("Wakeup to run", &lat_wakeup_hist);
+
+   for (u32 i = 0; i < MAX_SYSCALLS; i++) {
+
+      if (!lat_get_syscall_hist(i))
+         continue;
+
+      lat_get_syscall_name(i, name, sizeof(name));
+      dp_show_lat_hist(name, lat_get_syscall_hist(i));
+   }
+
+   dp_writeln("");
+}
+
+static void dp_show_perf(void)
+{
+   row = dp_screen_start_row;
+
+   if (MOD_tracing && view == dp_perf_view_prof)
+      dp_show_prof();
+   else
+      dp_show_lat();
+}
+
+static struct dp_screen dp_perf_screen =
+{
+   .index = 6,
+   .label = "Perf",
+   .draw_func = dp_show_perf,
+   .on_dp_enter = dp_perf_enter,
+   .on_keypress_func = dp_perf_keypress,
+};
+
+__attribute__((constructor))
+static void dp_perf_init(void)
+{
+   dp_register_screen(&dp_perf_screen);
+}
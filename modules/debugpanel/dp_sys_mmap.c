@@ -166,6 +166,26 @@ static void dump_global_mem_stats(void)
    dp_writeln("");
 }
 
+static void dump_cow_stats(void)
+{
+   extern u32 cow_faults_count;
+   extern u32 cow_page_copies_count;
+   extern u32 shared_pt_copies_count;
+
+   dp_writeln(
+      "Copy-on-write faults:        %8u [ pages copied: %u ]",
+      cow_faults_count,
+      cow_page_copies_count
+   );
+
+   dp_writeln(
+      "Shared page tables copied:   %8u",
+      shared_pt_copies_count
+   );
+
+   dp_writeln("");
+}
+
 static void dp_show_sys_mmap(void)
 {
    row = dp_screen_start_row;
@@ -176,6 +196,8 @@ static void dp_show_sys_mmap(void)
    }
    enable_preemption();
 
+   dump_cow_stats();
+
    dump_memory_map();
 
 #ifdef arch_x86_family
@@ -127,8 +127,10 @@ tracing_ui_msg(void)
    get_traced_syscalls_str(line_buf, TRACED_SYSCALLS_STR_LEN);
 
    dp_write_raw(
-      TERM_VLINE
-      " Trace expr: " E_COLOR_YELLOW "%s" RESET_ATTRS "\r\n", line_buf
+      TERM_VLINE " #Dropped: " E_COLOR_BR_BLUE "%u" RESET_ATTRS " "
+      TERM_VLINE " Trace expr: " E_COLOR_YELLOW "%s" RESET_ATTRS "\r\n",
+      tracing_get_dropped_events_count(),
+      line_buf
    );
 
    dp_write_raw("\r\n");
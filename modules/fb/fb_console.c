@@ -181,6 +181,9 @@ static void fb_set_row_optimized(u16 row, u16 *data, bool fpu_allowed)
                               fb_term_cols,
                               fpu_allowed);
 
+   if (cursor_row == row)
+      fb_save_under_cursor_buf();
+
    fb_reset_blink_timer();
 }
 
@@ -0,0 +1,484 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/atomics.h>
+
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/sort.h>
+#include <tilck/kernel/elf_utils.h>
+#include <tilck/kernel/fs/devfs.h>
+#include <tilck/kernel/fs/vfs.h>
+
+#include <tilck/mods/profiler.h>
+
+#define PROF_LINE_BUF_SZ                         512
+#define PROF_SYM_NAME_MAX_LEN                     60    /* see "%.60s" below */
+
+/*
+ * The position of a /dev/profiler handle: the low bits are the index of the
+ * next sample to read, the high ones the reset generation it refers to.
+ */
+#define PROF_POS_IDX_BITS                         13
+#define PROF_POS_IDX_MASK         ((1u << PROF_POS_IDX_BITS) - 1)
+#define PROF_POS_GEN_MASK          (INT32_MAX >> PROF_POS_IDX_BITS)
+
+struct prof_sym {
+
+   ulong vaddr;
+   u32 size;
+   const char *name;
+};
+
+bool __profiler_on;
+
+/*
+ * The samples are written only by the timer IRQ handler, which cannot be
+ * nested with itself, and read by the profiler's users in process context.
+ * Because on a single CPU an IRQ handler always runs to completion before the
+ * interrupted code is resumed, it's enough to publish each sample by storing
+ * `samples_count` after having written it.
+ */
+static struct prof_sample *samples;
+static ATOMIC(u32) samples_count;
+static u32 lost_samples;
+static u32 reset_gen;            /* incremented by every profiler_reset() */
+
+/* Sorted by address, allocated at the first profiler_start() */
+static struct prof_sym *syms;
+static u32 syms_count;
+
+/* Per-symbol counters, used by profiler_get_top_funcs() */
+static u32 *syms_self;
+static u32 *syms_total;
+static u32 *syms_last_sample;
+
+static struct kmutex prof_mutex;
+static char line_buf[PROF_LINE_BUF_SZ];
+
+static bool
+is_prof_sym(struct elf_symbol_info *i)
+{
+   return i->name && *i->name && i->size && (ulong)i->vaddr >= KERNEL_BASE_VA;
+}
+
+static int
+prof_count_sym_cb(struct elf_symbol_info *i, void *arg)
+{
+   if (is_prof_sym(i))
+      (*(u32 *)arg)++;
+
+   return 0;
+}
+
+static int
+prof_add_sym_cb(struct elf_symbol_info *i, void *arg)
+{
+   const u32 max_count = *(u32 *)arg;
+
+   if (!is_prof_sym(i) || syms_count == max_count)
+      return 0;
+
+   syms[syms_count++] = (struct prof_sym) {
+      .vaddr = (ulong)i->vaddr,
+      .size = i->size,
+      .name = i->name,
+   };
+
+   return 0;
+}
+
+static long
+prof_sym_cmp(const void *a, const void *b)
+{
+   const struct prof_sym *sa = a;
+   const struct prof_sym *sb = b;
+
+   if (sa->vaddr == sb->vaddr)
+      return 0;
+
+   return sa->vaddr < sb->vaddr ? -1 : 1;
+}
+
+static int
+prof_find_sym(ulong va)
+{
+   int lo = 0, hi = (int)syms_count - 1, res = -1;
+
+   while (lo <= hi) {
+
+      const int mid = lo + (hi - lo) / 2;
+
+      if (syms[mid].vaddr <= va) {
+         res = mid;
+         lo = mid + 1;
+      } else {
+         hi = mid - 1;
+      }
+   }
+
+   if (res >= 0 && va - syms[res].vaddr >= syms[res].size)
+      return -1;
+
+   return res;
+}
+
+/*
+ * Except for frames[0] (the interrupted IP), the frames are return addresses:
+ * look for `va - 1` in order to resolve the calling function even when the
+ * call was the last instruction of its body (e.g. calling a NORETURN func).
+ */
+static int
+prof_find_frame_sym(const struct prof_sample *s, u32 frame)
+{
+   return prof_find_sym(frame ? s->frames[frame] - 1 : s->frames[frame]);
+}
+
+static int
+prof_alloc_data(void)
+{
+   u32 count = 0;
+
+   foreach_symbol(prof_count_sym_cb, &count);
+
+   if (!(samples = kalloc_array_obj(struct prof_sample, PROF_MAX_SAMPLES)))
+      goto oom;
+
+   if (!count)
+      return 0; /* No kernel symbols: the samples cannot be resolved */
+
+   if (!(syms = kalloc_array_obj(struct prof_sym, count)))
+      goto oom;
+
+   if (!(syms_self = kalloc_array_obj(u32, count)))
+      goto oom;
+
+   if (!(syms_total = kalloc_array_obj(u32, count)))
+      goto oom;
+
+   if (!(syms_last_sample = kalloc_array_obj(u32, count)))
+      goto oom;
+
+   foreach_symbol(prof_add_sym_cb, &count);
+   insertion_sort_generic(syms, sizeof(syms[0]), syms_count, prof_sym_cmp);
+   return 0;
+
+oom:
+   kfree_array_obj(syms_last_sample, u32, count);
+   kfree_array_obj(syms_total, u32, count);
+   kfree_array_obj(syms_self, u32, count);
+   kfree_array_obj(syms, struct prof_sym, count);
+   kfree_array_obj(samples, struct prof_sample, PROF_MAX_SAMPLES);
+   syms_last_sample = syms_total = syms_self = NULL;
+   syms = NULL;
+   samples = NULL;
+   syms_count = 0;
+   return -ENOMEM;
+}
+
+/*
+ * Walk the frame pointers of the interrupted kernel code, accepting only the
+ * frames within the current task's kernel stack, growing towards its top.
+ */
+static u32
+prof_walk_stack(regs_t *r, ulong *frames)
+{
+   const ulong stack_lo = (ulong)get_curr_task()->kernel_stack;
+   const ulong stack_hi = stack_lo + KERNEL_STACK_SIZE;
+   ulong fp = regs_get_frame_ptr(r);
+   ulong ret;
+   u32 n = 0;
+
+   frames[n++] = regs_get_ip(r);
+
+   while (n < PROF_MAX_FRAMES) {
+
+      if (fp < stack_lo || fp > stack_hi - 2 * sizeof(ulong))
+         break;
+
+      if (fp & (sizeof(ulong) - 1))
+         break;
+
+      ret = ((ulong *)fp)[1];
+
+      if (ret < KERNEL_BASE_VA)
+         break;
+
+      frames[n++] = ret;
+
+      if (((ulong *)fp)[0] <= fp)
+         break;
+
+      fp = ((ulong *)fp)[0];
+   }
+
+   return n;
+}
+
+void
+profiler_record_sample(regs_t *r)
+{
+   const u32 n = atomic_load_explicit(&samples_count, mo_relaxed);
+   struct prof_sample *s;
+
+   if (n == PROF_MAX_SAMPLES) {
+      lost_samples++;
+      return;
+   }
+
+   s = &samples[n];
+   s->n_frames = regs_in_user_mode(r) ? 0 : prof_walk_stack(r, s->frames);
+   atomic_store_explicit(&samples_count, n + 1, mo_release);
+}
+
+int
+profiler_start(void)
+{
+   int rc = 0;
+
+   kmutex_lock(&prof_mutex);
+   {
+      if (!samples)
+         rc = prof_alloc_data();
+
+      if (!rc)
+         __profiler_on = true;
+   }
+   kmutex_unlock(&prof_mutex);
+   return rc;
+}
+
+void
+profiler_stop(void)
+{
+   __profiler_on = false;
+}
+
+void
+profiler_reset(void)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      atomic_store_explicit(&samples_count, 0, mo_relaxed);
+      lost_samples = 0;
+      reset_gen++;
+   }
+   enable_interrupts(&var);
+}
+
+static void
+prof_aggregate_samples(struct prof_stats *st, u32 n)
+{
+   bzero(syms_self, sizeof(u32) * syms_count);
+   bzero(syms_total, sizeof(u32) * syms_count);
+   bzero(syms_last_sample, sizeof(u32) * syms_count);
+
+   for (u32 i = 0; i < n; i++) {
+
+      const struct prof_sample *s = &samples[i];
+
+      if (!s->n_frames) {
+         st->user++;
+         continue;
+      }
+
+      for (u32 j = 0; j < s->n_frames; j++) {
+
+         const int idx = prof_find_frame_sym(s, j);
+
+         if (idx < 0) {
+
+            if (!j)
+               st->unknown++;
+
+            continue;
+         }
+
+         if (!j)
+            syms_self[idx]++;
+
+         /* Count each function once per sample, even if recursive */
+         if (syms_last_sample[idx] != i + 1) {
+            syms_last_sample[idx] = i + 1;
+            syms_total[idx]++;
+         }
+      }
+   }
+}
+
+int
+profiler_get_top_funcs(struct prof_stats *st,
+                       struct prof_func_stats *funcs,
+                       int max_funcs)
+{
+   int count = 0;
+   bzero(st, sizeof(*st));
+
+   kmutex_lock(&prof_mutex);
+
+   if (!samples)
+      goto out; /* The profiler has never been started */
+
+   st->samples = atomic_load_explicit(&samples_count, mo_acquire);
+   st->lost = lost_samples;
+   prof_aggregate_samples(st, st->samples);
+
+   for (; count < max_funcs; count++) {
+
+      int best = -1;
+
+      for (u32 i = 0; i < syms_count; i++) {
+         if (syms_self[i] && (best < 0 || syms_self[i] > syms_self[best]))
+            best = (int)i;
+      }
+
+      if (best < 0)
+         break;
+
+      funcs[count] = (struct prof_func_stats) {
+         .name = syms[best].name,
+         .vaddr = syms[best].vaddr,
+         .self = syms_self[best],
+         .total = syms_total[best],
+      };
+
+      syms_self[best] = 0;
+   }
+
+out:
+   kmutex_unlock(&prof_mutex);
+   return count;
+}
+
+/* Write a sample as a line in the "folded stacks" format: root first */
+static size_t
+prof_fold_sample(const struct prof_sample *s, char *buf, size_t size)
+{
+   size_t len = 0;
+   int idx;
+
+   if (!s->n_frames)
+      return (size_t)snprintk(buf, size, "[user] 1\n");
+
+   for (u32 j = s->n_frames; j > 0; j--) {
+
+      const char *sep = j > 1 ? ";" : "";
+
+      if ((idx = prof_find_frame_sym(s, j - 1)) >= 0) {
+
+         len += (size_t)snprintk(buf + len, size - len,
+                                 "%.60s%s",
+                                 syms[idx].name, sep);
+
+      } else {
+
+         len += (size_t)snprintk(buf + len, size - len,
+                                 "%p%s", TO_PTR(s->frames[j - 1]), sep);
+      }
+   }
+
+   len += (size_t)snprintk(buf + len, size - len, " 1\n");
+   return len;
+}
+
+static ssize_t
+profiler_dev_read(fs_handle h, char *buf, size_t size)
+{
+   struct devfs_handle *dh = h;
+   size_t tot = 0, len;
+   ssize_t rc = 0;
+   u32 gen, count, idx;
+   ulong var;
+
+   kmutex_lock(&prof_mutex);
+
+   disable_interrupts(&var);
+   {
+      gen = reset_gen & PROF_POS_GEN_MASK;
+      count = atomic_load_explicit(&samples_count, mo_acquire);
+   }
+   enable_interrupts(&var);
+
+   /* The profiler has been reset since the last read: restart from 0 */
+   idx = ((u32)dh->pos >> PROF_POS_IDX_BITS) == gen
+      ? (u32)dh->pos & PROF_POS_IDX_MASK
+      : 0;
+
+   while (samples && idx < count) {
+
+      len = prof_fold_sample(&samples[idx], line_buf, sizeof(line_buf));
+
+      if (tot + len > size) {
+
+         if (!tot)
+            rc = -EINVAL; /* The buffer cannot contain even a single line */
+
+         break;
+      }
+
+      if (copy_to_any_buf(buf + tot, line_buf, len)) {
+
+         if (!tot)
+            rc = -EFAULT;
+
+         break;
+      }
+
+      tot += len;
+      idx++;
+   }
+
+   dh->pos = (offt)((gen << PROF_POS_IDX_BITS) | idx);
+   kmutex_unlock(&prof_mutex);
+   return rc ? rc : (ssize_t)tot;
+}
+
+static int
+create_profiler_device(int minor,
+                       const struct file_ops **fops_ref,
+                       enum vfs_entry_type *t,
+                       int *spec_flags_ref)
+{
+   static const struct file_ops static_ops_profiler = {
+      .read = profiler_dev_read,
+   };
+
+   *t = VFS_CHAR_DEV;
+   *fops_ref = &static_ops_profiler;
+   *spec_flags_ref = VFS_SPFL_NO_USER_COPY;
+   return 0;
+}
+
+void
+init_profiler(void)
+{
+   struct driver_info *di;
+   int major, rc;
+
+   /* The line buffer must be able to contain the longest possible line */
+   STATIC_ASSERT(
+      PROF_MAX_FRAMES * (PROF_SYM_NAME_MAX_LEN + 1) + sizeof(" 1\n") <=
+      PROF_LINE_BUF_SZ
+   );
+
+   STATIC_ASSERT(PROF_MAX_SAMPLES <= PROF_POS_IDX_MASK);
+
+   kmutex_init(&prof_mutex, 0);
+
+   if (!(di = kzalloc_obj(struct driver_info)))
+      panic("Unable to allocate driver_info in init_profiler()");
+
+   di->name = "profiler";
+   di->create_dev_file = create_profiler_device;
+   major = register_driver(di, -1);
+
+   if ((rc = create_dev_file("profiler", (u16)major, 0 /* minor */, NULL)))
+      panic("Unable to create /dev/profiler (error: %d)", rc);
+}
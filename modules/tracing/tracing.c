@@ -7,7 +7,7 @@
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/kmalloc.h>
 #include <tilck/kernel/sync.h>
-#include <tilck/kernel/ringbuf.h>
+#include <tilck/kernel/safe_ringbuf.h>
 #include <tilck/kernel/datetime.h>
 #include <tilck/kernel/elf_utils.h>
 #include <tilck/kernel/bintree.h>
@@ -15,8 +15,11 @@
 #include <tilck/kernel/debug_utils.h>
 
 #include <tilck/mods/tracing.h>
+#include <tilck/mods/tracing_export.h>
+#include <tilck/mods/profiler.h>
 
 #define TRACE_BUF_SIZE                       (128 * KB)
+#define TRACE_WAKEUP_BATCH                           32
 
 struct symbol_node {
 
@@ -27,10 +30,20 @@ struct symbol_node {
    const char *name;
 };
 
-static struct kmutex tracing_lock;
+/*
+ * The trace events are transferred to the reader (the debug panel) through a
+ * safe_ringbuf, without any locks. Producers write with preemption disabled:
+ * that way, the reader can never observe a slot reserved by a producer but
+ * not yet written. When the buffer is full, events are dropped and counted,
+ * instead of blocking the traced task. The reader is woken up once every
+ * TRACE_WAKEUP_BATCH events: it's expected to wait with a timeout in order to
+ * pick up the last few events, when the traced task goes idle.
+ */
 static struct kcond tracing_cond;
-static struct ringbuf tracing_rb;
+static struct safe_ringbuf tracing_rb;
 static void *tracing_buf;
+static u32 tracing_unsignaled_events;
+static u32 tracing_dropped_events;
 
 static u32 syms_count;
 static struct symbol_node *syms_buf;
@@ -188,6 +201,31 @@ trace_syscall_exit_save_params(const struct syscall_info *si,
    }
 }
 
+static void
+tracing_push_event(struct trace_event *e)
+{
+   bool was_empty, signal = false;
+
+   disable_preemption();
+   {
+      if (safe_ringbuf_write_elem(&tracing_rb, e, &was_empty)) {
+
+         if (++tracing_unsignaled_events >= TRACE_WAKEUP_BATCH) {
+            tracing_unsignaled_events = 0;
+            signal = kcond_is_anyone_waiting(&tracing_cond);
+         }
+
+      } else {
+
+         tracing_dropped_events++;
+      }
+   }
+   enable_preemption();
+
+   if (signal)
+      kcond_signal_one(&tracing_cond);
+}
+
 void
 trace_syscall_enter_int(u32 sys,
                         ulong a1,
@@ -211,13 +249,7 @@ trace_syscall_enter_int(u32 sys,
    };
 
    trace_syscall_enter_save_params(si, &e);
-
-   kmutex_lock(&tracing_lock);
-   {
-      ringbuf_write_elem(&tracing_rb, &e);
-      kcond_signal_one(&tracing_cond);
-   }
-   kmutex_unlock(&tracing_lock);
+   tracing_push_event(&e);
 }
 
 void
@@ -242,38 +274,21 @@ trace_syscall_exit_int(u32 sys,
    };
 
    trace_syscall_exit_save_params(si, &e);
-
-   kmutex_lock(&tracing_lock);
-   {
-      ringbuf_write_elem(&tracing_rb, &e);
-      kcond_signal_one(&tracing_cond);
-   }
-   kmutex_unlock(&tracing_lock);
+   tracing_push_event(&e);
 }
 
 bool read_trace_event_noblock(struct trace_event *e)
 {
-   bool ret;
-   kmutex_lock(&tracing_lock);
-   {
-      ret = ringbuf_read_elem(&tracing_rb, e);
-   }
-   kmutex_unlock(&tracing_lock);
-   return ret;
+   return safe_ringbuf_read_elem(&tracing_rb, e);
 }
 
 bool read_trace_event(struct trace_event *e, u32 timeout_ticks)
 {
-   bool ret;
-   kmutex_lock(&tracing_lock);
-   {
-      if (ringbuf_is_empty(&tracing_rb))
-         kcond_wait(&tracing_cond, &tracing_lock, timeout_ticks);
+   if (safe_ringbuf_read_elem(&tracing_rb, e))
+      return true;
 
-      ret = ringbuf_read_elem(&tracing_rb, e);
-   }
-   kmutex_unlock(&tracing_lock);
-   return ret;
+   kcond_wait(&tracing_cond, NULL, timeout_ticks);
+   return safe_ringbuf_read_elem(&tracing_rb, e);
 }
 
 const struct syscall_info *
@@ -358,6 +373,32 @@ tracing_get_slot(struct trace_event *e,
    return true;
 }
 
+void
+tracing_get_slots_layout(u16 offsets[2][4], u16 sizes[2][4])
+{
+   for (int fmt = 0; fmt < 2; fmt++) {
+      for (int slot = 0; slot < 4; slot++) {
+         offsets[fmt][slot] = (u16)fmt_offsets[fmt][slot];
+         sizes[fmt][slot] = (u16)fmt_sizes[fmt][slot];
+      }
+   }
+}
+
+s8
+tracing_get_syscall_fmt(u32 sys_n)
+{
+   ASSERT(sys_n < MAX_SYSCALLS);
+   return syscalls_fmts[sys_n];
+}
+
+s8
+tracing_get_param_slot(u32 sys_n, int p_idx)
+{
+   ASSERT(sys_n < MAX_SYSCALLS);
+   ASSERT(0 <= p_idx && p_idx < 6);
+   return (*params_slots)[sys_n][p_idx];
+}
+
 static bool
 is_slot_free(u32 sys, int slot)
 {
@@ -640,13 +681,13 @@ set_traced_syscalls(const char *s)
 int
 tracing_get_in_buffer_events_count(void)
 {
-   int rc;
-   kmutex_lock(&tracing_lock);
-   {
-      rc = (int)ringbuf_get_elems(&tracing_rb); // integer narrowing
-   }
-   kmutex_unlock(&tracing_lock);
-   return rc;
+   return safe_ringbuf_get_elems(&tracing_rb);
+}
+
+u32
+tracing_get_dropped_events_count(void)
+{
+   return tracing_dropped_events;
 }
 
 static void
@@ -679,12 +720,11 @@ init_tracing(void)
    if (!(traced_syscalls_str = kmalloc(TRACED_SYSCALLS_STR_LEN)))
       tracing_init_oom_panic("traced_syscalls_str");
 
-   ringbuf_init(&tracing_rb,
-                TRACE_BUF_SIZE / sizeof(struct trace_event),
-                sizeof(struct trace_event),
-                tracing_buf);
+   safe_ringbuf_init(&tracing_rb,
+                     TRACE_BUF_SIZE / sizeof(struct trace_event),
+                     sizeof(struct trace_event),
+                     tracing_buf);
 
-   kmutex_init(&tracing_lock, 0);
    kcond_init(&tracing_cond);
 
    foreach_symbol(elf_symbol_cb, NULL);
@@ -693,6 +733,8 @@ init_tracing(void)
    tracing_allocate_slots_for_params();
 
    set_traced_syscalls("*");
+   init_tracing_export();
+   init_profiler();
 }
 
 static struct module dp_module = {
@@ -0,0 +1,242 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/fs/devfs.h>
+#include <tilck/kernel/fs/vfs.h>
+
+#include <tilck/mods/tracing.h>
+#include <tilck/mods/tracing_export.h>
+
+/*
+ * /dev/tracing: streams the trace events in the binary format described in
+ * <tilck/mods/tracing_export.h>, for offline analysis. For example, with the
+ * second serial port redirected to a file on the host:
+ *
+ *    cat /dev/tracing > /dev/ttyS1
+ *
+ * The handle's position is used to keep track of how much of the preamble
+ * (header + syscalls metadata) has been read. After that, each read() returns
+ * only whole events and blocks until at least one event is available.
+ */
+
+#if defined(__i386__)
+
+/* The layout documented in tracing_export.h */
+STATIC_ASSERT(OFFSET_OF(struct trace_event, type) == 0);
+STATIC_ASSERT(OFFSET_OF(struct trace_event, tid) == 4);
+STATIC_ASSERT(OFFSET_OF(struct trace_event, sys_time) == 8);
+STATIC_ASSERT(OFFSET_OF(struct trace_event, sys) == 16);
+STATIC_ASSERT(OFFSET_OF(struct trace_event, retval) == 20);
+STATIC_ASSERT(OFFSET_OF(struct trace_event, args) == 24);
+STATIC_ASSERT(OFFSET_OF(struct trace_event, fmt0) == 48);
+
+#endif
+
+static struct trace_export_header export_hdr;
+static u16 *exported_syscalls;
+static offt preamble_size;
+
+static void
+export_copy_str(char *dest, const char *src, size_t dest_size)
+{
+   const size_t len = MIN(strlen(src), dest_size - 1);
+
+   memcpy(dest, src, len);
+   bzero(dest + len, dest_size - len);
+}
+
+static void
+export_fill_sys_info(u32 sys_n, struct trace_export_sys_info *out)
+{
+   const struct syscall_info *si = tracing_get_syscall_info(sys_n);
+   const char *name = tracing_get_syscall_name(sys_n);
+
+   bzero(out, sizeof(*out));
+
+   out->sys_n = sys_n;
+   out->n_params = -1;
+   export_copy_str(out->name, name + 4 /* skip "sys_" */, sizeof(out->name));
+
+   if (!si)
+      return;
+
+   out->n_params = si->n_params;
+   out->exp_block = si->exp_block;
+   out->fmt = (u8)tracing_get_syscall_fmt(sys_n);
+   export_copy_str(out->ret_type, si->ret_type->name, sizeof(out->ret_type));
+
+   for (int i = 0; i < si->n_params; i++) {
+
+      const struct sys_param_info *p = &si->params[i];
+      struct trace_export_param *ep = &out->params[i];
+
+      export_copy_str(ep->name, p->name, sizeof(ep->name));
+      export_copy_str(ep->type, p->type->name, sizeof(ep->type));
+
+      ep->slot = tracing_get_param_slot(sys_n, i);
+      ep->kind = (u8)p->kind;
+      ep->helper_idx = -1;
+
+      if (p->helper_param_name)
+         ep->helper_idx = (s8)tracing_get_param_idx(si, p->helper_param_name);
+
+      if (p->real_sz_in_ret)
+         ep->flags |= TRACE_EXPORT_PFL_REAL_SZ_IN_RET;
+
+      if (p->invisible)
+         ep->flags |= TRACE_EXPORT_PFL_INVISIBLE;
+   }
+}
+
+static ssize_t
+tracing_dev_read_preamble(struct devfs_handle *dh, char *buf, size_t size)
+{
+   struct trace_export_sys_info si;
+   size_t tot = 0;
+
+   while (tot < size && dh->pos < preamble_size) {
+
+      const char *src = (const char *)&export_hdr;
+      size_t src_size = sizeof(export_hdr);
+      size_t off = (size_t)dh->pos;
+      size_t n;
+
+      if (off >= sizeof(export_hdr)) {
+
+         const size_t idx = (off - sizeof(export_hdr)) / sizeof(si);
+
+         off = (off - sizeof(export_hdr)) % sizeof(si);
+         export_fill_sys_info(exported_syscalls[idx], &si);
+         src = (const char *)&si;
+         src_size = sizeof(si);
+      }
+
+      n = MIN(src_size - off, size - tot);
+
+      if (copy_to_any_buf(buf + tot, src + off, n))
+         return tot ? (ssize_t)tot : -EFAULT;
+
+      tot += n;
+      dh->pos += (offt)n;
+   }
+
+   return (ssize_t)tot;
+}
+
+static ssize_t
+tracing_dev_read_events(struct devfs_handle *dh, char *buf, size_t size)
+{
+   const size_t es = sizeof(struct trace_event);
+   struct trace_event e;
+   size_t tot = 0;
+
+   if (size < es)
+      return -EINVAL;
+
+   while (tot + es <= size) {
+
+      if (!read_trace_event_noblock(&e)) {
+
+         if (tot)
+            break;
+
+         if (dh->fl_flags & O_NONBLOCK)
+            return -EAGAIN;
+
+         if (pending_signals())
+            return -EINTR;
+
+         if (!read_trace_event(&e, TIMER_HZ / 10))
+            continue;
+      }
+
+      if (copy_to_any_buf(buf + tot, &e, es))
+         return tot ? (ssize_t)tot : -EFAULT;
+
+      tot += es;
+   }
+
+   dh->pos += (offt)tot;
+   return (ssize_t)tot;
+}
+
+static ssize_t tracing_dev_read(fs_handle h, char *buf, size_t size)
+{
+   struct devfs_handle *dh = h;
+
+   if (dh->pos < preamble_size)
+      return tracing_dev_read_preamble(dh, buf, size);
+
+   return tracing_dev_read_events(dh, buf, size);
+}
+
+static int
+create_tracing_device(int minor,
+                      const struct file_ops **fops_ref,
+                      enum vfs_entry_type *t,
+                      int *spec_flags_ref)
+{
+   static const struct file_ops static_ops_tracing = {
+      .read = tracing_dev_read,
+   };
+
+   *t = VFS_CHAR_DEV;
+   *fops_ref = &static_ops_tracing;
+   *spec_flags_ref = VFS_SPFL_NO_USER_COPY;
+   return 0;
+}
+
+static void
+init_export_header(u32 count)
+{
+   memcpy(export_hdr.magic, TRACE_EXPORT_MAGIC, sizeof(export_hdr.magic));
+   export_hdr.version = TRACE_EXPORT_VERSION;
+   export_hdr.header_size = sizeof(struct trace_export_header);
+   export_hdr.sys_info_size = sizeof(struct trace_export_sys_info);
+   export_hdr.sys_info_count = count;
+   export_hdr.event_size = sizeof(struct trace_event);
+   export_hdr.word_size = sizeof(ulong);
+   tracing_get_slots_layout(export_hdr.slot_offsets, export_hdr.slot_sizes);
+
+   preamble_size =
+      (offt)(sizeof(export_hdr) + count * sizeof(struct trace_export_sys_info));
+}
+
+void
+init_tracing_export(void)
+{
+   struct driver_info *di;
+   u32 count = 0;
+   int major, rc;
+
+   for (u32 i = 0; i < MAX_SYSCALLS; i++)
+      if (tracing_get_syscall_name(i))
+         count++;
+
+   if (!(exported_syscalls = kalloc_array_obj(u16, count)))
+      panic("Unable to allocate exported_syscalls in init_tracing_export()");
+
+   for (u32 i = 0, j = 0; i < MAX_SYSCALLS; i++)
+      if (tracing_get_syscall_name(i))
+         exported_syscalls[j++] = (u16)i;
+
+   init_export_header(count);
+
+   if (!(di = kzalloc_obj(struct driver_info)))
+      panic("Unable to allocate driver_info in init_tracing_export()");
+
+   di->name = "tracing";
+   di->create_dev_file = create_tracing_device;
+   major = register_driver(di, -1);
+
+   if ((rc = create_dev_file("tracing", (u16)major, 0 /* minor */, NULL)))
+      panic("Unable to create /dev/tracing (error: %d)", rc);
+}
@@ -49,6 +49,52 @@ static void kmalloc_perf_per_size(u32 size)
           size, duration / (u64) iters);
 }
 
+static u64 kmem_cache_perf_run(struct kmem_cache *c, u32 size, int iters)
+{
+   u64 start = RDTSC();
+
+   for (int i = 0; i < iters; i++) {
+
+      allocations[i] = c ? kmem_cache_alloc(c) : kmalloc(size);
+
+      if (!allocations[i])
+         panic("We were unable to allocate %u bytes\n", size);
+   }
+
+   for (int i = 0; i < iters; i++) {
+
+      if (c)
+         kmem_cache_free(c, allocations[i]);
+      else
+         kfree2(allocations[i], size);
+   }
+
+   return (RDTSC() - start) / (u64)iters;
+}
+
+static void kmem_cache_perf_per_size(u32 size)
+{
+   const int iters = 10000;
+   struct kmem_cache c;
+   u64 kmalloc_cycles, cache_cycles;
+
+   kmem_cache_create(&c, "perf_test", size);
+
+   /* Run each test twice, in order to measure also the "warm" case */
+   kmem_cache_perf_run(&c, size, iters);
+   cache_cycles = kmem_cache_perf_run(&c, size, iters);
+
+   kmem_cache_perf_run(NULL, size, iters);
+   kmalloc_cycles = kmem_cache_perf_run(NULL, size, iters);
+
+   kmem_cache_destroy(&c);
+
+   kmalloc_perf_print_iters(iters);
+   printk(NO_PREFIX "Cycles per alloc(%4u) + free: "
+          "kmem_cache: %4" PRIu64 ", kmalloc: %4" PRIu64 "\n",
+          size, cache_cycles, kmalloc_cycles);
+}
+
 void selftest_kmalloc_perf_med(void)
 {
    const int iters = 1000;
@@ -86,6 +132,13 @@ void selftest_kmalloc_perf_med(void)
       kmalloc_perf_per_size(s);
    }
 
+   printk("*** kmem_cache vs kmalloc perf test ***\n");
+
+   for (u32 s = 16; s <= 1024; s *= 2) {
+      kmem_cache_perf_per_size(s - s / 4);
+      kmem_cache_perf_per_size(s);
+   }
+
    kfree_array_obj(allocations, void *, 10000);
    regular_self_test_end();
 }
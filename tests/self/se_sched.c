@@ -0,0 +1,97 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/utils.h>
+
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/debug_utils.h>
+#include <tilck/kernel/self_tests.h>
+
+#define SE_SCHED_MAX_THREADS        256
+#define SE_SCHED_TOT_YIELDS   (32 * 1024)
+
+static int se_sched_tids[SE_SCHED_MAX_THREADS];
+static struct kmutex se_sched_mutex;
+static struct kcond se_sched_cond;
+static volatile int se_sched_ready;
+static volatile bool se_sched_go;
+static u32 se_sched_iters;
+
+static void sched_perf_thread(void *unused)
+{
+   kmutex_lock(&se_sched_mutex);
+   {
+      se_sched_ready++;
+
+      while (!se_sched_go)
+         kcond_wait(&se_sched_cond, &se_sched_mutex, KCOND_WAIT_FOREVER);
+   }
+   kmutex_unlock(&se_sched_mutex);
+
+   /* Busy task: just keep yielding, forcing a context switch each time */
+   for (u32 i = 0; i < se_sched_iters; i++)
+      kernel_yield();
+}
+
+static void do_sched_perf_test(int n)
+{
+   u64 start, duration;
+
+   se_sched_ready = 0;
+   se_sched_go = false;
+   se_sched_iters = SE_SCHED_TOT_YIELDS / (u32)n;
+
+   for (int i = 0; i < n; i++) {
+
+      se_sched_tids[i] = kthread_create(&sched_perf_thread, 0, NULL);
+
+      if (se_sched_tids[i] < 0)
+         panic("[se_sched] Unable to create kthread #%d", i);
+   }
+
+   /* Wait for all the threads to block on the condition */
+   while (se_sched_ready < n)
+      kernel_sleep(1);
+
+   kmutex_lock(&se_sched_mutex);
+   {
+      se_sched_go = true;
+      start = RDTSC();
+      kcond_signal_all(&se_sched_cond);
+   }
+   kmutex_unlock(&se_sched_mutex);
+
+   kthread_join_all(se_sched_tids, (size_t)n);
+   duration = RDTSC() - start;
+
+   printk("    %3d     | %10" PRIu64 "\n",
+          n, duration / ((u64)se_sched_iters * (u64)n));
+}
+
+void selftest_sched_perf_med(void)
+{
+   static const int threads_count[] = { 4, 32, SE_SCHED_MAX_THREADS };
+
+   kmutex_init(&se_sched_mutex, 0);
+   kcond_init(&se_sched_cond);
+
+   printk("\n");
+   printk("Context switch latency (kernel_yield) with N busy tasks\n");
+   printk("\n");
+   printk("  threads   | cycles/switch\n");
+   printk("------------+---------------\n");
+
+   for (int i = 0; i < ARRAY_SIZE(threads_count); i++)
+      do_sched_perf_test(threads_count[i]);
+
+   printk("\n");
+
+   kcond_destory(&se_sched_cond);
+   kmutex_destroy(&se_sched_mutex);
+   regular_self_test_end();
+}
+
+DECLARE_AND_REGISTER_SELF_TEST(sched_perf, se_med, &selftest_sched_perf_med)
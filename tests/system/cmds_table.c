@@ -17,6 +17,7 @@ DECL_CMD(bad_read);
 DECL_CMD(bad_write);
 DECL_CMD(fork_perf);
 DECL_CMD(vfork_perf);
+DECL_CMD(fork_exec_perf);
 DECL_CMD(syscall_perf);
 DECL_CMD(fpu);
 DECL_CMD(fpu_loop);
@@ -43,6 +44,12 @@ DECL_CMD(select4);
 DECL_CMD(poll1);
 DECL_CMD(poll2);
 DECL_CMD(poll3);
+DECL_CMD(epoll1);
+DECL_CMD(epoll2);
+DECL_CMD(eventfd1);
+DECL_CMD(timerfd1);
+DECL_CMD(futex1);
+DECL_CMD(vdso1);
 DECL_CMD(bigargv);
 DECL_CMD(cloexec);
 DECL_CMD(fs1);
@@ -52,6 +59,10 @@ DECL_CMD(fs4);
 DECL_CMD(fs5);
 DECL_CMD(fs6);
 DECL_CMD(fs7);
+DECL_CMD(fs8);
+DECL_CMD(fs9);
+DECL_CMD(fs10);
+DECL_CMD(fs11);
 DECL_CMD(fmmap1);
 DECL_CMD(fmmap2);
 DECL_CMD(fmmap3);
@@ -61,10 +72,13 @@ DECL_CMD(fmmap6);
 DECL_CMD(fmmap7);
 DECL_CMD(fs_perf1);
 DECL_CMD(fs_perf2);
+DECL_CMD(fs_perf3);
 DECL_CMD(pipe1);
 DECL_CMD(pipe2);
 DECL_CMD(pipe3);
 DECL_CMD(pipe4);
+DECL_CMD(pipe5);
+DECL_CMD(pipe6);
 DECL_CMD(pollerr);
 DECL_CMD(pollhup);
 DECL_CMD(execve0);
@@ -87,6 +101,7 @@ static struct test_cmd_entry _cmds_table[] =
    CMD_ENTRY(bad_write,    TT_SHORT,  true),
    CMD_ENTRY(fork_perf,    TT_LONG,   true),
    CMD_ENTRY(vfork_perf,   TT_LONG,   true),
+   CMD_ENTRY(fork_exec_perf, TT_LONG, true),
    CMD_ENTRY(syscall_perf, TT_SHORT,  true),
    CMD_ENTRY(fpu,          TT_SHORT,  true),
    CMD_ENTRY(fpu_loop,     TT_LONG,  false),
@@ -115,8 +130,13 @@ static struct test_cmd_entry _cmds_table[] =
    CMD_ENTRY(fs5,          TT_SHORT,  true),
    CMD_ENTRY(fs6,          TT_SHORT,  true),
    CMD_ENTRY(fs7,          TT_SHORT,  true),
+   CMD_ENTRY(fs8,          TT_SHORT,  true),
+   CMD_ENTRY(fs9,          TT_SHORT,  true),
+   CMD_ENTRY(fs10,         TT_SHORT,  true),
+   CMD_ENTRY(fs11,         TT_SHORT,  true),
    CMD_ENTRY(fs_perf1,     TT_SHORT,  true),
    CMD_ENTRY(fs_perf2,     TT_SHORT,  true),
+   CMD_ENTRY(fs_perf3,     TT_SHORT,  true),
    CMD_ENTRY(fmmap1,       TT_SHORT,  true),
    CMD_ENTRY(fmmap2,       TT_SHORT,  true),
    CMD_ENTRY(fmmap3,       TT_SHORT,  true),
@@ -128,11 +148,19 @@ static struct test_cmd_entry _cmds_table[] =
    CMD_ENTRY(pipe2,        TT_SHORT,  true),
    CMD_ENTRY(pipe3,        TT_SHORT,  true),
    CMD_ENTRY(pipe4,        TT_SHORT,  true),
+   CMD_ENTRY(pipe5,        TT_SHORT,  true),
+   CMD_ENTRY(pipe6,        TT_SHORT,  true),
    CMD_ENTRY(pollerr,      TT_SHORT,  true),
    CMD_ENTRY(pollhup,      TT_SHORT,  true),
    CMD_ENTRY(poll1,        TT_SHORT,  true),
    CMD_ENTRY(poll2,        TT_SHORT,  true),
    CMD_ENTRY(poll3,        TT_SHORT,  true),
+   CMD_ENTRY(epoll1,       TT_SHORT,  true),
+   CMD_ENTRY(epoll2,       TT_SHORT,  true),
+   CMD_ENTRY(eventfd1,     TT_SHORT,  true),
+   CMD_ENTRY(timerfd1,     TT_SHORT,  true),
+   CMD_ENTRY(futex1,       TT_SHORT,  true),
+   CMD_ENTRY(vdso1,        TT_SHORT,  true),
    CMD_ENTRY(select1,      TT_SHORT,  true),
    CMD_ENTRY(select2,      TT_SHORT,  true),
    CMD_ENTRY(select3,      TT_SHORT,  true),
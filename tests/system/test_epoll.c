@@ -0,0 +1,216 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/epoll.h>
+
+#include "devshell.h"
+
+/* epoll on a pipe: level-triggered, edge-triggered and one-shot modes */
+int cmd_epoll1(int argc, char **argv)
+{
+   struct epoll_event ev, evs[4];
+   int pipefd[2];
+   int epfd, fd, rc;
+   char buf[16];
+
+   rc = pipe(pipefd);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   epfd = epoll_create1(EPOLL_CLOEXEC);
+   DEVSHELL_CMD_ASSERT(epfd > 0);
+
+   ev = (struct epoll_event) { .events = EPOLLIN, .data.u32 = 1234 };
+   rc = epoll_ctl(epfd, EPOLL_CTL_ADD, pipefd[0], &ev);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = epoll_ctl(epfd, EPOLL_CTL_ADD, pipefd[0], &ev);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EEXIST);
+
+   /* Nothing to read yet: just the timeout */
+   rc = epoll_wait(epfd, evs, 4, 50);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = write(pipefd[1], "abcd", 4);
+   DEVSHELL_CMD_ASSERT(rc == 4);
+
+   /* Level-triggered: reported until the data is consumed */
+   for (int i = 0; i < 2; i++) {
+      rc = epoll_wait(epfd, evs, 4, 0);
+      DEVSHELL_CMD_ASSERT(rc == 1);
+      DEVSHELL_CMD_ASSERT(evs[0].events == EPOLLIN);
+      DEVSHELL_CMD_ASSERT(evs[0].data.u32 == 1234);
+   }
+
+   rc = read(pipefd[0], buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == 4);
+
+   rc = epoll_wait(epfd, evs, 4, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   /* Edge-triggered: reported once per write */
+   ev = (struct epoll_event) { .events = EPOLLIN | EPOLLET, .data.u32 = 5 };
+   rc = epoll_ctl(epfd, EPOLL_CTL_MOD, pipefd[0], &ev);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = write(pipefd[1], "ab", 2);
+   DEVSHELL_CMD_ASSERT(rc == 2);
+
+   rc = epoll_wait(epfd, evs, 4, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(evs[0].data.u32 == 5);
+
+   rc = epoll_wait(epfd, evs, 4, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = write(pipefd[1], "cd", 2);
+   DEVSHELL_CMD_ASSERT(rc == 2);
+
+   rc = epoll_wait(epfd, evs, 4, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+
+   /* One-shot: disabled after the first event, until re-armed */
+   ev = (struct epoll_event) { .events = EPOLLIN | EPOLLONESHOT };
+   rc = epoll_ctl(epfd, EPOLL_CTL_MOD, pipefd[0], &ev);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = epoll_wait(epfd, evs, 4, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+
+   rc = write(pipefd[1], "ef", 2);
+   DEVSHELL_CMD_ASSERT(rc == 2);
+
+   rc = epoll_wait(epfd, evs, 4, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = epoll_ctl(epfd, EPOLL_CTL_MOD, pipefd[0], &ev);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = epoll_wait(epfd, evs, 4, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+
+   /* Write end: always writable, and EPOLLHUP after closing it */
+   ev = (struct epoll_event) { .events = EPOLLOUT, .data.u32 = 2 };
+   rc = epoll_ctl(epfd, EPOLL_CTL_ADD, pipefd[1], &ev);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   ev = (struct epoll_event) { .events = EPOLLIN, .data.u32 = 1 };
+   rc = epoll_ctl(epfd, EPOLL_CTL_MOD, pipefd[0], &ev);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = read(pipefd[0], buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == 6);
+
+   rc = epoll_wait(epfd, evs, 4, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(evs[0].data.u32 == 2);
+   DEVSHELL_CMD_ASSERT(evs[0].events == EPOLLOUT);
+
+   /* Closing a fd removes it from the epoll set */
+   close(pipefd[1]);
+
+   rc = epoll_wait(epfd, evs, 4, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(evs[0].data.u32 == 1);
+   DEVSHELL_CMD_ASSERT(evs[0].events & EPOLLHUP);
+
+   rc = epoll_ctl(epfd, EPOLL_CTL_DEL, pipefd[0], NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = epoll_ctl(epfd, EPOLL_CTL_DEL, pipefd[0], NULL);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == ENOENT);
+
+   rc = epoll_wait(epfd, evs, 4, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   /* Error cases */
+   fd = open("/tmp/test_epoll1", O_RDWR | O_CREAT | O_TRUNC, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   rc = epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EPERM);
+
+   rc = epoll_ctl(fd, EPOLL_CTL_ADD, pipefd[0], &ev);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   rc = epoll_ctl(epfd, EPOLL_CTL_ADD, epfd, &ev);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   rc = epoll_wait(epfd, evs, 0, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   rc = epoll_create(0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   close(fd);
+   rc = unlink("/tmp/test_epoll1");
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   close(pipefd[0]);
+   close(epfd);
+   return 0;
+}
+
+/* Block in epoll_wait() until a child process writes on a pipe */
+int cmd_epoll2(int argc, char **argv)
+{
+   struct epoll_event ev, evs[2];
+   int pipefds[2][2];
+   int epfd, rc, wstatus;
+   char buf[16];
+   pid_t childpid;
+
+   epfd = epoll_create(1);
+   DEVSHELL_CMD_ASSERT(epfd > 0);
+
+   for (int i = 0; i < 2; i++) {
+
+      rc = pipe(pipefds[i]);
+      DEVSHELL_CMD_ASSERT(rc == 0);
+
+      ev = (struct epoll_event) { .events = EPOLLIN, .data.fd = i };
+      rc = epoll_ctl(epfd, EPOLL_CTL_ADD, pipefds[i][0], &ev);
+      DEVSHELL_CMD_ASSERT(rc == 0);
+   }
+
+   childpid = fork();
+   DEVSHELL_CMD_ASSERT(childpid >= 0);
+
+   if (!childpid) {
+
+      usleep(100 * 1000);
+      rc = write(pipefds[1][1], "hello", 5);
+      exit(rc == 5 ? 0 : 1);
+   }
+
+   do {
+      rc = epoll_wait(epfd, evs, 2, 3000 /* ms */);
+   } while (rc < 0 && errno == EINTR);
+
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(evs[0].data.fd == 1);
+   DEVSHELL_CMD_ASSERT(evs[0].events == EPOLLIN);
+
+   rc = read(pipefds[1][0], buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == 5);
+
+   rc = waitpid(childpid, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == childpid);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+
+   for (int i = 0; i < 2; i++) {
+      close(pipefds[i][0]);
+      close(pipefds[i][1]);
+   }
+
+   close(epfd);
+   return 0;
+}
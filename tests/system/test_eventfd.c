@@ -0,0 +1,193 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "devshell.h"
+
+/* eventfd: counter semantics, semaphore mode and poll() integration */
+int cmd_eventfd1(int argc, char **argv)
+{
+   struct pollfd pfd;
+   uint64_t val;
+   pid_t childpid;
+   int fd, rc, wstatus;
+
+   fd = eventfd(3, EFD_NONBLOCK);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   val = 4;
+   rc = write(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+   DEVSHELL_CMD_ASSERT(val == 7);
+
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   rc = read(fd, &val, 4);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   val = UINT64_MAX;
+   rc = write(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   /* Counter overflow: EAGAIN in non-blocking mode */
+   val = UINT64_MAX - 1;
+   rc = write(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+
+   val = 1;
+   rc = write(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   close(fd);
+
+   /* Semaphore mode: each read() returns 1 */
+   fd = eventfd(2, EFD_SEMAPHORE | EFD_NONBLOCK);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   for (int i = 0; i < 2; i++) {
+      rc = read(fd, &val, sizeof(val));
+      DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+      DEVSHELL_CMD_ASSERT(val == 1);
+   }
+
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+   close(fd);
+
+   /* Wake-up from another process, through poll() */
+   fd = eventfd(0, 0);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   childpid = fork();
+   DEVSHELL_CMD_ASSERT(childpid >= 0);
+
+   if (!childpid) {
+      val = 42;
+      usleep(50 * 1000);
+      rc = write(fd, &val, sizeof(val));
+      exit(rc == sizeof(val) ? 0 : 1);
+   }
+
+   pfd = (struct pollfd) { .fd = fd, .events = POLLIN };
+
+   do {
+      rc = poll(&pfd, 1, 3000 /* ms */);
+   } while (rc < 0 && errno == EINTR);
+
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(pfd.revents & POLLIN);
+
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+   DEVSHELL_CMD_ASSERT(val == 42);
+
+   rc = waitpid(childpid, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == childpid);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+
+   close(fd);
+   return 0;
+}
+
+/* timerfd: one-shot and periodic timers, poll() integration */
+int cmd_timerfd1(int argc, char **argv)
+{
+   struct itimerspec its, old;
+   struct timespec now;
+   struct pollfd pfd;
+   uint64_t val;
+   int fd, rc;
+
+   fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   /* Not armed yet */
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   rc = timerfd_gettime(fd, &its);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(!its.it_value.tv_sec && !its.it_value.tv_nsec);
+
+   /* One-shot timer, 50 ms */
+   its = (struct itimerspec) { .it_value = { 0, 50 * 1000 * 1000 } };
+   rc = timerfd_settime(fd, 0, &its, NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   pfd = (struct pollfd) { .fd = fd, .events = POLLIN };
+   rc = poll(&pfd, 1, 3000 /* ms */);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(pfd.revents & POLLIN);
+
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+   DEVSHELL_CMD_ASSERT(val == 1);
+
+   /* Periodic timer, every 20 ms */
+   its = (struct itimerspec) {
+      .it_value = { 0, 20 * 1000 * 1000 },
+      .it_interval = { 0, 20 * 1000 * 1000 },
+   };
+
+   rc = timerfd_settime(fd, 0, &its, NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   usleep(100 * 1000);
+
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+   DEVSHELL_CMD_ASSERT(val >= 3);
+
+   rc = timerfd_gettime(fd, &its);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(its.it_interval.tv_nsec == 20 * 1000 * 1000);
+
+   /* Disarm it */
+   its = (struct itimerspec) { 0 };
+   rc = timerfd_settime(fd, 0, &its, &old);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(old.it_interval.tv_nsec == 20 * 1000 * 1000);
+
+   rc = poll(&pfd, 1, 100 /* ms */);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   /* Absolute time in the past: expires immediately */
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   its = (struct itimerspec) { .it_value = { now.tv_sec - 1, 0 } };
+   rc = timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = poll(&pfd, 1, 3000 /* ms */);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+
+   /* Error cases */
+   its = (struct itimerspec) { .it_value = { 0, 1000 * 1000 * 1000 } };
+   rc = timerfd_settime(fd, 0, &its, NULL);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   rc = timerfd_settime(0, 0, &its, NULL);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   rc = timerfd_create(CLOCK_PROCESS_CPUTIME_ID, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   close(fd);
+   return 0;
+}
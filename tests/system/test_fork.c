@@ -136,6 +136,77 @@ int cmd_vfork_perf(int argc, char **argv)
    return do_fork_perf(&vfork);
 }
 
+/*
+ * Measure the cost of fork() + execve() + exit() + waitpid() when the parent
+ * has a non-trivial address space: that's the typical case of a shell running
+ * commands, where the child replaces its whole address space immediately.
+ * The child runs this same command with --child, which does nothing.
+ */
+int cmd_fork_exec_perf(int argc, char **argv)
+{
+   const int iters = 500;
+   const size_t mem_size = 16 * MB;
+   const char *devshell_path = get_devshell_path();
+   int rc, wstatus, child_pid;
+   ull_t start, duration;
+   char *mem;
+
+   if (argc >= 1 && !strcmp(argv[0], "--child"))
+      return 0;
+
+   mem = mmap(NULL,
+              mem_size,
+              PROT_READ | PROT_WRITE,
+              MAP_ANONYMOUS | MAP_PRIVATE,
+              -1,
+              0);
+
+   if (mem == (void *)-1) {
+      perror("mmap() failed");
+      return 1;
+   }
+
+   /* Touch all the pages, in order to have them all actually mapped */
+   for (size_t i = 0; i < mem_size; i += 4 * KB)
+      mem[i] = 1;
+
+   start = RDTSC();
+
+   for (int i = 0; i < iters; i++) {
+
+      child_pid = fork();
+
+      if (child_pid < 0) {
+         perror("fork() failed");
+         return 1;
+      }
+
+      if (!child_pid) {
+         close(1); /* Suppress devshell's output */
+         execl(devshell_path, "devshell", "-c", "fork_exec_perf", "--child",
+               NULL);
+         _exit(123);
+      }
+
+      rc = waitpid(child_pid, &wstatus, 0);
+
+      if (rc != child_pid) {
+         printf("waitpid() returned %d [expected: %d]\n", rc, child_pid);
+         return 1;
+      }
+
+      if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0) {
+         printf("The child failed. wstatus: %d\n", wstatus);
+         return 1;
+      }
+   }
+
+   duration = RDTSC() - start;
+   printf("duration: %llu\n", duration/iters);
+   munmap(mem, mem_size);
+   return 0;
+}
+
 int cmd_execve0(int argc, char **argv)
 {
    int rc, pid, wstatus;
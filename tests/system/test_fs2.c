@@ -14,6 +14,8 @@
 #include <sys/syscall.h>
 #include <sys/mman.h>
 #include <sys/time.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
 #include <dirent.h>
 
 #include "devshell.h"
@@ -40,6 +42,295 @@ int cmd_fs7(int argc, char **argv)
    return 0;
 }
 
+/* Test read() and write() with bad or partially bad user buffers */
+int cmd_fs8(int argc, char **argv)
+{
+   const size_t page_size = (size_t)getpagesize();
+   char *buf;
+   int fd, rc;
+
+   fd = open("/tmp/test_fs8", O_RDWR | O_CREAT, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   buf = mmap(NULL, 2 * page_size, PROT_READ | PROT_WRITE,
+              MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+
+   DEVSHELL_CMD_ASSERT(buf != (void *)-1);
+   memset(buf, 'x', page_size);
+
+   for (int i = 0; i < 2; i++) {
+      rc = write(fd, buf, page_size);
+      DEVSHELL_CMD_ASSERT(rc == (int)page_size);
+   }
+
+   /* Make the 2nd page of the buffer inaccessible */
+   rc = munmap(buf + page_size, page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   /* Reading into a completely bad buffer must fail with EFAULT */
+   lseek(fd, 0, SEEK_SET);
+   errno = 0;
+   rc = read(fd, buf + page_size, 16);
+   DEVSHELL_CMD_ASSERT(rc == -1 && errno == EFAULT);
+
+   errno = 0;
+   rc = read(fd, (void *)0xC0000000, 16);
+   DEVSHELL_CMD_ASSERT(rc == -1 && errno == EFAULT);
+
+   errno = 0;
+   rc = write(fd, buf + page_size, 16);
+   DEVSHELL_CMD_ASSERT(rc == -1 && errno == EFAULT);
+
+   /* The file position must not have changed */
+   rc = (int)lseek(fd, 0, SEEK_CUR);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   /* Reading into a partially bad buffer must return a short count */
+   rc = (int)lseek(fd, (off_t)page_size - 100, SEEK_SET);
+   DEVSHELL_CMD_ASSERT(rc == (int)page_size - 100);
+
+   rc = read(fd, buf + page_size - 100, 300);
+   DEVSHELL_CMD_ASSERT(rc == 100);
+
+   rc = munmap(buf, page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   close(fd);
+   rc = unlink("/tmp/test_fs8");
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
+
+/* Test sendfile() with a pipe and with a regular file as destinations */
+int cmd_fs9(int argc, char **argv)
+{
+   static char buf[3 * 4096];
+   static char buf2[3 * 4096];
+   const int size = (int)sizeof(buf);
+   int fd, fd2, rc;
+   int pipefd[2];
+   char tmp[128];
+   off_t off;
+
+   for (int i = 0; i < size; i++)
+      buf[i] = (char)('a' + i % 26);
+
+   fd = open("/tmp/test_fs9", O_RDWR | O_CREAT, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+   rc = write(fd, buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == size);
+
+   /* File to pipe, using the file position */
+   rc = pipe(pipefd);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = (int)lseek(fd, 10, SEEK_SET);
+   DEVSHELL_CMD_ASSERT(rc == 10);
+
+   rc = sendfile(pipefd[1], fd, NULL, 100);
+   DEVSHELL_CMD_ASSERT(rc == 100);
+
+   rc = (int)lseek(fd, 0, SEEK_CUR);
+   DEVSHELL_CMD_ASSERT(rc == 110);
+
+   rc = read(pipefd[0], tmp, sizeof(tmp));
+   DEVSHELL_CMD_ASSERT(rc == 100);
+   DEVSHELL_CMD_ASSERT(!memcmp(tmp, buf + 10, 100));
+
+   /* File to file, using an explicit offset, across page boundaries */
+   fd2 = open("/tmp/test_fs9_2", O_RDWR | O_CREAT | O_TRUNC, 0644);
+   DEVSHELL_CMD_ASSERT(fd2 > 0);
+
+   off = 4000;
+   rc = sendfile(fd2, fd, &off, (size_t)size);
+   DEVSHELL_CMD_ASSERT(rc == size - 4000);
+   DEVSHELL_CMD_ASSERT(off == size);
+
+   /* The file position of `fd` must not have changed */
+   rc = (int)lseek(fd, 0, SEEK_CUR);
+   DEVSHELL_CMD_ASSERT(rc == 110);
+
+   /* Sending past the end of the file must return 0 */
+   rc = sendfile(fd2, fd, &off, 10);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = (int)lseek(fd2, 0, SEEK_SET);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = read(fd2, buf2, sizeof(buf2));
+   DEVSHELL_CMD_ASSERT(rc == size - 4000);
+   DEVSHELL_CMD_ASSERT(!memcmp(buf2, buf + 4000, (size_t)rc));
+
+   close(pipefd[0]);
+   close(pipefd[1]);
+   close(fd2);
+   close(fd);
+
+   rc = unlink("/tmp/test_fs9_2");
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   rc = unlink("/tmp/test_fs9");
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
+
+/* Test pread(), pwrite(), preadv() and pwritev() */
+int cmd_fs10(int argc, char **argv)
+{
+   char buf[64];
+   char a[8], b[8];
+   struct iovec iov[2];
+   int fd, fd2, rc;
+   int pipefd[2];
+
+   fd = open("/tmp/test_fs10", O_RDWR | O_CREAT | O_TRUNC, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   rc = write(fd, "0123456789", 10);
+   DEVSHELL_CMD_ASSERT(rc == 10);
+
+   /* Positional writes, also past EOF, must not move the file position */
+   rc = pwrite(fd, "abc", 3, 2);
+   DEVSHELL_CMD_ASSERT(rc == 3);
+
+   rc = pwrite(fd, "XY", 2, 5000);
+   DEVSHELL_CMD_ASSERT(rc == 2);
+
+   rc = (int)lseek(fd, 0, SEEK_CUR);
+   DEVSHELL_CMD_ASSERT(rc == 10);
+
+   rc = pread(fd, buf, 10, 0);
+   DEVSHELL_CMD_ASSERT(rc == 10);
+   DEVSHELL_CMD_ASSERT(!memcmp(buf, "01abc56789", 10));
+
+   rc = pread(fd, buf, sizeof(buf), 4998);
+   DEVSHELL_CMD_ASSERT(rc == 4);
+   DEVSHELL_CMD_ASSERT(!memcmp(buf, "\0\0XY", 4));
+
+   rc = pread(fd, buf, sizeof(buf), 6000);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = pread(fd, buf, sizeof(buf), -1);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   /* Vectored variants */
+   iov[0] = (struct iovec) { .iov_base = "ABCD", .iov_len = 4 };
+   iov[1] = (struct iovec) { .iov_base = "EFGH", .iov_len = 4 };
+
+   rc = pwritev(fd, iov, 2, 100);
+   DEVSHELL_CMD_ASSERT(rc == 8);
+
+   iov[0] = (struct iovec) { .iov_base = a, .iov_len = 3 };
+   iov[1] = (struct iovec) { .iov_base = b, .iov_len = 5 };
+
+   rc = preadv(fd, iov, 2, 100);
+   DEVSHELL_CMD_ASSERT(rc == 8);
+   DEVSHELL_CMD_ASSERT(!memcmp(a, "ABC", 3));
+   DEVSHELL_CMD_ASSERT(!memcmp(b, "DEFGH", 5));
+
+   rc = (int)lseek(fd, 0, SEEK_CUR);
+   DEVSHELL_CMD_ASSERT(rc == 10);
+
+   /* Positional reads on the read-only FAT file system of the initrd */
+   fd2 = open("/initrd/etc/passwd", O_RDONLY);
+   DEVSHELL_CMD_ASSERT(fd2 > 0);
+
+   rc = read(fd2, buf, 5);
+   DEVSHELL_CMD_ASSERT(rc == 5);
+   DEVSHELL_CMD_ASSERT(!memcmp(buf, "root:", 5));
+
+   rc = pread(fd2, buf, 3, 7);
+   DEVSHELL_CMD_ASSERT(rc == 3);
+   DEVSHELL_CMD_ASSERT(!memcmp(buf, "0:0", 3));
+
+   rc = pread(fd2, buf, sizeof(buf), 100000);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = (int)lseek(fd2, 0, SEEK_CUR);
+   DEVSHELL_CMD_ASSERT(rc == 5);
+
+   rc = read(fd2, buf, 2);
+   DEVSHELL_CMD_ASSERT(rc == 2);
+   DEVSHELL_CMD_ASSERT(!memcmp(buf, "x:", 2));
+
+   rc = pwrite(fd2, "x", 1, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EBADF);
+   close(fd2);
+
+   /* Pipes are not seekable */
+   rc = pipe(pipefd);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = pwrite(pipefd[1], "x", 1, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == ESPIPE);
+
+   rc = pread(pipefd[0], buf, 1, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == ESPIPE);
+
+   close(pipefd[0]);
+   close(pipefd[1]);
+   close(fd);
+
+   rc = unlink("/tmp/test_fs10");
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
+
+/*
+ * Test that a write from a partly unmapped buffer, failing past EOF, doesn't
+ * leave any data in the file: extending the file must expose only zeros.
+ */
+int cmd_fs11(int argc, char **argv)
+{
+   const size_t page_size = getpagesize();
+   char rbuf[64];
+   char *buf;
+   int fd, rc, written;
+
+   buf = mmap(NULL,
+              2 * page_size,
+              PROT_READ | PROT_WRITE,
+              MAP_ANONYMOUS | MAP_PRIVATE,
+              -1,
+              0);
+
+   DEVSHELL_CMD_ASSERT(buf != (void *)-1);
+   memset(buf, 'A', 2 * page_size);
+
+   rc = munmap(buf + page_size, page_size);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   fd = open("/tmp/test_fs11", O_RDWR | O_CREAT | O_TRUNC, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   rc = write(fd, "0123", 4);
+   DEVSHELL_CMD_ASSERT(rc == 4);
+
+   /* Only the first 16 bytes of the source buffer are mapped */
+   rc = write(fd, buf + page_size - 16, 32);
+   DEVSHELL_CMD_ASSERT((rc < 0 && errno == EFAULT) || (rc >= 0 && rc <= 16));
+   written = rc > 0 ? rc : 0;
+
+   rc = ftruncate(fd, sizeof(rbuf));
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = pread(fd, rbuf, sizeof(rbuf), 0);
+   DEVSHELL_CMD_ASSERT(rc == sizeof(rbuf));
+   DEVSHELL_CMD_ASSERT(!memcmp(rbuf, "0123", 4));
+
+   for (int i = 4; i < 4 + written; i++)
+      DEVSHELL_CMD_ASSERT(rbuf[i] == 'A');
+
+   for (int i = 4 + written; i < (int)sizeof(rbuf); i++)
+      DEVSHELL_CMD_ASSERT(rbuf[i] == 0);
+
+   close(fd);
+   munmap(buf, page_size);
+
+   rc = unlink("/tmp/test_fs11");
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
+
 static const char test_str[] = "this is a test string\n";
 static const char test_str2[] = "hello from the 2nd page";
 static const char test_str_exp[] = "This is a test string\n";
@@ -109,3 +109,50 @@ int cmd_fs_perf2(int argc, char **argv)
    DEVSHELL_CMD_ASSERT(rc == 0);
    return 0;
 }
+
+/* Measure the cost of big reads and writes, done with a single syscall */
+int cmd_fs_perf3(int argc, char **argv)
+{
+   const size_t size = 4 * MB;
+   char path[256];
+   char *buf;
+   int fd, rc;
+   u64 start, end;
+   const char *dest_dir = argc > 0 ? argv[0] : "/tmp";
+
+   printf("Using '%s' as test dir\n", dest_dir);
+
+   buf = malloc(size);
+   DEVSHELL_CMD_ASSERT(buf != NULL);
+   memset(buf, 'a', size);
+
+   sprintf(path, "%s/test_file", dest_dir);
+   fd = open(path, O_RDWR | O_CREAT, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   start = RDTSC();
+   rc = write(fd, buf, size);
+   end = RDTSC();
+
+   DEVSHELL_CMD_ASSERT(rc == (int)size);
+   printf("write(): avg. cost per KB: %4llu cycles\n", (end - start) / KB);
+
+   rc = (int)lseek(fd, 0, SEEK_SET);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   memset(buf, 0, size);
+
+   start = RDTSC();
+   rc = read(fd, buf, size);
+   end = RDTSC();
+
+   DEVSHELL_CMD_ASSERT(rc == (int)size);
+   DEVSHELL_CMD_ASSERT(buf[0] == 'a' && buf[size - 1] == 'a');
+   printf("read():  avg. cost per KB: %4llu cycles\n", (end - start) / KB);
+
+   close(fd);
+   free(buf);
+
+   rc = unlink(path);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
@@ -0,0 +1,149 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <linux/futex.h>
+
+#include "devshell.h"
+
+static long
+futex(volatile uint32_t *uaddr, int op, uint32_t val,
+      const struct timespec *timeout, volatile uint32_t *uaddr2, uint32_t val3)
+{
+   return syscall(SYS_futex, uaddr, op, val, timeout, uaddr2, val3);
+}
+
+/* Basic futex ops, plus wait/wake between processes sharing memory */
+int cmd_futex1(int argc, char **argv)
+{
+   static const char test_file[] = "/tmp/test_futex1";
+   const struct timespec ts = { .tv_sec = 0, .tv_nsec = 50 * 1000 * 1000 };
+   volatile uint32_t *word;
+   pid_t childpid;
+   int fd, rc, wstatus;
+   void *vaddr;
+
+   fd = open(test_file, O_CREAT | O_RDWR | O_TRUNC, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   rc = ftruncate(fd, getpagesize());
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   vaddr = mmap(NULL,                   /* addr */
+                getpagesize(),          /* length */
+                PROT_READ | PROT_WRITE, /* prot */
+                MAP_SHARED,             /* flags */
+                fd,                     /* fd */
+                0);
+
+   DEVSHELL_CMD_ASSERT(vaddr != (void *)-1);
+   word = vaddr;
+   word[0] = 0;
+
+   /* The value does not match: no sleep */
+   rc = futex(word, FUTEX_WAIT, 1, NULL, NULL, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   rc = futex(word, FUTEX_WAIT, 0, &ts, NULL, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == ETIMEDOUT);
+
+   rc = futex(word, FUTEX_WAKE, 1, NULL, NULL, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = futex((void *)((char *)word + 1), FUTEX_WAKE, 1, NULL, NULL, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   rc = futex(word, FUTEX_CMP_REQUEUE, 1, (void *)1, word + 1, 123);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   /* The child process wakes us up after changing the value */
+   childpid = fork();
+   DEVSHELL_CMD_ASSERT(childpid >= 0);
+
+   if (!childpid) {
+      usleep(50 * 1000);
+      word[0] = 1;
+      futex(word, FUTEX_WAKE, 1, NULL, NULL, 0);
+      exit(0);
+   }
+
+   while (word[0] == 0) {
+
+      rc = futex(word, FUTEX_WAIT, 0, NULL, NULL, 0);
+      DEVSHELL_CMD_ASSERT(rc == 0 || errno == EAGAIN || errno == EINTR);
+   }
+
+   rc = waitpid(childpid, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == childpid);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+
+   /* FUTEX_REQUEUE: the child waits on word[0] and gets moved on word[1] */
+   word[0] = word[1] = 0;
+   childpid = fork();
+   DEVSHELL_CMD_ASSERT(childpid >= 0);
+
+   if (!childpid) {
+      rc = futex(word, FUTEX_WAIT, 0, NULL, NULL, 0);
+      exit(rc == 0 ? 0 : 1);
+   }
+
+   /* Requeue the child (once it's waiting) and then wake it up on word[1] */
+   do {
+      usleep(10 * 1000);
+      rc = futex(word, FUTEX_REQUEUE, 0, (void *)1, word + 1, 0);
+      DEVSHELL_CMD_ASSERT(rc >= 0);
+   } while (rc == 0);
+
+   rc = futex(word, FUTEX_WAKE, 1, NULL, NULL, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = futex(word + 1, FUTEX_WAKE, 1, NULL, NULL, 0);
+   DEVSHELL_CMD_ASSERT(rc == 1);
+
+   rc = waitpid(childpid, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == childpid);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+
+   /* Requeueing on the same futex must just wake, never requeue */
+   word[0] = 0;
+   childpid = fork();
+   DEVSHELL_CMD_ASSERT(childpid >= 0);
+
+   if (!childpid) {
+      rc = futex(word, FUTEX_WAIT, 0, NULL, NULL, 0);
+      exit(rc == 0 ? 0 : 1);
+   }
+
+   usleep(50 * 1000);
+   rc = futex(word, FUTEX_REQUEUE, 0, (void *)INT32_MAX, word, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   do {
+      usleep(10 * 1000);
+      rc = futex(word, FUTEX_CMP_REQUEUE, 1, (void *)INT32_MAX, word, 0);
+      DEVSHELL_CMD_ASSERT(rc >= 0 && rc <= 1);
+   } while (rc == 0);
+
+   rc = waitpid(childpid, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == childpid);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+
+   rc = munmap(vaddr, getpagesize());
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   close(fd);
+   rc = unlink(test_file);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
@@ -1,5 +1,7 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
+#define _GNU_SOURCE /* splice(), vmsplice(), F_SETPIPE_SZ */
+
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
@@ -10,6 +12,8 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
 
 #include "devshell.h"
 #include "test_common.h"
@@ -298,3 +302,161 @@ int cmd_pipe4(int argc, char **argv)
    close(pipefd[1]);
    return 0;
 }
+
+static void pipe5_fill_buf(char *buf, size_t len, int seed)
+{
+   for (size_t i = 0; i < len; i++)
+      buf[i] = (char)('a' + (i + (size_t)seed) % 26);
+}
+
+/* Test the pipe capacity with F_SETPIPE_SZ, splice() and vmsplice() */
+int cmd_pipe5(int argc, char **argv)
+{
+   static const char *const path = "/tmp/pipe5_file";
+   const size_t big = 128 * 1024;
+   char *wbuf = malloc(big);
+   char *rbuf = malloc(big);
+   struct iovec iov[2];
+   int pipefd[2];
+   loff_t off;
+   int fd, rc;
+
+   DEVSHELL_CMD_ASSERT(wbuf && rbuf);
+   pipe5_fill_buf(wbuf, big, 0);
+
+   rc = pipe(pipefd);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("Default pipe size: %d\n", fcntl(pipefd[0], F_GETPIPE_SZ));
+   DEVSHELL_CMD_ASSERT(fcntl(pipefd[0], F_GETPIPE_SZ) == 64 * 1024);
+
+   printf("Set the pipe size to 100000 bytes\n");
+   rc = fcntl(pipefd[1], F_SETPIPE_SZ, 100000);
+   DEVSHELL_CMD_ASSERT(rc == (int)big);
+   DEVSHELL_CMD_ASSERT(fcntl(pipefd[0], F_GETPIPE_SZ) == (int)big);
+
+   rc = fcntl(pipefd[1], F_SETPIPE_SZ, 64 * 1024 * 1024);
+   DEVSHELL_CMD_ASSERT(rc == -1 && errno == EPERM);
+
+   printf("Fill the pipe with a single write()\n");
+   rc = fcntl(pipefd[1], F_SETFL, fcntl(pipefd[1], F_GETFL) | O_NONBLOCK);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = write(pipefd[1], wbuf, big);
+   DEVSHELL_CMD_ASSERT(rc == (int)big);
+
+   rc = write(pipefd[1], wbuf, 1);
+   DEVSHELL_CMD_ASSERT(rc == -1 && errno == EAGAIN);
+
+   rc = fcntl(pipefd[1], F_SETPIPE_SZ, 4096);
+   DEVSHELL_CMD_ASSERT(rc == -1 && errno == EBUSY);
+
+   printf("Splice the whole pipe into a file\n");
+   fd = open(path, O_CREAT | O_RDWR | O_TRUNC, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   rc = splice(pipefd[0], NULL, fd, NULL, big, 0);
+   DEVSHELL_CMD_ASSERT(rc == (int)big);
+
+   rc = lseek(fd, 0, SEEK_SET);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = read(fd, rbuf, big);
+   DEVSHELL_CMD_ASSERT(rc == (int)big);
+   DEVSHELL_CMD_ASSERT(!memcmp(rbuf, wbuf, big));
+
+   printf("Splice part of the file into the pipe\n");
+   off = 1000;
+   rc = splice(fd, &off, pipefd[1], NULL, 3 * 4096, 0);
+   DEVSHELL_CMD_ASSERT(rc == 3 * 4096);
+   DEVSHELL_CMD_ASSERT(off == 1000 + 3 * 4096);
+
+   rc = read(pipefd[0], rbuf, big);
+   DEVSHELL_CMD_ASSERT(rc == 3 * 4096);
+   DEVSHELL_CMD_ASSERT(!memcmp(rbuf, wbuf + 1000, 3 * 4096));
+
+   rc = splice(fd, NULL, pipefd[0], NULL, 10, 0);
+   DEVSHELL_CMD_ASSERT(rc == -1 && errno == EBADF);
+
+   printf("Write and read with vmsplice()\n");
+   iov[0] = (struct iovec) { .iov_base = wbuf, .iov_len = 100 };
+   iov[1] = (struct iovec) { .iov_base = wbuf + 5000, .iov_len = 200 };
+   rc = vmsplice(pipefd[1], iov, 2, 0);
+   DEVSHELL_CMD_ASSERT(rc == 300);
+
+   iov[0] = (struct iovec) { .iov_base = rbuf, .iov_len = 300 };
+   rc = vmsplice(pipefd[0], iov, 1, 0);
+   DEVSHELL_CMD_ASSERT(rc == 300);
+   DEVSHELL_CMD_ASSERT(!memcmp(rbuf, wbuf, 100));
+   DEVSHELL_CMD_ASSERT(!memcmp(rbuf + 100, wbuf + 5000, 200));
+
+   close(fd);
+   close(pipefd[0]);
+   close(pipefd[1]);
+   rc = unlink(path);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   free(rbuf);
+   free(wbuf);
+   return 0;
+}
+
+/*
+ * Test sendfile() from a file on the initrd to a non-blocking pipe which gets
+ * full: no data must be lost. See also the unit test
+ * vfs_ramfs.sendfile_fallback_keeps_unwritten_data for the read+write fallback.
+ */
+int cmd_pipe6(int argc, char **argv)
+{
+   static const char *const path = "/initrd/etc/start";
+   char exp[200], buf[4096];
+   int pipefd[2];
+   int fd, rc;
+
+   fd = open(path, O_RDONLY);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   rc = pread(fd, exp, sizeof(exp), 0);
+   DEVSHELL_CMD_ASSERT(rc == sizeof(exp));
+
+   rc = pipe(pipefd);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = fcntl(pipefd[1], F_SETPIPE_SZ, 4096);
+   DEVSHELL_CMD_ASSERT(rc == 4096);
+
+   rc = fcntl(pipefd[1], F_SETFL, fcntl(pipefd[1], F_GETFL) | O_NONBLOCK);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   /* Leave just 50 bytes of free space in the pipe */
+   memset(buf, 'x', sizeof(buf));
+   rc = write(pipefd[1], buf, sizeof(buf) - 50);
+   DEVSHELL_CMD_ASSERT(rc == sizeof(buf) - 50);
+
+   printf("sendfile() to an almost full pipe\n");
+   rc = sendfile(pipefd[1], fd, NULL, 100);
+   DEVSHELL_CMD_ASSERT(rc == 50);
+   DEVSHELL_CMD_ASSERT(lseek(fd, 0, SEEK_CUR) == 50);
+
+   printf("sendfile() to a full pipe\n");
+   rc = sendfile(pipefd[1], fd, NULL, 100);
+   DEVSHELL_CMD_ASSERT(rc == -1 && errno == EAGAIN);
+   DEVSHELL_CMD_ASSERT(lseek(fd, 0, SEEK_CUR) == 50);
+
+   rc = read(pipefd[0], buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(buf));
+   DEVSHELL_CMD_ASSERT(!memcmp(buf + sizeof(buf) - 50, exp, 50));
+
+   printf("sendfile() to an empty pipe\n");
+   rc = sendfile(pipefd[1], fd, NULL, 100);
+   DEVSHELL_CMD_ASSERT(rc == 100);
+   DEVSHELL_CMD_ASSERT(lseek(fd, 0, SEEK_CUR) == 150);
+
+   rc = read(pipefd[0], buf, sizeof(buf));
+   DEVSHELL_CMD_ASSERT(rc == 100);
+   DEVSHELL_CMD_ASSERT(!memcmp(buf, exp + 50, 100));
+
+   close(pipefd[0]);
+   close(pipefd[1]);
+   close(fd);
+   return 0;
+}
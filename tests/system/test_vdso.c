@@ -0,0 +1,122 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <tilck_gen_headers/config_mm.h>
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/vdso.h>
+
+#include "devshell.h"
+#include "test_common.h"
+
+typedef int (*vdso_clock_gettime_t)(clockid_t, struct timespec *);
+typedef int (*vdso_gettimeofday_t)(struct timeval *, struct timezone *);
+typedef time_t (*vdso_time_t)(time_t *);
+
+static inline int64_t ts_to_ns(const struct timespec *ts)
+{
+   return (int64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+/* The time functions in the vdso-like page, compared to the syscalls */
+int cmd_vdso1(int argc, char **argv)
+{
+   const vdso_clock_gettime_t vclock_gettime =
+      VDSO_FUNC_ADDR(VDSO_CLOCK_GETTIME_OFF);
+
+   const vdso_gettimeofday_t vgettimeofday =
+      VDSO_FUNC_ADDR(VDSO_GETTIMEOFDAY_OFF);
+
+   const vdso_time_t vtime = VDSO_FUNC_ADDR(VDSO_TIME_OFF);
+
+   const int iters = 1000;
+   struct timespec ts, ts_sys, prev;
+   struct timeval tv;
+   struct timezone tz;
+   ull_t start, duration;
+   time_t t, t2;
+   int rc;
+
+   if (!running_on_tilck()) {
+      not_on_tilck_message();
+      return 0;
+   }
+
+   /* CLOCK_REALTIME: the vdso must agree with the syscall */
+   rc = vclock_gettime(CLOCK_REALTIME, &ts);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = syscall(SYS_clock_gettime, CLOCK_REALTIME, &ts_sys);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   DEVSHELL_CMD_ASSERT(ts.tv_nsec >= 0 && ts.tv_nsec < 1000000000);
+   DEVSHELL_CMD_ASSERT(ts_to_ns(&ts) <= ts_to_ns(&ts_sys));
+   DEVSHELL_CMD_ASSERT(ts_to_ns(&ts_sys) - ts_to_ns(&ts) < 1000000000);
+
+   /* CLOCK_MONOTONIC never goes backwards */
+   rc = vclock_gettime(CLOCK_MONOTONIC, &prev);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   for (int i = 0; i < iters; i++) {
+      rc = vclock_gettime(CLOCK_MONOTONIC, &ts);
+      DEVSHELL_CMD_ASSERT(rc == 0);
+      DEVSHELL_CMD_ASSERT(ts_to_ns(&ts) >= ts_to_ns(&prev));
+      prev = ts;
+   }
+
+   /* The vdso and the syscall must use the same clocksource */
+   rc = syscall(SYS_clock_gettime, CLOCK_MONOTONIC, &ts_sys);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = vclock_gettime(CLOCK_MONOTONIC, &ts);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   DEVSHELL_CMD_ASSERT(ts_to_ns(&prev) <= ts_to_ns(&ts_sys));
+   DEVSHELL_CMD_ASSERT(ts_to_ns(&ts_sys) <= ts_to_ns(&ts));
+
+   /* Clocks not handled by the vdso code fall back to the syscall */
+   rc = vclock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = vclock_gettime(1234, &ts);
+   DEVSHELL_CMD_ASSERT(rc == -EINVAL);
+
+   /* gettimeofday() and time() */
+   rc = vgettimeofday(&tv, &tz);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(tv.tv_usec >= 0 && tv.tv_usec < 1000000);
+   DEVSHELL_CMD_ASSERT(tz.tz_minuteswest == 0 && tz.tz_dsttime == 0);
+
+   rc = vgettimeofday(NULL, NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   t = vtime(&t2);
+   DEVSHELL_CMD_ASSERT(t == t2);
+   DEVSHELL_CMD_ASSERT(t >= tv.tv_sec && t - tv.tv_sec <= 1);
+
+   /* Just for reference, compare the cost of the two paths */
+   start = RDTSC();
+
+   for (int i = 0; i < iters; i++)
+      syscall(SYS_clock_gettime, CLOCK_MONOTONIC, &ts);
+
+   duration = RDTSC() - start;
+   printf("syscall clock_gettime(): %llu cycles\n", duration / iters);
+
+   start = RDTSC();
+
+   for (int i = 0; i < iters; i++)
+      vclock_gettime(CLOCK_MONOTONIC, &ts);
+
+   duration = RDTSC() - start;
+   printf("vdso clock_gettime():    %llu cycles\n", duration / iters);
+   return 0;
+}
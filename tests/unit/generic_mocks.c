@@ -103,6 +103,11 @@ void gdt_install() { }
 void idt_install() { }
 void irq_install() { }
 void hw_timer_setup() { }
+void hw_timer_max_oneshot_ticks() { }
+void hw_timer_set_oneshot() { }
+void hw_timer_oneshot_fired() { }
+void hw_timer_oneshot_cut() { }
+void hw_timer_set_periodic() { }
 void irq_install_handler() { }
 void irq_uninstall_handler() { }
 void setup_sysenter_interface() { }
@@ -8,6 +8,7 @@
 #include <unordered_map>
 #include <random>
 #include <memory>
+#include <algorithm>
 
 #include <gtest/gtest.h>
 #include "mocks.h"
@@ -97,6 +98,31 @@ void check_heaps_metadata(unique_ptr<u8[]> *meta_before)
    }
 }
 
+void check_heaps_max_free_hint(void)
+{
+   for (int h = 0; h < KMALLOC_HEAPS_COUNT && heaps[h]; h++) {
+
+      struct kmalloc_heap *heap = heaps[h];
+      struct block_node *nodes = (struct block_node *)heap->metadata_nodes;
+      vector<bool> reachable(heap->metadata_size, false);
+      size_t max_free = 0;
+
+      for (u32 i = 0; i < heap->metadata_size - 1; i++) {
+
+         /* Children of non-split nodes are meaningless: skip them */
+         reachable[i] = !i || (reachable[NODE_PARENT(i)] &&
+                               nodes[NODE_PARENT(i)].split);
+
+         if (!reachable[i] || nodes[i].full || nodes[i].split)
+            continue;
+
+         max_free = max(max_free, (size_t)calculate_node_size(heap, i));
+      }
+
+      ASSERT_GE(heap->max_free_hint, max_free) << "heap: " << h;
+   }
+}
+
 void kmalloc_chaos_test_sub(default_random_engine &eng,
                             lognormal_distribution<> &dist)
 {
@@ -116,6 +142,8 @@ void kmalloc_chaos_test_sub(default_random_engine &eng,
       }
    }
 
+   ASSERT_NO_FATAL_FAILURE({ check_heaps_max_free_hint(); });
+
    for (const auto& e : allocations) {
       kfree2(e.first, e.second);
    }
@@ -807,3 +835,56 @@ TEST_F(kmalloc_test, partial_free)
 
    kmalloc_destroy_heap(&h);
 }
+
+TEST_F(kmalloc_test, kmem_cache)
+{
+   struct kmem_cache c;
+   vector<void *> objs;
+   unordered_map<ulong, int> slabs;
+
+   random_device rdev;
+   const auto seed = rdev();
+   default_random_engine e(seed);
+   cout << "[ INFO     ] random seed: " << seed << endl;
+
+   kmem_cache_create(&c, "test", 100);
+
+   ASSERT_EQ(c.obj_size, 104u);
+   ASSERT_EQ(c.slab_size, (u32)PAGE_SIZE);
+   ASSERT_GT(c.objs_per_slab, 32u);
+
+   for (int i = 0; i < 1000; i++) {
+
+      void *obj = kmem_cache_alloc(&c);
+      ASSERT_TRUE(obj != NULL);
+      ASSERT_EQ((ulong)obj & 7, 0u);
+
+      memset(obj, 0xAA, 100);
+      slabs[(ulong)obj & ~((ulong)c.slab_size - 1)]++;
+      objs.push_back(obj);
+   }
+
+   sort(objs.begin(), objs.end());
+
+   for (size_t i = 1; i < objs.size(); i++)
+      ASSERT_GE((ulong)objs[i] - (ulong)objs[i - 1], c.obj_size);
+
+   for (const auto &s : slabs)
+      ASSERT_LE((u32)s.second, c.objs_per_slab);
+
+   EXPECT_EQ(c.allocated_objs, 1000u);
+   EXPECT_EQ(c.slabs_count, (u32)slabs.size());
+
+   shuffle(objs.begin(), objs.end(), e);
+
+   for (void *obj : objs)
+      kmem_cache_free(&c, obj);
+
+   /* Only one empty slab is kept by the cache */
+   EXPECT_EQ(c.allocated_objs, 0u);
+   EXPECT_EQ(c.slabs_count, 1u);
+   EXPECT_EQ(c.empty_slabs, 1u);
+
+   kmem_cache_destroy(&c);
+   EXPECT_EQ(c.slabs_count, 0u);
+}
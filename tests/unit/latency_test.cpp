@@ -0,0 +1,49 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <gtest/gtest.h>
+
+using namespace std;
+using namespace testing;
+
+extern "C" {
+   #include <tilck/kernel/latency.h>
+}
+
+TEST(latency, buckets)
+{
+   struct lat_hist h = {};
+   const u32 last = LAT_HIST_BUCKETS - 1;
+
+   lat_hist_add(&h, 0);
+   lat_hist_add(&h, (1 << LAT_HIST_MIN_SHIFT) - 1);
+   ASSERT_EQ(h.buckets[0], 2u);
+
+   lat_hist_add(&h, 1 << LAT_HIST_MIN_SHIFT);
+   lat_hist_add(&h, (1 << (LAT_HIST_MIN_SHIFT + 1)) - 1);
+   ASSERT_EQ(h.buckets[1], 2u);
+
+   lat_hist_add(&h, 1ull << (last + LAT_HIST_MIN_SHIFT - 1));
+   lat_hist_add(&h, 1ull << 40);
+   lat_hist_add(&h, ~0ull);
+   ASSERT_EQ(h.buckets[last], 3u);
+   ASSERT_EQ(h.buckets[last - 1], 0u);
+
+   ASSERT_EQ(h.count, 7u);
+}
+
+TEST(latency, percentiles)
+{
+   struct lat_hist h = {};
+
+   for (int i = 0; i < 90; i++)
+      lat_hist_add(&h, 1000);        /* bucket: [512, 1024) */
+
+   for (int i = 0; i < 10; i++)
+      lat_hist_add(&h, 100000);      /* bucket: [65536, 131072) */
+
+   ASSERT_EQ(h.sum, 90 * 1000ull + 10 * 100000ull);
+   ASSERT_EQ(lat_hist_percentile(&h, 50), 1024ull);
+   ASSERT_EQ(lat_hist_percentile(&h, 90), 1024ull);
+   ASSERT_EQ(lat_hist_percentile(&h, 91), 131072ull);
+   ASSERT_EQ(lat_hist_percentile(&h, 100), 131072ull);
+}
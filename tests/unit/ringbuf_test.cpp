@@ -9,6 +9,7 @@ using namespace testing;
 
 extern "C" {
    #include <tilck/kernel/ringbuf.h>
+   #include <tilck/kernel/safe_ringbuf.h>
 }
 
 TEST(ringbuf, basicTest)
@@ -248,3 +249,55 @@ TEST(ringbuf, read_write_bytes)
    ASSERT_TRUE(ringbuf_is_empty(&rb));
    ringbuf_destory(&rb);
 }
+
+TEST(safe_ringbuf, get_elems)
+{
+   int buffer[3] = {0};
+   int values[] = {1,2,3,4};
+   int val;
+   struct safe_ringbuf rb;
+   bool success, was_empty;
+
+   safe_ringbuf_init(&rb, ARRAY_SIZE(buffer), sizeof(buffer[0]), buffer);
+   ASSERT_EQ(safe_ringbuf_get_elems(&rb), 0U);
+
+   success = safe_ringbuf_write_elem(&rb, &values[0], &was_empty);
+   ASSERT_TRUE(success);
+   ASSERT_TRUE(was_empty);
+   ASSERT_EQ(safe_ringbuf_get_elems(&rb), 1U);
+
+   for (int i = 1; i < 3; i++) {
+      success = safe_ringbuf_write_elem(&rb, &values[i], &was_empty);
+      ASSERT_TRUE(success);
+      ASSERT_FALSE(was_empty);
+   }
+
+   ASSERT_TRUE(safe_ringbuf_is_full(&rb));
+   ASSERT_EQ(safe_ringbuf_get_elems(&rb), 3U);
+
+   success = safe_ringbuf_write_elem(&rb, &values[3], &was_empty);
+   ASSERT_FALSE(success);
+
+   for (int i = 0; i < 2; i++) {
+      success = safe_ringbuf_read_elem(&rb, &val);
+      ASSERT_TRUE(success);
+      ASSERT_EQ(val, values[i]);
+   }
+
+   ASSERT_EQ(safe_ringbuf_get_elems(&rb), 1U);
+
+   /* Make the write position wrap around */
+   success = safe_ringbuf_write_elem(&rb, &values[3], &was_empty);
+   ASSERT_TRUE(success);
+   ASSERT_EQ(safe_ringbuf_get_elems(&rb), 2U);
+
+   for (int i = 2; i < 4; i++) {
+      success = safe_ringbuf_read_elem(&rb, &val);
+      ASSERT_TRUE(success);
+      ASSERT_EQ(val, values[i]);
+   }
+
+   ASSERT_EQ(safe_ringbuf_get_elems(&rb), 0U);
+   ASSERT_FALSE(safe_ringbuf_read_elem(&rb, &val));
+   safe_ringbuf_destory(&rb);
+}
@@ -1,5 +1,7 @@
 /* SPDX-License-Identifier: BSD-2-Clause */
 
+#include <vector>
+
 #include "vfs_test.h"
 
 using namespace std;
@@ -45,3 +47,147 @@ TEST_F(ramfs_perf, creat)
    for (int i = 0; i < 100; i++)
       create_test_file(i);
 }
+
+TEST_F(ramfs_perf, stat_deep_path)
+{
+   const char *path = "/a/bb/ccc/dddd/eeeee/file";
+   struct vfs_dcache_stats st0, st1;
+   struct stat64 st;
+   int rc;
+
+   ASSERT_EQ(vfs_mkdir("/a", 0755), 0);
+   ASSERT_EQ(vfs_mkdir("/a/bb", 0755), 0);
+   ASSERT_EQ(vfs_mkdir("/a/bb/ccc", 0755), 0);
+   ASSERT_EQ(vfs_mkdir("/a/bb/ccc/dddd", 0755), 0);
+   ASSERT_EQ(vfs_mkdir("/a/bb/ccc/dddd/eeeee", 0755), 0);
+   create_test_file(0);
+   ASSERT_EQ(vfs_rename("/test_0", path), 0);
+
+   vfs_dcache_get_stats(&st0);
+
+   for (int i = 0; i < 10000; i++) {
+      rc = vfs_stat64(path, &st, true);
+      ASSERT_EQ(rc, 0);
+   }
+
+   vfs_dcache_get_stats(&st1);
+
+   /* All the lookups, except the first ones, must hit the dentry cache */
+   ASSERT_GE(st1.hits - st0.hits, 6u * 9999);
+}
+
+static void
+write_large_file(const char *path, size_t size, size_t chunk, char *buf)
+{
+   fs_handle h;
+   ssize_t rc;
+   int orc;
+
+   orc = vfs_open(path, &h, O_CREAT | O_WRONLY, 0644);
+   ASSERT_EQ(orc, 0);
+
+   for (size_t off = 0; off < size; off += chunk) {
+
+      for (size_t j = 0; j < chunk; j += sizeof(u32))
+         *(u32 *)(buf + j) = (u32)(off + j);
+
+      rc = vfs_write(h, buf, chunk);
+      ASSERT_EQ(rc, (ssize_t)chunk);
+   }
+
+   vfs_close(h);
+}
+
+TEST_F(ramfs_perf, large_file_seq_write_read)
+{
+   const size_t size = 16 * MB;
+   const size_t chunk = 64 * KB;
+   vector<char> buf(chunk);
+   struct stat64 st;
+   fs_handle h;
+   ssize_t rc;
+   int orc;
+
+   write_large_file("/large", size, chunk, buf.data());
+
+   orc = vfs_open("/large", &h, O_RDONLY, 0644);
+   ASSERT_EQ(orc, 0);
+
+   for (size_t off = 0; off < size; off += chunk) {
+
+      rc = vfs_read(h, buf.data(), chunk);
+      ASSERT_EQ(rc, (ssize_t)chunk);
+
+      for (size_t j = 0; j < chunk; j += sizeof(u32))
+         ASSERT_EQ(*(u32 *)(buf.data() + j), (u32)(off + j));
+   }
+
+   rc = vfs_read(h, buf.data(), chunk);
+   ASSERT_EQ(rc, 0);
+
+   /* Sequential writes must not allocate much more than the file size */
+   orc = vfs_fstat64(h, &st);
+   ASSERT_EQ(orc, 0);
+   ASSERT_EQ(st.st_size, (offt)size);
+   ASSERT_LE((size_t)st.st_blocks * 512, size + 32 * PAGE_SIZE);
+
+   vfs_close(h);
+}
+
+TEST_F(ramfs_perf, large_file_small_writes)
+{
+   const size_t size = 4 * MB;
+   const size_t chunk = 512;
+   vector<char> buf(chunk);
+   fs_handle h;
+   ssize_t rc;
+   int orc;
+
+   write_large_file("/large", size, chunk, buf.data());
+
+   orc = vfs_open("/large", &h, O_RDONLY, 0644);
+   ASSERT_EQ(orc, 0);
+
+   /* Read back at random offsets, across block boundaries */
+   for (int i = 0; i < 1000; i++) {
+
+      const offt off = (offt)((size_t)rand() % (size - chunk)) & ~3L;
+
+      rc = vfs_pread(h, buf.data(), chunk, off);
+      ASSERT_EQ(rc, (ssize_t)chunk);
+
+      for (size_t j = 0; j < chunk; j += sizeof(u32))
+         ASSERT_EQ(*(u32 *)(buf.data() + j), (u32)((size_t)off + j));
+   }
+
+   vfs_close(h);
+}
+
+TEST_F(ramfs_perf, large_file_truncate_and_extend)
+{
+   const size_t size = 1 * MB;
+   const offt new_len = 100 * KB + 123;
+   vector<char> buf(64 * KB);
+   fs_handle h;
+   ssize_t rc;
+   int orc;
+
+   write_large_file("/large", size, buf.size(), buf.data());
+
+   orc = vfs_truncate("/large", new_len);
+   ASSERT_EQ(orc, 0);
+   orc = vfs_truncate("/large", (offt)size);
+   ASSERT_EQ(orc, 0);
+
+   orc = vfs_open("/large", &h, O_RDONLY, 0644);
+   ASSERT_EQ(orc, 0);
+
+   /* The data past the truncation point must read back as zeros */
+   rc = vfs_pread(h, buf.data(), buf.size(), new_len);
+   ASSERT_EQ(rc, (ssize_t)buf.size());
+
+   for (size_t j = 0; j < buf.size(); j++)
+      ASSERT_EQ(buf[j], 0);
+
+   vfs_close(h);
+}
@@ -6,6 +6,7 @@
 
 #include <iostream>
 #include <random>
+#include <vector>
 
 #include "vfs_test.h"
 
@@ -166,6 +167,228 @@ TEST_F(vfs_misc, fseek)
    close(fd);
 }
 
+TEST_F(vfs_misc, read_whole_file_at_once)
+{
+   size_t fsize;
+   const char *real_buf =
+      load_once_file(PROJ_BUILD_DIR "/test_sysroot/bigfile", &fsize);
+
+   fs_handle h = NULL;
+   int r = vfs_open("/bigfile", &h, 0, O_RDONLY);
+   ASSERT_TRUE(r == 0);
+   ASSERT_TRUE(h != NULL);
+
+   vector<char> buf(fsize + 1);
+
+   /* A single read crossing all the extents of the file */
+   ssize_t res = vfs_read(h, buf.data(), buf.size());
+   ASSERT_EQ(res, (ssize_t)fsize);
+   ASSERT_EQ(memcmp(buf.data(), real_buf, fsize), 0);
+
+   /* Backwards seek, followed by another read */
+   ASSERT_EQ(vfs_seek(h, (off_t)fsize / 3, SEEK_SET), (off_t)fsize / 3);
+   res = vfs_read(h, buf.data(), fsize / 2);
+   ASSERT_EQ(res, (ssize_t)(fsize / 2));
+   ASSERT_EQ(memcmp(buf.data(), real_buf + fsize / 3, fsize / 2), 0);
+
+   vfs_close(h);
+}
+
+TEST_F(vfs_misc, lookup_in_dir_index)
+{
+   struct stat64 st;
+   char path[64];
+
+   for (int i = 1; i <= 20; i++) {
+      sprintf(path, "/testdir/manyfiles/f%d", i);
+      ASSERT_EQ(vfs_stat64(path, &st, true), 0) << "Path: " << path;
+   }
+
+   /* Lookup again, using the index built by the previous lookups */
+   ASSERT_EQ(vfs_stat64("/testdir/manyfiles/f7", &st, true), 0);
+   ASSERT_EQ(vfs_stat64("/testdir/manyfiles/../manyfiles/f20", &st, true), 0);
+   ASSERT_EQ(vfs_stat64("/testdir/manyfiles/f21", &st, true), -ENOENT);
+   ASSERT_EQ(vfs_stat64("/testdir/manyfiles/f", &st, true), -ENOENT);
+
+   /* Long names are case-sensitive */
+   ASSERT_EQ(
+      vfs_stat64("/testdir/this_is_a_file_with_a_veeeery_long_name.txt",
+                 &st, true),
+      -ENOENT
+   );
+}
+
+class vfs_ramfs : public vfs_test_base {
+
+protected:
+
+   struct fs *fs;
+
+   void SetUp() override {
+
+      vfs_test_base::SetUp();
+
+      fs = ramfs_create();
+      ASSERT_TRUE(fs != NULL);
+      mp_init(fs);
+   }
+
+   void TearDown() override {
+
+      // TODO: destroy ramfs
+      vfs_test_base::TearDown();
+   }
+};
+
+TEST_F(vfs_ramfs, dcache_invalidation)
+{
+   struct stat64 st;
+   fs_handle h;
+
+   /* Negative entry, then creation */
+   ASSERT_EQ(vfs_stat64("/f", &st, true), -ENOENT);
+   ASSERT_EQ(vfs_open("/f", &h, O_CREAT | O_WRONLY, 0644), 0);
+   vfs_close(h);
+   ASSERT_EQ(vfs_stat64("/f", &st, true), 0);
+
+   /* Positive entry, then unlink */
+   ASSERT_EQ(vfs_unlink("/f"), 0);
+   ASSERT_EQ(vfs_stat64("/f", &st, true), -ENOENT);
+
+   /* mkdir and rmdir */
+   ASSERT_EQ(vfs_stat64("/d", &st, true), -ENOENT);
+   ASSERT_EQ(vfs_mkdir("/d", 0755), 0);
+   ASSERT_EQ(vfs_stat64("/d/x", &st, true), -ENOENT);
+   ASSERT_EQ(vfs_rmdir("/d"), 0);
+   ASSERT_EQ(vfs_stat64("/d", &st, true), -ENOENT);
+   ASSERT_EQ(vfs_stat64("/d/x", &st, true), -ENOENT);
+
+   /* Rename of a directory */
+   ASSERT_EQ(vfs_mkdir("/d1", 0755), 0);
+   ASSERT_EQ(vfs_open("/d1/f", &h, O_CREAT | O_WRONLY, 0644), 0);
+   vfs_close(h);
+   ASSERT_EQ(vfs_stat64("/d1/f", &st, true), 0);
+   ASSERT_EQ(vfs_rename("/d1", "/d2"), 0);
+   ASSERT_EQ(vfs_stat64("/d1/f", &st, true), -ENOENT);
+   ASSERT_EQ(vfs_stat64("/d2/f", &st, true), 0);
+
+   /* Hard links and symlinks */
+   ASSERT_EQ(vfs_stat64("/d2/g", &st, true), -ENOENT);
+   ASSERT_EQ(vfs_link("/d2/f", "/d2/g"), 0);
+   ASSERT_EQ(vfs_stat64("/d2/g", &st, true), 0);
+   ASSERT_EQ(vfs_stat64("/s", &st, false), -ENOENT);
+   ASSERT_EQ(vfs_symlink("/d2/g", "/s"), 0);
+   ASSERT_EQ(vfs_stat64("/s", &st, true), 0);
+}
+
+TEST_F(vfs_ramfs, pread_pwrite_with_seek_fallback)
+{
+   struct fs_handle_base *hb;
+   struct file_ops fops;
+   char buf[16] = {0};
+   fs_handle h;
+
+   ASSERT_EQ(vfs_open("/f", &h, O_CREAT | O_RDWR, 0644), 0);
+   ASSERT_EQ(vfs_write(h, (void *)"0123456789", 10), 10);
+
+   /* Hide ramfs' pread and pwrite, as for a file system not having them */
+   hb = (struct fs_handle_base *)h;
+   fops = *hb->fops;
+   fops.pread = NULL;
+   fops.pwrite = NULL;
+   hb->fops = &fops;
+
+   ASSERT_EQ(vfs_seek(h, 4, SEEK_SET), 4);
+
+   ASSERT_EQ(vfs_pwrite(h, (void *)"abc", 3, 1), 3);
+   ASSERT_EQ(vfs_seek(h, 0, SEEK_CUR), 4);
+
+   ASSERT_EQ(vfs_pread(h, buf, 6, 0), 6);
+   ASSERT_STREQ(buf, "0abc45");
+   ASSERT_EQ(vfs_seek(h, 0, SEEK_CUR), 4);
+
+   ASSERT_EQ(vfs_pread(h, buf, sizeof(buf), 100), 0);
+   ASSERT_EQ(vfs_seek(h, 0, SEEK_CUR), 4);
+
+   vfs_close(h);
+}
+
+static func_write limited_write_real;
+static size_t limited_write_budget;
+
+/* Accept only `limited_write_budget` bytes, then fail with -EAGAIN */
+static ssize_t limited_write(fs_handle h, char *buf, size_t len)
+{
+   ssize_t rc;
+
+   if (!limited_write_budget)
+      return -EAGAIN;
+
+   rc = limited_write_real(h, buf, MIN(len, limited_write_budget));
+
+   if (rc > 0)
+      limited_write_budget -= (size_t)rc;
+
+   return rc;
+}
+
+TEST_F(vfs_ramfs, sendfile_fallback_keeps_unwritten_data)
+{
+   struct task *curr = get_curr_task();
+   void *saved_io_copybuf = curr->io_copybuf;
+   vector<char> copybuf(IO_COPYBUF_SIZE);
+   struct fs_handle_base *in_hb, *out_hb;
+   struct file_ops in_fops, out_fops;
+   const struct file_ops *ramfs_fops;
+   char data[200], buf[200];
+   fs_handle in, out;
+
+   for (int i = 0; i < (int)sizeof(data); i++)
+      data[i] = (char)('a' + i % 26);
+
+   ASSERT_EQ(vfs_open("/in", &in, O_CREAT | O_RDWR, 0644), 0);
+   ASSERT_EQ(vfs_write(in, data, sizeof(data)), (ssize_t)sizeof(data));
+   ASSERT_EQ(vfs_seek(in, 0, SEEK_SET), 0);
+   ASSERT_EQ(vfs_open("/out", &out, O_CREAT | O_RDWR, 0644), 0);
+
+   /* Use the read+write fallback and make `out` behave like a full pipe */
+   in_hb = (struct fs_handle_base *)in;
+   out_hb = (struct fs_handle_base *)out;
+   ramfs_fops = in_hb->fops;
+   in_fops = *ramfs_fops;
+   in_fops.sendfile = NULL;
+   in_hb->fops = &in_fops;
+   out_fops = *ramfs_fops;
+   out_fops.sendfile = NULL;
+   out_fops.write = &limited_write;
+   out_hb->fops = &out_fops;
+   limited_write_real = ramfs_fops->write;
+   curr->io_copybuf = copybuf.data();
+
+   limited_write_budget = 50;
+   EXPECT_EQ(vfs_sendfile(out, in, NULL, 100), 50);
+   EXPECT_EQ(vfs_seek(in, 0, SEEK_CUR), 50);
+
+   limited_write_budget = 0;
+   EXPECT_EQ(vfs_sendfile(out, in, NULL, 100), -EAGAIN);
+   EXPECT_EQ(vfs_seek(in, 0, SEEK_CUR), 50);
+
+   limited_write_budget = sizeof(data);
+   EXPECT_EQ(vfs_sendfile(out, in, NULL, 100), 100);
+   EXPECT_EQ(vfs_seek(in, 0, SEEK_CUR), 150);
+
+   curr->io_copybuf = saved_io_copybuf;
+   in_hb->fops = ramfs_fops;
+   out_hb->fops = ramfs_fops;
+
+   /* No data must have been lost in `out` */
+   EXPECT_EQ(vfs_pread(out, buf, sizeof(buf), 0), 150);
+   EXPECT_EQ(memcmp(buf, data, 150), 0);
+
+   vfs_close(out);
+   vfs_close(in);
+}
+
 class compute_abs_path_test :
    public TestWithParam<
       tuple<const char *, const char *, const char *>
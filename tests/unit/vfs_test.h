@@ -27,6 +27,7 @@ protected:
    void SetUp() override {
 
       init_kmalloc_for_tests();
+      init_vfs();
    }
 
    void TearDown() override {